@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "dberror.h"
+#include "btree_mgr.h"
+#include "btree_implement.h"
+
+// Microbenchmark of the search inside one B+ Tree node (one level of a lookup)
+// and of complete findKey lookups, for every search method this CPU supports.
+
+#define NUM_PROBES 4096
+#define NUM_SEARCHES 4000000
+#define NUM_TREE_KEYS 200000
+#define NUM_LOOKUPS 1000000
+
+static char *methodNames[] = { "linear", "binary", "sse2", "avx2" };
+
+// helper methods
+static double elapsedNanos (struct timespec *start, struct timespec *end);
+static void benchNodeSearch (int numKeys);
+static void benchFindKey (void);
+
+// main method
+int
+main (void)
+{
+  int sizes[] = { 16, 64, 128, 256, 339 };
+  int i;
+
+  printf("Search within one node (ns per search, speedup over linear)\n");
+  for(i = 0; i < 5; i++)
+    benchNodeSearch(sizes[i]);
+
+  printf("\nfindKey on %d DT_INT keys with %d keys per node (ns per lookup)\n", NUM_TREE_KEYS, getMaxKeys(DT_INT));
+  benchFindKey();
+
+  return 0;
+}
+
+// ************************************************************
+double
+elapsedNanos (struct timespec *start, struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+// ************************************************************
+void
+benchNodeSearch (int numKeys)
+{
+  int *intKeys = (int *) malloc(numKeys * sizeof(int));
+  float *floatKeys = (float *) malloc(numKeys * sizeof(float));
+  int *probes = (int *) malloc(NUM_PROBES * sizeof(int));
+  struct timespec start, end;
+  double linearInt = 0, linearFloat = 0, nanosInt, nanosFloat;
+  long checksum = 0;
+  int i, method;
+
+  // sorted keys with gaps, probes spread over the whole range
+  for(i = 0; i < numKeys; i++)
+    {
+      intKeys[i] = i * 3;
+      floatKeys[i] = i * 3.0f;
+    }
+  for(i = 0; i < NUM_PROBES; i++)
+    probes[i] = rand() % (numKeys * 3);
+
+  for(method = KEY_SEARCH_LINEAR; method <= KEY_SEARCH_AVX2; method++)
+    {
+      if (setKeySearch(method) != RC_OK)
+	continue;
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(i = 0; i < NUM_SEARCHES; i++)
+	checksum += searchIntKeys(intKeys, numKeys, probes[i % NUM_PROBES], TRUE);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      nanosInt = elapsedNanos(&start, &end) / NUM_SEARCHES;
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(i = 0; i < NUM_SEARCHES; i++)
+	checksum += searchFloatKeys(floatKeys, numKeys, (float) probes[i % NUM_PROBES], TRUE);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      nanosFloat = elapsedNanos(&start, &end) / NUM_SEARCHES;
+
+      if (method == KEY_SEARCH_LINEAR)
+	{
+	  linearInt = nanosInt;
+	  linearFloat = nanosFloat;
+	}
+      printf("%4d keys %-7s DT_INT %6.1f ns (%4.1fx)   DT_FLOAT %6.1f ns (%4.1fx)\n", numKeys, methodNames[method],
+	     nanosInt, linearInt / nanosInt, nanosFloat, linearFloat / nanosFloat);
+    }
+
+  // keep the compiler from dropping the searches
+  if (checksum == -1)
+    printf("%ld\n", checksum);
+
+  free(intKeys);
+  free(floatKeys);
+  free(probes);
+}
+
+// ************************************************************
+void
+benchFindKey (void)
+{
+  BTreeHandle *tree = NULL;
+  struct timespec start, end;
+  Value key;
+  RID rid;
+  int i, method;
+
+  CHECK(initIndexManager(NULL));
+  CHECK(createBtree("benchidx", DT_INT, getMaxKeys(DT_INT) - 1));
+  CHECK(openBtree(&tree, "benchidx"));
+
+  key.dt = DT_INT;
+  for(i = 0; i < NUM_TREE_KEYS; i++)
+    {
+      key.v.intV = (int) ((long) i * 7919 % NUM_TREE_KEYS);
+      rid.page = key.v.intV;
+      rid.slot = 0;
+      CHECK(insertKey(tree, &key, rid));
+    }
+
+  for(method = KEY_SEARCH_LINEAR; method <= KEY_SEARCH_AVX2; method++)
+    {
+      if (setKeySearch(method) != RC_OK)
+	continue;
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for(i = 0; i < NUM_LOOKUPS; i++)
+	{
+	  key.v.intV = (int) ((i * 40503u) % NUM_TREE_KEYS);
+	  CHECK(findKey(tree, &key, &rid));
+	}
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      printf("%-7s %6.1f ns\n", methodNames[method], elapsedNanos(&start, &end) / NUM_LOOKUPS);
+    }
+
+  CHECK(closeBtree(tree));
+  CHECK(deleteBtree("benchidx"));
+  CHECK(shutdownIndexManager());
+}
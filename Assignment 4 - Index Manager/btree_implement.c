@@ -1,477 +1,1629 @@
 #include "btree_implement.h"
 #include "dt.h"
 #include "string.h"
+#include <stdlib.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*********** PAGES *************/
+
+// Reads the metadata page of the index file into the B+ Tree's metadata structure.
+RC readMetadata(BTreeManager * treeManager) {
+	BM_PageHandle page;
+	BTreeMetadata metadata;
+	RC result;
+
+	if ((result = pinPage(&treeManager->bufferPool, &page, METADATA_PAGE)) != RC_OK)
+		return result;
+	memcpy(&metadata, page.data, sizeof(BTreeMetadata));
+	unpinPage(&treeManager->bufferPool, &page);
+
+	treeManager->keyType = metadata.keyType;
+	treeManager->order = metadata.order;
+	treeManager->rootPage = metadata.rootPage;
+	treeManager->numNodes = metadata.numNodes;
+	treeManager->numEntries = metadata.numEntries;
+	treeManager->numPages = metadata.numPages;
+	treeManager->freePage = metadata.freePage;
+	treeManager->unique = metadata.unique;
+	treeManager->numKeyAttrs = metadata.numKeyAttrs;
+	memcpy(treeManager->keyTypes, metadata.keyTypes, sizeof(metadata.keyTypes));
+	return RC_OK;
+}
 
-/*********** INSERTION *************/
+// Writes the B+ Tree's metadata structure to the metadata page of the index file.
+RC writeMetadata(BTreeManager * treeManager) {
+	BM_PageHandle page;
+	BTreeMetadata metadata;
+	RC result;
+
+	metadata.keyType = treeManager->keyType;
+	metadata.order = treeManager->order;
+	metadata.rootPage = treeManager->rootPage;
+	metadata.numNodes = treeManager->numNodes;
+	metadata.numEntries = treeManager->numEntries;
+	metadata.numPages = treeManager->numPages;
+	metadata.freePage = treeManager->freePage;
+	metadata.unique = treeManager->unique;
+	metadata.numKeyAttrs = treeManager->numKeyAttrs;
+	memcpy(metadata.keyTypes, treeManager->keyTypes, sizeof(metadata.keyTypes));
+
+	if ((result = pinPage(&treeManager->bufferPool, &page, METADATA_PAGE)) != RC_OK)
+		return result;
+	memcpy(page.data, &metadata, sizeof(BTreeMetadata));
+	markDirty(&treeManager->bufferPool, &page);
+	return unpinPage(&treeManager->bufferPool, &page);
+}
 
-// Creates a new record (NodeData) to hold the value to which a key refers.
-// Returns the record structure.
-NodeData * makeRecord(RID * rid) {
-	NodeData * record = (NodeData *) malloc(sizeof(NodeData));
-	if (record == NULL) {
-		perror("NodeData creation.");
-		exit(RC_INSERT_ERROR);
+// Returns the number of bytes a key of the given datatype takes in the key array of a node.
+static int getKeyWidth(DataType keyType) {
+	return keyType == DT_STRING ? sizeof(StringKey) : sizeof(int);
+}
+
+// Returns the maximum number of keys of the given datatype which fit on a node page.
+int getMaxKeys(DataType keyType) {
+	int bytesPerKey = getKeyWidth(keyType) + sizeof(RID);
+	int stringSpace = 0;
+
+	// The characters of DT_STRING keys share the rest of the page, which holds at least a few keys of the maximum length.
+	// A node whose characters fill the page is split before it has the maximum number of keys.
+	if (keyType == DT_STRING)
+		stringSpace = MIN_STRING_KEYS_PER_NODE * MAX_STRING_KEY_LENGTH;
+
+	// Up to 7 bytes are lost aligning the pointer array.
+	return (PAGE_SIZE - sizeof(NodeHeader) - 7 - stringSpace) / bytesPerKey;
+}
+
+// Computes where the arrays of a node page start for the order and key type of the B+ Tree.
+void setNodeLayout(BTreeManager * treeManager) {
+	int maxKeys = treeManager->order - 1;
+
+	treeManager->keyWidth = getKeyWidth(treeManager->keyType);
+	// An internal node has one child more than keys. maxKeys + 1 children fit in the space of maxKeys RIDs.
+	treeManager->pointersOffset = (sizeof(NodeHeader) + maxKeys * treeManager->keyWidth + 7) & ~7;
+	treeManager->heapBase = treeManager->pointersOffset + maxKeys * sizeof(RID);
+}
+
+// Points the node structure into the node's page, which is pinned already.
+static void setNodePointers(BTreeManager * treeManager, Node * node) {
+	node->header = (NodeHeader *) node->page.data;
+	node->keys = node->page.data + sizeof(NodeHeader);
+	node->pointers.rids = (RID *) (node->page.data + treeManager->pointersOffset);
+	node->keyType = treeManager->keyType;
+	node->heapBase = treeManager->heapBase;
+	node->maxKeys = treeManager->order - 1;
+}
+
+// Pins the page of a node in the buffer pool and points the node structure into it.
+RC getNode(BTreeManager * treeManager, int pageNum, Node * node) {
+	RC result = pinPage(&treeManager->bufferPool, &node->page, pageNum);
+	if (result != RC_OK)
+		return result;
+	setNodePointers(treeManager, node);
+	return RC_OK;
+}
+
+// Copies a node which the caller has pinned, but not latched, into "data" (PAGE_SIZE bytes) and points "copy" into it.
+// Returns FALSE if the node had a version other than "version" (or was latched) while it was copied.
+bool copyNode(BTreeManager * treeManager, Node * node, unsigned int version, Node * copy, char * data) {
+	memcpy(data, node->page.data, PAGE_SIZE);
+	copy->page.pageNum = node->page.pageNum;
+	copy->page.data = data;
+	setNodePointers(treeManager, copy);
+	return checkVersion(node, version);
+}
+
+// Pins a page for a new node or posting list page. It is a page released by a delete if there is one,
+// else a new page at the end of the index file.
+static RC allocatePage(BTreeManager * treeManager, BM_PageHandle * page) {
+	RC result = RC_OK;
+
+	pthread_mutex_lock(&treeManager->pageLatch);
+	if (treeManager->freePage != NO_PAGE) {
+		if ((result = pinPage(&treeManager->bufferPool, page, treeManager->freePage)) == RC_OK)
+			treeManager->freePage = ((NodeHeader *) page->data)->next;
 	} else {
-		//((RID *) new_NodeData->rid)->page = 0;//rid->page;
-		//((RID *) new_NodeData->rid)->slot = 0;//rid->slot;
-		record->rid.page = rid->page;
-		record->rid.slot = rid->slot;
+		// Pinning a page past the end of the file makes the buffer pool extend the file.
+		if ((result = pinPage(&treeManager->bufferPool, page, treeManager->numPages)) == RC_OK)
+			treeManager->numPages++;
 	}
-	//printf("  New NodeData values =%d ..... ", record->rid.page);
-	return record;
+	pthread_mutex_unlock(&treeManager->pageLatch);
+
+	if (result == RC_OK)
+		markDirty(&treeManager->bufferPool, page);
+	return result;
 }
 
-// Creates a new tree when the first element (NodeData) is inserted.
-Node * createNewTree(BTreeManager * treeManager, Value * key, NodeData * pointer) {
+// Puts a page which is no longer used on the list of free pages and unpins it. The version of the page is kept.
+static void releasePage(BTreeManager * treeManager, BM_PageHandle * page) {
+	NodeHeader * header = (NodeHeader *) page->data;
+
+	header->isLeaf = FALSE;
+	header->numKeys = 0;
+	pthread_mutex_lock(&treeManager->pageLatch);
+	header->next = treeManager->freePage;
+	treeManager->freePage = page->pageNum;
+	pthread_mutex_unlock(&treeManager->pageLatch);
+	markDirty(&treeManager->bufferPool, page);
+	unpinPage(&treeManager->bufferPool, page);
+}
 
-	Node * root = createLeaf(treeManager);
-	int bTreeOrder = treeManager->order;
-	//printf("... insertKEY POINTER page = %d  slot = %d \n", pointer->rid.page, pointer->rid.slot);
+// Unpins the page of a node. The node structure must not be used afterwards.
+void releaseNode(BTreeManager * treeManager, Node * node) {
+	unpinPage(&treeManager->bufferPool, &node->page);
+}
+
+// Marks the page of a modified node dirty so that the buffer pool writes it back to the index file.
+void markNodeDirty(BTreeManager * treeManager, Node * node) {
+	markDirty(&treeManager->bufferPool, &node->page);
+}
+
+// Sets the previous leaf of the leaf on page "pageNum", as part of a structure modification.
+RC setPrevLeaf(BTreeManager * treeManager, int pageNum, int prev) {
+	Node leaf;
+	RC result;
+
+	if ((result = getNode(treeManager, pageNum, &leaf)) != RC_OK)
+		return result;
+	if ((result = latchModifiedNode(treeManager, &leaf)) != RC_OK) {
+		releaseNode(treeManager, &leaf);
+		return result;
+	}
+	leaf.header->prev = prev;
+	markNodeDirty(treeManager, &leaf);
+	releaseNode(treeManager, &leaf);
+	return RC_OK;
+}
+
+// Removes all keys and string characters from a node.
+void resetNode(Node * node) {
+	node->header->numKeys = 0;
+	node->header->heapStart = PAGE_SIZE;
+	node->header->prefixLength = 0;
+}
+
+// Returns the characters of the common prefix of the DT_STRING keys of a node.
+static char * getNodePrefix(Node * node) {
+	return node->page.data + PAGE_SIZE - node->header->prefixLength;
+}
+
+// Returns the number of leading characters two strings have in common, at most "max".
+static int getCommonLength(char * string, char * other, int max) {
+	int length;
+
+	for (length = 0; length < max && string[length] == other[length] && string[length] != '\0'; length++)
+		;
+	return length;
+}
+
+// Stores the first characters of the stored part of a DT_STRING key in its slot of the key array.
+static void setHead(StringKey * slot, char * characters, int length) {
+	memset(slot->head, 0, STRING_KEY_HEAD);
+	memcpy(slot->head, characters, length < STRING_KEY_HEAD ? length : STRING_KEY_HEAD);
+}
+
+// Sets the common prefix of the DT_STRING keys of an empty node to the characters "first" and "last" have in common.
+// A node which is filled with sorted keys gets the prefix of its first and last key, so that every key only stores the rest.
+void setNodePrefix(Node * node, NodeKey * first, NodeKey * last) {
+	int length;
+
+	if (node->keyType != DT_STRING)
+		return;
+	length = getCommonLength(first->v.stringV, last->v.stringV, MAX_STRING_KEY_LENGTH);
+	node->header->prefixLength = length;
+	node->header->heapStart = PAGE_SIZE - length;
+	memcpy(node->page.data + node->header->heapStart, first->v.stringV, length);
+}
+
+// Stores the string characters of all keys except the one at "skip" at the end of the page again, which joins the space
+// left behind by removed and replaced keys to the free space. The keys get the common prefix of "prefixLength" characters
+// at "prefix", which all of them start with. A shorter prefix than before moves the rest of the old prefix into every key.
+static void compactStrings(Node * node, int skip, char * prefix, int prefixLength) {
+	char buffer[PAGE_SIZE];
+	char key[2 * MAX_STRING_KEY_LENGTH];
+	StringKey * slots = (StringKey *) node->keys;
+	int oldLength = node->header->prefixLength;
+	char * oldPrefix = getNodePrefix(node);
+	int heapStart = PAGE_SIZE - prefixLength;
+	int i, length;
+
+	memcpy(buffer + heapStart, prefix, prefixLength);
+	for (i = 0; i < node->header->numKeys; i++) {
+		if (i == skip)
+			continue;
+
+		// The characters of the key are the old prefix followed by the characters stored for the key.
+		memcpy(key, oldPrefix, oldLength);
+		memcpy(key + oldLength, node->page.data + slots[i].offset, slots[i].length);
+		length = oldLength + slots[i].length - prefixLength;
+		heapStart -= length;
+		memcpy(buffer + heapStart, key + prefixLength, length);
+		slots[i].offset = heapStart;
+		slots[i].length = length;
+		setHead(&slots[i], key + prefixLength, length);
+	}
+	memcpy(node->page.data + heapStart, buffer + heapStart, PAGE_SIZE - heapStart);
+	node->header->heapStart = heapStart;
+	node->header->prefixLength = prefixLength;
+}
+
+// Joins all the unused string space of a node to its free space.
+void compactNode(Node * node) {
+	if (node->keyType == DT_STRING)
+		compactStrings(node, -1, getNodePrefix(node), node->header->prefixLength);
+}
+
+// Returns the number of characters the DT_STRING keys of a node have after their first "prefixLength" characters.
+static int getSuffixSpace(Node * node, int prefixLength) {
+	StringKey * slots = (StringKey *) node->keys;
+	int space = 0;
+	int i;
+
+	for (i = 0; i < node->header->numKeys; i++)
+		space += node->header->prefixLength + slots[i].length - prefixLength;
+	return space;
+}
+
+// Returns the number of bytes the string characters of the keys of a node take, including their common prefix.
+static int getStringSpace(Node * node) {
+	if (node->keyType != DT_STRING)
+		return 0;
+	return node->header->prefixLength + getSuffixSpace(node, node->header->prefixLength);
+}
+
+// Returns TRUE if "key" can be stored in a node in addition to its keys ("replace" is -1), or in place of the key at "replace".
+// A DT_STRING key which does not start with the common prefix of the node makes every other key longer.
+bool hasRoomForKey(Node * node, NodeKey * key, int replace) {
+	int prefixLength, common, space;
+
+	if (replace < 0 && node->header->numKeys >= node->maxKeys)
+		return FALSE;
+	if (node->keyType != DT_STRING)
+		return TRUE;
+
+	// The new prefix is the part of the old one the key starts with, and the key's own characters come after it.
+	prefixLength = node->header->prefixLength;
+	common = getCommonLength(key->v.stringV, getNodePrefix(node), prefixLength);
+	space = common + getSuffixSpace(node, common) + strlen(key->v.stringV) - common;
+	if (replace >= 0)
+		space -= prefixLength + ((StringKey *) node->keys)[replace].length - common;
+	return space <= PAGE_SIZE - node->heapBase;
+}
+
+// Makes the shortest key which is greater than "left" and less than or equal to "right" (the last key of a node and the
+// first key of the next one) into "separator". A DT_STRING separator ends with the first character in which the keys differ.
+void getSeparator(NodeKey * left, NodeKey * right, NodeKey * separator) {
+	*separator = *right;
+	if (right->dt == DT_STRING)
+		separator->v.stringV[getCommonLength(left->v.stringV, right->v.stringV, MAX_STRING_KEY_LENGTH) + 1] = '\0';
+}
+
+// Copies the key at "index" of a node into "key".
+void getKey(Node * node, int index, NodeKey * key) {
+	StringKey * slot;
+	int prefixLength;
+
+	key->dt = node->keyType;
+	switch (node->keyType) {
+	case DT_INT:
+		key->v.intV = ((int *) node->keys)[index];
+		break;
+	case DT_FLOAT:
+		key->v.floatV = ((float *) node->keys)[index];
+		break;
+	case DT_STRING:
+		slot = &((StringKey *) node->keys)[index];
+		prefixLength = node->header->prefixLength;
+		memcpy(key->v.stringV, getNodePrefix(node), prefixLength);
+		memcpy(key->v.stringV + prefixLength, node->page.data + slot->offset, slot->length);
+		key->v.stringV[prefixLength + slot->length] = '\0';
+		break;
+	case DT_BOOL:
+		key->v.boolV = ((int *) node->keys)[index];
+		break;
+	}
+}
+
+// Stores "key" at "index" of a node. The position must already be counted in the node's number of keys.
+// The characters of a DT_STRING key after the common prefix are stored at the end of the page, for which the node must
+// have room (see hasRoomForKey(...)).
+void setKey(Node * node, int index, NodeKey * key) {
+	StringKey * slot;
+	int length, prefixLength, common;
+
+	switch (node->keyType) {
+	case DT_INT:
+		((int *) node->keys)[index] = key->v.intV;
+		break;
+	case DT_FLOAT:
+		((float *) node->keys)[index] = key->v.floatV;
+		break;
+	case DT_STRING:
+		prefixLength = node->header->prefixLength;
+		common = getCommonLength(key->v.stringV, getNodePrefix(node), prefixLength);
+
+		// A key which does not start with the common prefix shortens it. Otherwise the space of replaced keys may have to be joined first.
+		if (common < prefixLength)
+			compactStrings(node, index, key->v.stringV, common);
+		else if (node->header->heapStart - (int) strlen(key->v.stringV + prefixLength) < node->heapBase)
+			compactStrings(node, index, getNodePrefix(node), prefixLength);
+
+		prefixLength = node->header->prefixLength;
+		length = strlen(key->v.stringV + prefixLength);
+		slot = &((StringKey *) node->keys)[index];
+		node->header->heapStart -= length;
+		memcpy(node->page.data + node->header->heapStart, key->v.stringV + prefixLength, length);
+		setHead(slot, key->v.stringV + prefixLength, length);
+		slot->offset = node->header->heapStart;
+		slot->length = length;
+		break;
+	case DT_BOOL:
+		((int *) node->keys)[index] = key->v.boolV != 0;
+		break;
+	}
+}
+
+// Adds "key" after the last key of a node. The caller stores the pointer that goes with it.
+void appendKey(Node * node, NodeKey * key) {
+	node->header->numKeys++;
+	setKey(node, node->header->numKeys - 1, key);
+}
+
+// Moves "count" keys of a node from position "from" to position "to". The pointers are not moved.
+void moveKeys(Node * node, int to, int from, int count) {
+	int width = getKeyWidth(node->keyType);
+	if (count > 0)
+		memmove(node->keys + to * width, node->keys + from * width, count * width);
+}
+
+/*********** LATCHES *************/
+
+// Returns the version of a node. If the node is latched, it waits until the thread which latched it is done.
+unsigned int readVersion(Node * node) {
+	unsigned int version;
+
+	while ((version = __atomic_load_n(&node->header->version, __ATOMIC_ACQUIRE)) & NODE_LATCHED)
+		sched_yield();
+	return version;
+}
+
+// Returns TRUE if a node still has the version read before, i.e. everything read from it since is consistent.
+bool checkVersion(Node * node, unsigned int version) {
+	// The reads of the node must be done before the version is read again.
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&node->header->version, __ATOMIC_RELAXED) == version;
+}
+
+// Latches a node, waiting until no other thread has it latched.
+void latchNode(Node * node) {
+	while (!tryLatchNode(node, readVersion(node)))
+		;
+}
+
+// Latches a node if it still has the version read before. Returns FALSE if it has been changed (or latched) since.
+bool tryLatchNode(Node * node, unsigned int version) {
+	return __sync_bool_compare_and_swap(&node->header->version, version, version | NODE_LATCHED);
+}
+
+// Releases the latch of a node. The node gets a new version.
+void unlatchNode(Node * node) {
+	__atomic_add_fetch(&node->header->version, 1, __ATOMIC_RELEASE);
+}
+
+// Latches a node which the running structure modification changes. The node stays latched (and pinned) until
+// unlatchModifiedNodes(...) releases all of them at the end of the modification. The caller holds structureLatch.
+RC latchModifiedNode(BTreeManager * treeManager, Node * node) {
+	int i;
+	RC result;
+
+	for (i = 0; i < treeManager->numLatched; i++)
+		if (treeManager->latched[i].pageNum == node->page.pageNum)
+			return RC_OK;
+	if (treeManager->numLatched == MAX_LATCHED_NODES)
+		return RC_ERROR;
+
+	// Pin the page once more, so that it stays in the buffer pool after the caller releases the node.
+	if ((result = pinPage(&treeManager->bufferPool, &treeManager->latched[i], node->page.pageNum)) != RC_OK)
+		return result;
+	latchNode(node);
+	treeManager->numLatched++;
+	return RC_OK;
+}
+
+// Releases the nodes latched by the running structure modification.
+void unlatchModifiedNodes(BTreeManager * treeManager) {
+	Node node;
+	int i;
+
+	for (i = 0; i < treeManager->numLatched; i++) {
+		node.page = treeManager->latched[i];
+		node.header = (NodeHeader *) node.page.data;
+		unlatchNode(&node);
+		unpinPage(&treeManager->bufferPool, &treeManager->latched[i]);
+	}
+	treeManager->numLatched = 0;
+}
+
+// Returns the page of the root, or NO_PAGE if the tree is empty.
+int getRootPage(BTreeManager * treeManager) {
+	return __atomic_load_n(&treeManager->rootPage, __ATOMIC_ACQUIRE);
+}
+
+// Makes "pageNum" the root. Readers which read the old root notice it, see findLeaf(...).
+static void setRootPage(BTreeManager * treeManager, int pageNum) {
+	__atomic_store_n(&treeManager->rootPage, pageNum, __ATOMIC_RELEASE);
+}
+
+// Returns the number of keys of a node. A reader may see any number while the node is changed, so it is limited
+// to what fits, which keeps the reads within the page until the version check.
+static int getNumKeys(Node * node) {
+	int numKeys = node->header->numKeys;
+	return numKeys < 0 ? 0 : numKeys > node->maxKeys ? node->maxKeys : numKeys;
+}
+
+/*********** SEARCHING KEYS *************/
+
+// The vectorized searches halve the keys in question until this many are left and then compare all of them.
+#define SIMD_SEARCH_WINDOW 32
+
+// Searches of the key arrays. All of them return the number of keys which are less than the key
+// (or less than or equal to it if "upper" is TRUE), i.e. the position of the key in the sorted array.
+static int linearSearchInt(int * keys, int numKeys, int key, bool upper) {
+	int i = 0;
+	if (upper)
+		while (i < numKeys && keys[i] <= key)
+			i++;
+	else
+		while (i < numKeys && keys[i] < key)
+			i++;
+	return i;
+}
+
+static int linearSearchFloat(float * keys, int numKeys, float key, bool upper) {
+	int i = 0;
+	if (upper)
+		while (i < numKeys && keys[i] <= key)
+			i++;
+	else
+		while (i < numKeys && keys[i] < key)
+			i++;
+	return i;
+}
+
+static int binarySearchInt(int * keys, int numKeys, int key, bool upper) {
+	int low = 0;
+	int high = numKeys;
+	int middle;
+
+	// The keys before "low" come before the position, the keys from "high" on do not.
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (keys[middle] < key || (upper && keys[middle] == key))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+static int binarySearchFloat(float * keys, int numKeys, float key, bool upper) {
+	int low = 0;
+	int high = numKeys;
+	int middle;
+
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (keys[middle] < key || (upper && keys[middle] == key))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The vectorized searches are compiled for SSE2/AVX2 regardless of the compiler flags and are only called
+// if the CPU supports them (see selectKeySearch). Within the window, the keys before the position are
+// exactly the keys that compare less, so counting the set bits of the comparison masks gives the position.
+
+__attribute__((target("sse2")))
+static int sse2SearchInt(int * keys, int numKeys, int key, bool upper) {
+	int low = 0;
+	int high = numKeys;
+	int middle, mask, i;
+	__m128i needle = _mm_set1_epi32(key);
+
+	while (high - low > SIMD_SEARCH_WINDOW) {
+		middle = (low + high) / 2;
+		if (keys[middle] < key || (upper && keys[middle] == key))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (i = low; i + 4 <= high; i += 4) {
+		__m128i block = _mm_loadu_si128((__m128i *) (keys + i));
+		if (upper)
+			mask = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(block, needle))) & 0xF;
+		else
+			mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(block, needle)));
+		// A block which is not entirely before the key contains the position.
+		if (mask != 0xF)
+			return i + __builtin_popcount(mask);
+	}
+	return i + linearSearchInt(keys + i, high - i, key, upper);
+}
+
+__attribute__((target("sse2")))
+static int sse2SearchFloat(float * keys, int numKeys, float key, bool upper) {
+	int low = 0;
+	int high = numKeys;
+	int middle, mask, i;
+	__m128 needle = _mm_set1_ps(key);
+
+	while (high - low > SIMD_SEARCH_WINDOW) {
+		middle = (low + high) / 2;
+		if (keys[middle] < key || (upper && keys[middle] == key))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (i = low; i + 4 <= high; i += 4) {
+		__m128 block = _mm_loadu_ps(keys + i);
+		if (upper)
+			mask = _mm_movemask_ps(_mm_cmple_ps(block, needle));
+		else
+			mask = _mm_movemask_ps(_mm_cmplt_ps(block, needle));
+		if (mask != 0xF)
+			return i + __builtin_popcount(mask);
+	}
+	return i + linearSearchFloat(keys + i, high - i, key, upper);
+}
+
+__attribute__((target("avx2")))
+static int avx2SearchInt(int * keys, int numKeys, int key, bool upper) {
+	int low = 0;
+	int high = numKeys;
+	int middle, mask, i;
+	__m256i needle = _mm256_set1_epi32(key);
+
+	while (high - low > SIMD_SEARCH_WINDOW) {
+		middle = (low + high) / 2;
+		if (keys[middle] < key || (upper && keys[middle] == key))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (i = low; i + 8 <= high; i += 8) {
+		__m256i block = _mm256_loadu_si256((__m256i *) (keys + i));
+		if (upper)
+			mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(block, needle))) & 0xFF;
+		else
+			mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, block)));
+		if (mask != 0xFF)
+			return i + __builtin_popcount(mask);
+	}
+	return i + linearSearchInt(keys + i, high - i, key, upper);
+}
+
+__attribute__((target("avx2")))
+static int avx2SearchFloat(float * keys, int numKeys, float key, bool upper) {
+	int low = 0;
+	int high = numKeys;
+	int middle, mask, i;
+	__m256 needle = _mm256_set1_ps(key);
+
+	while (high - low > SIMD_SEARCH_WINDOW) {
+		middle = (low + high) / 2;
+		if (keys[middle] < key || (upper && keys[middle] == key))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (i = low; i + 8 <= high; i += 8) {
+		__m256 block = _mm256_loadu_ps(keys + i);
+		if (upper)
+			mask = _mm256_movemask_ps(_mm256_cmp_ps(block, needle, _CMP_LE_OQ));
+		else
+			mask = _mm256_movemask_ps(_mm256_cmp_ps(block, needle, _CMP_LT_OQ));
+		if (mask != 0xFF)
+			return i + __builtin_popcount(mask);
+	}
+	return i + linearSearchFloat(keys + i, high - i, key, upper);
+}
+
+#endif
+
+// Searches used for DT_INT/DT_BOOL and DT_FLOAT keys. Binary search until initIndexManager(...) selects the best one for this CPU.
+static int (*intKeySearch)(int *, int, int, bool) = binarySearchInt;
+static int (*floatKeySearch)(float *, int, float, bool) = binarySearchFloat;
+
+// This function sets the search used in the key arrays of DT_INT, DT_BOOL and DT_FLOAT nodes.
+// It returns RC_ERROR if the CPU does not support it.
+RC setKeySearch(KeySearch method) {
+	switch (method) {
+	case KEY_SEARCH_LINEAR:
+		intKeySearch = linearSearchInt;
+		floatKeySearch = linearSearchFloat;
+		return RC_OK;
+	case KEY_SEARCH_BINARY:
+		intKeySearch = binarySearchInt;
+		floatKeySearch = binarySearchFloat;
+		return RC_OK;
+#if defined(__x86_64__) || defined(__i386__)
+	case KEY_SEARCH_SSE2:
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("sse2"))
+			return RC_ERROR;
+		intKeySearch = sse2SearchInt;
+		floatKeySearch = sse2SearchFloat;
+		return RC_OK;
+	case KEY_SEARCH_AVX2:
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("avx2"))
+			return RC_ERROR;
+		intKeySearch = avx2SearchInt;
+		floatKeySearch = avx2SearchFloat;
+		return RC_OK;
+#endif
+	default:
+		return RC_ERROR;
+	}
+}
 
-	root->keys[0] = key;
-	root->pointers[0] = pointer;
-	root->pointers[bTreeOrder - 1] = NULL;
-	root->parent = NULL;
-	root->num_keys++;
+// This function selects the fastest search of the key arrays the CPU supports.
+void selectKeySearch(void) {
+	if (setKeySearch(KEY_SEARCH_AVX2) == RC_OK)
+		return;
+	if (setKeySearch(KEY_SEARCH_SSE2) == RC_OK)
+		return;
+	setKeySearch(KEY_SEARCH_BINARY);
+}
 
-	treeManager->numEntries++;
-	//printf("\n START NEW NODE END \n");
+// Returns the number of keys in the sorted array which are less than the key (less than or equal if "upper" is TRUE).
+int searchIntKeys(int * keys, int numKeys, int key, bool upper) {
+	return intKeySearch(keys, numKeys, key, upper);
+}
 
-	return root;
+// Returns the number of keys in the sorted array which are less than the key (less than or equal if "upper" is TRUE).
+int searchFloatKeys(float * keys, int numKeys, float key, bool upper) {
+	return floatKeySearch(keys, numKeys, key, upper);
 }
 
-// Inserts a new pointer to the record (NodeData) and its corresponding key into a leaf.
-// Returns the altered leaf.
-Node * insertIntoLeaf(BTreeManager * treeManager, Node * leaf, Value * key, NodeData * pointer) {
-	//printf("... insertKEY POINTER page = %d  slot = %d \n", pointer->rid.page, pointer->rid.slot);
+/*********** INSERTION *************/
+
+// Inserts the key and its pointer (NodeData). If "restructure" is FALSE, only a leaf which has room for the key
+// (or in which the key gets another RID) is changed, and "done" is set to FALSE if the insert needs a structure
+// modification instead. Otherwise the caller holds structureLatch and releases the latched nodes afterwards.
+static RC insertEntry(BTreeManager * treeManager, Value * key, NodeData * pointer, bool restructure, bool * done) {
+	NodePath path;
+	Node leaf;
+	NodeKey nodeKey;
+	unsigned int version;
+	int index;
+	RC result = RC_OK;
+
+	*done = TRUE;
+	while (TRUE) {
+		result = findLeaf(treeManager, key, &path, &leaf, &version);
+
+		// The first entry creates the tree.
+		if (result == RC_IM_KEY_NOT_FOUND) {
+			if (!restructure) {
+				*done = FALSE;
+				return RC_OK;
+			}
+			return createNewTree(treeManager, key, pointer);
+		}
+		if (result != RC_OK)
+			return result;
+
+		// Latch the leaf. Without structureLatch, the leaf must not have changed since it was found.
+		if (restructure) {
+			if ((result = latchModifiedNode(treeManager, &leaf)) != RC_OK) {
+				releaseNode(treeManager, &leaf);
+				return result;
+			}
+			break;
+		}
+		if (tryLatchNode(&leaf, version))
+			break;
+		releaseNode(treeManager, &leaf);
+	}
+
+	// Check is a record with the spcified key already exists. It can only be on this leaf.
+	// Unless keys are unique, the RID is added to the RIDs of that key.
+	index = findEntry(&leaf, key);
+	makeKey(&nodeKey, key);
+	if (index < leaf.header->numKeys && compareKey(key, &leaf, index) == 0) {
+		if (treeManager->unique)
+			result = RC_IM_KEY_ALREADY_EXISTS;
+		else if ((result = addPosting(treeManager, &leaf.pointers.rids[index], pointer->rid)) == RC_OK) {
+			__sync_fetch_and_add(&treeManager->numEntries, 1);
+			markNodeDirty(treeManager, &leaf);
+		}
+	} else if (hasRoomForKey(&leaf, &nodeKey, -1)) {
+		// If the leaf has room for the new key, then insert the new key into that leaf.
+		insertIntoLeaf(treeManager, &leaf, key, pointer);
+	} else if (!restructure) {
+		*done = FALSE;
+	} else {
+		// If the leaf dows not have room for the new key, split leaf and then insert the new key into that leaf.
+		return insertIntoLeafAfterSplitting(treeManager, &path, &leaf, key, pointer);
+	}
 
-	int i, insertion_point;
-	treeManager->numEntries++;
+	if (!restructure)
+		unlatchNode(&leaf);
+	releaseNode(treeManager, &leaf);
+	return result;
+}
 
-	insertion_point = 0;
-	while (insertion_point < leaf->num_keys && isLess(leaf->keys[insertion_point], key))
-		insertion_point++;
+// This function inserts the key and its pointer (NodeData). Most inserts only change their leaf, which they latch while
+// other threads use the rest of the tree. An insert which splits the leaf is done again as a structure modification.
+RC insert(BTreeManager * treeManager, Value * key, NodeData * pointer) {
+	bool done;
+	RC result;
+
+	result = insertEntry(treeManager, key, pointer, FALSE, &done);
+	if (done)
+		return result;
+
+	pthread_mutex_lock(&treeManager->structureLatch);
+	result = insertEntry(treeManager, key, pointer, TRUE, &done);
+	unlatchModifiedNodes(treeManager);
+	pthread_mutex_unlock(&treeManager->structureLatch);
+	return result;
+}
 
-	for (i = leaf->num_keys; i > insertion_point; i--) {
-		leaf->keys[i] = leaf->keys[i - 1];
-		leaf->pointers[i] = leaf->pointers[i - 1];
+// Creates a new tree when the first element (NodeData) is inserted.
+RC createNewTree(BTreeManager * treeManager, Value * key, NodeData * pointer) {
+	Node root;
+	NodeKey nodeKey;
+	RC result;
+
+	if ((result = createLeaf(treeManager, &root)) != RC_OK)
+		return result;
+	if ((result = latchModifiedNode(treeManager, &root)) != RC_OK) {
+		releaseNode(treeManager, &root);
+		return result;
 	}
-	leaf->keys[insertion_point] = key;
-	leaf->pointers[insertion_point] = pointer;
-	leaf->num_keys++;
-	return leaf;
+
+	makeKey(&nodeKey, key);
+	appendKey(&root, &nodeKey);
+	root.pointers.rids[0] = pointer->rid;
+
+	setRootPage(treeManager, root.page.pageNum);
+	__sync_fetch_and_add(&treeManager->numEntries, 1);
+
+	releaseNode(treeManager, &root);
+	return RC_OK;
+}
+
+// Inserts a new pointer to the record (NodeData) and its corresponding key into a leaf which has room for it.
+RC insertIntoLeaf(BTreeManager * treeManager, Node * leaf, Value * key, NodeData * pointer) {
+	int num_keys = leaf->header->numKeys;
+	int insertion_point = findEntry(leaf, key);
+	NodeKey nodeKey;
+
+	makeKey(&nodeKey, key);
+	moveKeys(leaf, insertion_point + 1, insertion_point, num_keys - insertion_point);
+	memmove(&leaf->pointers.rids[insertion_point + 1], &leaf->pointers.rids[insertion_point],
+			(num_keys - insertion_point) * sizeof(RID));
+	leaf->header->numKeys++;
+	setKey(leaf, insertion_point, &nodeKey);
+	leaf->pointers.rids[insertion_point] = pointer->rid;
+
+	__sync_fetch_and_add(&treeManager->numEntries, 1);
+	markNodeDirty(treeManager, leaf);
+	return RC_OK;
 }
 
-// Inserts a new key and pointer to a new record (NodeData) into a leaf so as to exceed the tree's order,
-// causing the leaf to be split in half.
-Node * insertIntoLeafAfterSplitting(BTreeManager * treeManager, Node * leaf, Value * key, NodeData * pointer) {
+// Returns the number of bytes the characters of the DT_STRING keys from "from" to "to" - 1 take in a node, including their common prefix.
+static int getKeysSpace(NodeKey * keys, int from, int to) {
+	int prefixLength, space, i;
 
-	//printf("... insertIntoLeafAfterSplitting POINTER page = %d  slot = %d \n", pointer->rid.page, pointer->rid.slot);
+	if (from >= to)
+		return 0;
+	prefixLength = getCommonLength(keys[from].v.stringV, keys[to - 1].v.stringV, MAX_STRING_KEY_LENGTH);
+	for (i = from, space = prefixLength; i < to; i++)
+		space += strlen(keys[i].v.stringV) - prefixLength;
+	return space;
+}
 
-	Node * new_leaf;
-	Value ** temp_keys;
-	void ** temp_pointers;
-	int insertion_index, split, new_key, i, j;
+// Moves the point at which "numKeys" sorted keys are split until the characters of both nodes fit. The left node gets the keys
+// before "split", the right node the keys from "split + up" on (the key at "split" moves up into the parent if "up" is 1).
+// Splitting in the middle fits unless the keys are DT_STRING keys of very different lengths. The keys of the full node fit on
+// one page, and a key which is not part of their common prefix can only be the first or the last, so some split point fits.
+static int fitSplit(Node * node, NodeKey * keys, int numKeys, int split, int up) {
+	int space = PAGE_SIZE - node->heapBase;
+
+	if (node->keyType != DT_STRING)
+		return split;
+	while (split > 1 && getKeysSpace(keys, 0, split) > space)
+		split--;
+	while (split + up < numKeys - 1 && getKeysSpace(keys, split + up, numKeys) > space)
+		split++;
+	return split;
+}
 
-	new_leaf = createLeaf(treeManager);
+// Inserts a new key and pointer to a new record (NodeData) into a leaf which is full (see hasRoomForKey(...)),
+// causing the leaf to be split in half. The leaf is latched already and is released.
+RC insertIntoLeafAfterSplitting(BTreeManager * treeManager, NodePath * path, Node * leaf, Value * key, NodeData * pointer) {
+	Node new_leaf;
+	NodeKey * temp_keys;
+	NodeKey separator;
+	RID * temp_rids;
+	int insertion_index, split, i, j, left, right;
 	int bTreeOrder = treeManager->order;
+	int numKeys = leaf->header->numKeys + 1;
+	RC result;
+
+	if ((result = createLeaf(treeManager, &new_leaf)) != RC_OK) {
+		releaseNode(treeManager, leaf);
+		return result;
+	}
+	if ((result = latchModifiedNode(treeManager, &new_leaf)) != RC_OK) {
+		releaseNode(treeManager, leaf);
+		releaseNode(treeManager, &new_leaf);
+		return result;
+	}
 
-	temp_keys = malloc(bTreeOrder * sizeof(Value));
+	temp_keys = malloc(bTreeOrder * sizeof(NodeKey));
 	if (temp_keys == NULL) {
 		perror("Temporary keys array.");
 		exit(RC_INSERT_ERROR);
 	}
 
-	temp_pointers = malloc(bTreeOrder * sizeof(void *));
-	if (temp_pointers == NULL) {
+	temp_rids = malloc(bTreeOrder * sizeof(RID));
+	if (temp_rids == NULL) {
 		perror("Temporary pointers array.");
 		exit(RC_INSERT_ERROR);
 	}
 
-	//printf("\n Splitting initialized.... ");
-	insertion_index = 0;
-	while (insertion_index < bTreeOrder - 1 && isLess(leaf->keys[insertion_index], key))
-		insertion_index++;
-
-	for (i = 0, j = 0; i < leaf->num_keys; i++, j++) {
+	// Gather the entries of the leaf and the new entry in sorted order.
+	insertion_index = findEntry(leaf, key);
+	for (i = 0, j = 0; i < leaf->header->numKeys; i++, j++) {
 		if (j == insertion_index)
 			j++;
-		temp_keys[j] = leaf->keys[i];
-		temp_pointers[j] = leaf->pointers[i];
+		getKey(leaf, i, &temp_keys[j]);
+		temp_rids[j] = leaf->pointers.rids[i];
 	}
-
-	temp_keys[insertion_index] = key;
-	temp_pointers[insertion_index] = pointer;
-
-	leaf->num_keys = 0;
+	makeKey(&temp_keys[insertion_index], key);
+	temp_rids[insertion_index] = pointer->rid;
 
 	// Splitting
-	if ((bTreeOrder - 1) % 2 == 0)
-		split = (bTreeOrder - 1) / 2;
+	if ((numKeys - 1) % 2 == 0)
+		split = (numKeys - 1) / 2;
 	else
-		split = (bTreeOrder - 1) / 2 + 1;
+		split = (numKeys - 1) / 2 + 1;
+	split = fitSplit(leaf, temp_keys, numKeys, split, 0);
+
+	// Point the next leaf back to the new leaf first, so that nothing has been changed yet if that fails.
+	if (leaf->header->next != NO_PAGE && (result = setPrevLeaf(treeManager, leaf->header->next, new_leaf.page.pageNum)) != RC_OK) {
+		releaseNode(treeManager, leaf);
+		freeNode(treeManager, &new_leaf);
+		free(temp_rids);
+		free(temp_keys);
+		return result;
+	}
 
+	// Each leaf stores the prefix of its keys once.
+	resetNode(leaf);
+	setNodePrefix(leaf, &temp_keys[0], &temp_keys[split - 1]);
 	for (i = 0; i < split; i++) {
-		leaf->pointers[i] = temp_pointers[i];
-		leaf->keys[i] = temp_keys[i];
-		leaf->num_keys++;
+		appendKey(leaf, &temp_keys[i]);
+		leaf->pointers.rids[i] = temp_rids[i];
 	}
-
-	for (i = split, j = 0; i < bTreeOrder; i++, j++) {
-		new_leaf->pointers[j] = temp_pointers[i];
-		new_leaf->keys[j] = temp_keys[i];
-		new_leaf->num_keys++;
+	setNodePrefix(&new_leaf, &temp_keys[split], &temp_keys[numKeys - 1]);
+	for (i = split, j = 0; i < numKeys; i++, j++) {
+		appendKey(&new_leaf, &temp_keys[i]);
+		new_leaf.pointers.rids[j] = temp_rids[i];
 	}
 
-	free(temp_pointers);
+	// Link the new leaf into the chains of leaves right after the old leaf.
+	new_leaf.header->next = leaf->header->next;
+	new_leaf.header->prev = leaf->page.pageNum;
+	leaf->header->next = new_leaf.page.pageNum;
+
+	left = leaf->page.pageNum;
+	right = new_leaf.page.pageNum;
+	__sync_fetch_and_add(&treeManager->numEntries, 1);
+
+	markNodeDirty(treeManager, leaf);
+	markNodeDirty(treeManager, &new_leaf);
+	releaseNode(treeManager, leaf);
+	releaseNode(treeManager, &new_leaf);
+
+	// The shortest key which is greater than the last key of the old leaf and not greater than the first key of the new leaf
+	// separates the two leaves in the parent.
+	getSeparator(&temp_keys[split - 1], &temp_keys[split], &separator);
+	result = insertIntoParent(treeManager, path, left, &separator, right);
+	free(temp_rids);
 	free(temp_keys);
-
-	new_leaf->pointers[bTreeOrder - 1] = leaf->pointers[bTreeOrder - 1];
-	leaf->pointers[bTreeOrder - 1] = new_leaf;
-
-	for (i = leaf->num_keys; i < bTreeOrder - 1; i++)
-		leaf->pointers[i] = NULL;
-	for (i = new_leaf->num_keys; i < bTreeOrder - 1; i++)
-		new_leaf->pointers[i] = NULL;
-
-	new_leaf->parent = leaf->parent;
-	new_key = new_leaf->keys[0];
-	treeManager->numEntries++;
-	return insertIntoParent(treeManager, leaf, new_key, new_leaf);
+	return result;
 }
 
-// Inserts a new key and pointer to a node into a node, causing the node's size to exceed
-// the order, and causing the node to split into two.
-Node * insertIntoNodeAfterSplitting(BTreeManager * treeManager, Node * old_node, int left_index, Value * key, Node * right) {
-
-	int i, j, split, k_prime;
-	Node * new_node, *child;
-	Value ** temp_keys;
-	Node ** temp_pointers;
-
+// Inserts a new key and pointer to a node into a node which is full (see hasRoomForKey(...)),
+// causing the node to split into two. The node is latched already and is released.
+RC insertIntoNodeAfterSplitting(BTreeManager * treeManager, NodePath * path, Node * old_node, int left_index, NodeKey * key, int right) {
+	int i, j, split, left;
+	Node new_node;
+	NodeKey * temp_keys;
+	int * temp_pointers;
 	int bTreeOrder = treeManager->order;
+	int numKeys = old_node->header->numKeys + 1;
+	RC result;
+
+	if ((result = createNode(treeManager, &new_node)) != RC_OK) {
+		releaseNode(treeManager, old_node);
+		return result;
+	}
+	if ((result = latchModifiedNode(treeManager, &new_node)) != RC_OK) {
+		releaseNode(treeManager, old_node);
+		releaseNode(treeManager, &new_node);
+		return result;
+	}
 
 	/* First we create a temporary set of keys and pointers
 	 * to hold everything in order, including
 	 * the new key and pointer, inserted in their
 	 * correct places.
-	 * Then create a new node and copy half of the
-	 * keys and pointers to the old node and
-	 * the other half to the new.
+	 * Then copy half of the keys and pointers to the
+	 * old node and the other half to the new.
 	 */
-
-	temp_pointers = malloc((bTreeOrder + 1) * sizeof(Node *));
+	temp_pointers = malloc((bTreeOrder + 1) * sizeof(int));
 	if (temp_pointers == NULL) {
 		perror("Temporary pointers array for splitting nodes.");
 		exit(RC_INSERT_ERROR);
 	}
-	temp_keys = malloc(bTreeOrder * sizeof(Value *));
+	temp_keys = malloc(bTreeOrder * sizeof(NodeKey));
 	if (temp_keys == NULL) {
 		perror("Temporary keys array for splitting nodes.");
 		exit(RC_INSERT_ERROR);
 	}
 
-	for (i = 0, j = 0; i < old_node->num_keys + 1; i++, j++) {
+	for (i = 0, j = 0; i < old_node->header->numKeys + 1; i++, j++) {
 		if (j == left_index + 1)
 			j++;
-		temp_pointers[j] = old_node->pointers[i];
+		temp_pointers[j] = old_node->pointers.children[i];
 	}
 
-	for (i = 0, j = 0; i < old_node->num_keys; i++, j++) {
+	for (i = 0, j = 0; i < old_node->header->numKeys; i++, j++) {
 		if (j == left_index)
 			j++;
-		temp_keys[j] = old_node->keys[i];
+		getKey(old_node, i, &temp_keys[j]);
 	}
 
 	temp_pointers[left_index + 1] = right;
-	temp_keys[left_index] = key;
+	temp_keys[left_index] = *key;
 
-	/* Create the new node and copy
-	 * half the keys and pointers to the
-	 * old and half to the new.
-	 */
-	if ((bTreeOrder - 1) % 2 == 0)
-		split = (bTreeOrder - 1) / 2;
+	// An internal node splits its keys (up to "order") around key "split - 1", leaving at least one key on either side.
+	if (numKeys % 2 == 0)
+		split = numKeys / 2;
 	else
-		split = (bTreeOrder - 1) / 2 + 1;
+		split = numKeys / 2 + 1;
+	split = fitSplit(old_node, temp_keys, numKeys, split - 1, 1) + 1;
 
-	new_node = createNode(treeManager);
-	old_node->num_keys = 0;
+	// The key at "split - 1" moves up into the parent.
+	resetNode(old_node);
+	setNodePrefix(old_node, &temp_keys[0], &temp_keys[split - 2]);
 	for (i = 0; i < split - 1; i++) {
-		old_node->pointers[i] = temp_pointers[i];
-		old_node->keys[i] = temp_keys[i];
-		old_node->num_keys++;
-	}
-	old_node->pointers[i] = temp_pointers[i];
-	k_prime = temp_keys[split - 1];
-	for (++i, j = 0; i < bTreeOrder; i++, j++) {
-		new_node->pointers[j] = temp_pointers[i];
-		new_node->keys[j] = temp_keys[i];
-		new_node->num_keys++;
-	}
-	new_node->pointers[j] = temp_pointers[i];
-	free(temp_pointers);
-	free(temp_keys);
-	new_node->parent = old_node->parent;
-	for (i = 0; i <= new_node->num_keys; i++) {
-		child = new_node->pointers[i];
-		child->parent = new_node;
+		appendKey(old_node, &temp_keys[i]);
+		old_node->pointers.children[i] = temp_pointers[i];
+	}
+	old_node->pointers.children[i] = temp_pointers[i];
+	setNodePrefix(&new_node, &temp_keys[split], &temp_keys[numKeys - 1]);
+	for (++i, j = 0; i < numKeys; i++, j++) {
+		appendKey(&new_node, &temp_keys[i]);
+		new_node.pointers.children[j] = temp_pointers[i];
 	}
+	new_node.pointers.children[j] = temp_pointers[i];
+
+	left = old_node->page.pageNum;
+	right = new_node.page.pageNum;
+	markNodeDirty(treeManager, old_node);
+	markNodeDirty(treeManager, &new_node);
+	releaseNode(treeManager, old_node);
+	releaseNode(treeManager, &new_node);
 
 	/* Insert a new key into the parent of the two
 	 * nodes resulting from the split, with
 	 * the old node to the left and the new to the right.
 	 */
-
-	treeManager->numEntries++;
-	return insertIntoParent(treeManager, old_node, k_prime, new_node);
+	result = insertIntoParent(treeManager, path, left, &temp_keys[split - 1], right);
+	free(temp_pointers);
+	free(temp_keys);
+	return result;
 }
 
 // Inserts a new node (leaf or internal node) into the B+ tree.
-// Returns the root of the tree after insertion.
-Node * insertIntoParent(BTreeManager * treeManager, Node * left, Value * key, Node * right) {
-
-	//printf("\n Inserting into Parent.... \n");
+// The parent of "left" is the last node of "path".
+RC insertIntoParent(BTreeManager * treeManager, NodePath * path, int left, NodeKey * key, int right) {
 	int left_index;
-	Node * parent = left->parent;
-	int bTreeOrder = treeManager->order;
+	Node parent;
+	RC result;
 
 	// Checking if it is the new root.
-	if (parent == NULL)
+	if (path->depth == 0)
 		return insertIntoNewRoot(treeManager, left, key, right);
 
-	// In case its a leaf or node, find the parent's pointer to the left node.
-	left_index = getLeftIndex(parent, left);
+	// The path tells us the parent's pointer to the left node.
+	path->depth--;
+	left_index = path->indexes[path->depth];
+	if ((result = getNode(treeManager, path->pages[path->depth], &parent)) != RC_OK)
+		return result;
+	if ((result = latchModifiedNode(treeManager, &parent)) != RC_OK) {
+		releaseNode(treeManager, &parent);
+		return result;
+	}
 
 	// If the new key can accommodate in the node.
-	if (parent->num_keys < bTreeOrder - 1) {
-		return insertIntoNode(treeManager, parent, left_index, key, right);
+	if (hasRoomForKey(&parent, key, -1)) {
+		insertIntoNode(treeManager, &parent, left_index, key, right);
+		releaseNode(treeManager, &parent);
+		return RC_OK;
 	}
 
 	// In case it cannot accomodate, then split the node preserving the B+ Tree properties.
-	return insertIntoNodeAfterSplitting(treeManager, parent, left_index, key, right);
+	return insertIntoNodeAfterSplitting(treeManager, path, &parent, left_index, key, right);
 }
 
-// Function used in insertIntoParent to findRecord the index of the parent's pointer to
-// the node to the left of the key to be inserted.
-int getLeftIndex(Node * parent, Node * left) {
-	int left_index = 0;
-	while (left_index <= parent->num_keys && parent->pointers[left_index] != left)
-		left_index++;
-	return left_index;
+// Inserts a new key and pointer to a node into a node into which these can fit without violating the B+ tree properties.
+RC insertIntoNode(BTreeManager * treeManager, Node * parent, int left_index, NodeKey * key, int right) {
+	int num_keys = parent->header->numKeys;
+
+	moveKeys(parent, left_index + 1, left_index, num_keys - left_index);
+	memmove(&parent->pointers.children[left_index + 2], &parent->pointers.children[left_index + 1],
+			(num_keys - left_index) * sizeof(int));
+	parent->header->numKeys++;
+	setKey(parent, left_index, key);
+	parent->pointers.children[left_index + 1] = right;
+
+	markNodeDirty(treeManager, parent);
+	return RC_OK;
 }
 
-// Inserts a new key and pointer to a node into a node into which these can fit without violating the B+ tree properties.
-Node * insertIntoNode(BTreeManager * treeManager, Node * parent, int left_index, Value * key, Node * right) {
-	int i;
-	for (i = parent->num_keys; i > left_index; i--) {
-		parent->pointers[i + 1] = parent->pointers[i];
-		parent->keys[i] = parent->keys[i - 1];
+// Creates a new root for two subtrees and inserts the appropriate key into the new root.
+RC insertIntoNewRoot(BTreeManager * treeManager, int left, NodeKey * key, int right) {
+	Node root;
+	RC result;
+
+	if ((result = createNode(treeManager, &root)) != RC_OK)
+		return result;
+	if ((result = latchModifiedNode(treeManager, &root)) != RC_OK) {
+		releaseNode(treeManager, &root);
+		return result;
 	}
 
-	parent->pointers[left_index + 1] = right;
-	parent->keys[left_index] = key;
-	parent->num_keys++;
-
-	return treeManager->root;
-}
+	appendKey(&root, key);
+	root.pointers.children[0] = left;
+	root.pointers.children[1] = right;
+	setRootPage(treeManager, root.page.pageNum);
 
-// Creates a new root for two subtrees and inserts the appropriate key into the new root.
-Node * insertIntoNewRoot(BTreeManager * treeManager, Node * left, Value * key, Node * right) {
-	Node * root = createNode(treeManager);
-	root->keys[0] = key;
-	root->pointers[0] = left;
-	root->pointers[1] = right;
-	root->num_keys++;
-	root->parent = NULL;
-	left->parent = root;
-	right->parent = root;
-	return root;
+	releaseNode(treeManager, &root);
+	return RC_OK;
 }
 
 // Creates a new general node, which can be adapted to serve as either a leaf or an internal node.
-Node * createNode(BTreeManager * treeManager) {
-	//printf("\n Inside createNode...  ");
-	treeManager->numNodes++;
-	int bTreeOrder = treeManager->order;
+// The node is stored on a page released by a delete if there is one, else on a new page at the end of the index file.
+// The node is returned pinned.
+RC createNode(BTreeManager * treeManager, Node * node) {
+	RC result;
 
-	Node * new_node = malloc(sizeof(Node));
-	if (new_node == NULL) {
-		perror("Node creation.");
-		exit(RC_INSERT_ERROR);
-	}
-	//printf("\n SIZE allocated for NODE  ");
-
-	new_node->keys = malloc((bTreeOrder - 1) * sizeof(Value *));
-	if (new_node->keys == NULL) {
-		perror("New node keys array.");
-		exit(RC_INSERT_ERROR);
-	}
-	//printf("\n SIZE allocated for VALUE  ");
+	if ((result = allocatePage(treeManager, &node->page)) != RC_OK)
+		return result;
+	setNodePointers(treeManager, node);
 
-	new_node->pointers = malloc(bTreeOrder * sizeof(void *));
-	if (new_node->pointers == NULL) {
-		perror("New node pointers array.");
-		exit(RC_INSERT_ERROR);
-	}
-	//printf("\n SIZE allocated for POINTERS  ");
+	node->header->isLeaf = FALSE;
+	node->header->next = NO_PAGE;
+	node->header->prev = NO_PAGE;
+	resetNode(node);
 
-	new_node->is_leaf = false;
-	new_node->num_keys = 0;
-	new_node->parent = NULL;
-	new_node->next = NULL;
-	return new_node;
+	treeManager->numNodes++;
+	return RC_OK;
 }
 
 // Creates a new leaf by creating a node.
-Node * createLeaf(BTreeManager * treeManager) {
-	Node * leaf = createNode(treeManager);
-	leaf->is_leaf = true;
-	return leaf;
+RC createLeaf(BTreeManager * treeManager, Node * leaf) {
+	RC result = createNode(treeManager, leaf);
+	if (result == RC_OK)
+		leaf->header->isLeaf = TRUE;
+	return result;
 }
 
-//Searches for the key from root to the leaf.
-// Returns the leaf containing the given key.
-Node * findLeaf(Node * root, Value * key) {
-	//printf(" INside findLeaf... ");
-	int i = 0;
-	Node * c = root;
-	if (c == NULL) {
-		//printf("Empty tree.\n");
-		return c;
-	}
-	while (!c->is_leaf) {
-		i = 0;
-		while (i < c->num_keys) {
-			//printf("\nfindLeaf()... key = %s, c->keys[i] = %s \n", key->v.stringV, c->keys[i]->v.stringV);
-			if (isGreater(key, c->keys[i]) || isEqual(key, c->keys[i])) {
-				i++;
-			} else
+// Descends from the root to a leaf without latches, see the LATCHING PROTOCOL. If "key" is NULL, it follows the first
+// (or, if "last" is TRUE, the last) children, else the children whose range contains the key, and records the visited nodes
+// in "path" (if not NULL). Returns the leaf pinned, and its version in "version", which the caller checks after reading it.
+// Returns RC_IM_KEY_NOT_FOUND if the tree is empty.
+static RC descend(BTreeManager * treeManager, Value * key, bool last, NodePath * path, Node * leaf, unsigned int * version) {
+	Node child;
+	unsigned int childVersion;
+	int i, pageNum;
+	bool valid;
+	RC result;
+
+	while (TRUE) {
+		if ((pageNum = getRootPage(treeManager)) == NO_PAGE)
+			return RC_IM_KEY_NOT_FOUND;
+		if ((result = getNode(treeManager, pageNum, leaf)) != RC_OK)
+			return result;
+		*version = readVersion(leaf);
+
+		// A node which is the root when its version is read is the root until that version changes.
+		valid = getRootPage(treeManager) == pageNum;
+		if (path != NULL)
+			path->depth = 0;
+
+		while (valid && !leaf->header->isLeaf) {
+			if (key == NULL)
+				i = last ? getNumKeys(leaf) : 0;
+			else
+				i = findChild(leaf, key);
+			pageNum = leaf->pointers.children[i];
+			if (path != NULL) {
+				path->pages[path->depth] = leaf->page.pageNum;
+				path->indexes[path->depth] = i;
+				path->depth++;
+			}
+
+			// The child is only pinned once the page number is known to be right, and it is only used if the parent
+			// has not changed until the child's version is read.
+			if (!(valid = checkVersion(leaf, *version)))
 				break;
+			if ((result = getNode(treeManager, pageNum, &child)) != RC_OK) {
+				releaseNode(treeManager, leaf);
+				return result;
+			}
+			childVersion = readVersion(&child);
+			valid = checkVersion(leaf, *version);
+			releaseNode(treeManager, leaf);
+			*leaf = child;
+			*version = childVersion;
 		}
-		c = (Node *) c->pointers[i];
-	}
-	return c;
-}
+		if (valid)
+			return RC_OK;
 
-// Finds and returns the record (NodeData) to which a key refers.
-NodeData * findRecord(Node * root, Value *key) {
-	//printf(" Inside findRecord... ");
-	int i = 0;
-	Node * c = findLeaf(root, key);
-	if (c == NULL)
-		return NULL;
-	for (i = 0; i < c->num_keys; i++) {
-		//printf(" .. c->keys[i] = %s, key = %s .. ", c->keys[i]->v.stringV, key->v.stringV);
-		if (isEqual(c->keys[i], key))
-			break;
+		// Another thread changed a node on the way. Start again from the root.
+		releaseNode(treeManager, leaf);
 	}
-	if (i == c->num_keys)
-		return NULL;
-	else
-		return (NodeData *) c->pointers[i];
 }
 
-/*********** DELETION *************/
-
-// Returns the index of a node's nearest neighbor (sibling) to the left if one exists.
-// If not (the node is the leftmost child), returns -1 to signify this special case.
-int getNeighborIndex(Node * n) {
-
-	int i;
-
-	/* Return the index of the key to the left
-	 * of the pointer in the parent pointing
-	 * to n.
-	 * If n is the leftmost child, this means
-	 * return -1.
-	 */
-	for (i = 0; i <= n->parent->num_keys; i++)
-		if (n->parent->pointers[i] == n)
-			return i - 1;
+//Searches for the key from root to the leaf and records the visited nodes in "path" (if not NULL).
+// Returns the leaf that contains (or would contain) the given key, pinned, and its version (see descend(...)).
+RC findLeaf(BTreeManager * treeManager, Value * key, NodePath * path, Node * leaf, unsigned int * version) {
+	return descend(treeManager, key, FALSE, path, leaf, version);
+}
 
-	// Error state.
-	//printf("Search for nonexistent pointer to node in parent.\n");
-	printf("Node:  %#lx\n", (unsigned long) n);
-	exit(RC_ERROR);
+// Descends along the first (or, if "last" is TRUE, the last) children to the leftmost (rightmost) leaf and returns it pinned,
+// and its version (see descend(...)).
+RC findOuterLeaf(BTreeManager * treeManager, bool last, Node * leaf, unsigned int * version) {
+	return descend(treeManager, NULL, last, NULL, leaf, version);
 }
 
-// Remove a record having the specified key from the the specified node.
-Node * removeEntryFromNode(BTreeManager * treeManager, Node * n, Value * key, Node * pointer) {
+// This function compares a DT_STRING key with the common prefix of the keys of a node. It returns a negative (positive) value
+// if the key is less (greater) than all keys of the node. Otherwise it returns 0 and the length of the prefix in "prefixLength".
+static int comparePrefix(char * key, int length, Node * node, int * prefixLength) {
+	int result;
 
-	//printf("\n INSIDE removeEntryFromNode KEY\n");
-	int i, num_pointers;
-	int bTreeOrder = treeManager->order;
+	// A reader may see a node which is being changed. It must not read outside the page, and its result does not matter.
+	*prefixLength = node->header->prefixLength;
+	if (*prefixLength < 0 || *prefixLength > MAX_STRING_KEY_LENGTH) {
+		*prefixLength = 0;
+		return 0;
+	}
 
-	// Remove the key and shift other keys accordingly.
-	i = 0;
-
-	while (!isEqual(n->keys[i], key))
-		i++;
-
-	for (++i; i < n->num_keys; i++)
-		n->keys[i - 1] = n->keys[i];
-
-	// Remove the pointer and shift other pointers accordingly.
-	// First determine number of pointers.
-	num_pointers = n->is_leaf ? n->num_keys : n->num_keys + 1;
-	i = 0;
-	while (n->pointers[i] != pointer)
-		i++;
-	for (++i; i < num_pointers; i++)
-		n->pointers[i - 1] = n->pointers[i];
-
-	// One key fewer.
-	n->num_keys--;
-	treeManager->numEntries--;
-
-	// Set the other pointers to NULL for tidiness.
-	// A leaf uses the last pointer to point to the next leaf.
-	if (n->is_leaf)
-		for (i = n->num_keys; i < bTreeOrder - 1; i++)
-			n->pointers[i] = NULL;
-	else
-		for (i = n->num_keys + 1; i < bTreeOrder; i++)
-			n->pointers[i] = NULL;
+	result = memcmp(key, getNodePrefix(node), length < *prefixLength ? length : *prefixLength);
+	if (result != 0)
+		return result;
 
-	return n;
+	// A key which is shorter than the prefix comes before all keys which start with it.
+	return length < *prefixLength ? -1 : 0;
 }
 
-// This function adjusts the root after a record has been deleted from the B+ Tree
-Node * adjustRoot(Node * root) {
+// This function compares the rest of a DT_STRING key after the common prefix of a node (with its head already extracted)
+// with the key at "index" of the node.
+static int compareString(char * key, int length, char * head, Node * node, int index) {
+	StringKey * slot = &((StringKey *) node->keys)[index];
+	int common = length < slot->length ? length : slot->length;
+	int result;
+
+	// Most keys differ in their first characters, which are in the key array.
+	result = memcmp(head, slot->head, STRING_KEY_HEAD);
+	if (result != 0)
+		return result;
+
+	// A reader may see a slot which is being changed. It must not read outside the page, and its result does not matter.
+	if (slot->offset > PAGE_SIZE - common)
+		return 0;
+	if (common > STRING_KEY_HEAD) {
+		result = memcmp(key + STRING_KEY_HEAD, node->page.data + slot->offset + STRING_KEY_HEAD, common - STRING_KEY_HEAD);
+		if (result != 0)
+			return result;
+	}
+	return length - slot->length;
+}
+
+// Returns the index of the first key of a node which is greater than the given key ("upper" is TRUE),
+// or greater than or equal to it ("upper" is FALSE). The keys are sorted, so the search halves the keys in question at every step.
+static int searchNode(Node * node, Value * key, bool upper) {
+	int low = 0;
+	int high = getNumKeys(node);
+	int middle, result;
+	char head[STRING_KEY_HEAD];
+	char * string;
+	int length, prefixLength;
+
+	switch (node->keyType) {
+	case DT_INT:
+		return searchIntKeys((int *) node->keys, high, key->v.intV, upper);
+	case DT_FLOAT:
+		return searchFloatKeys((float *) node->keys, high, key->v.floatV, upper);
+	case DT_BOOL:
+		return searchIntKeys((int *) node->keys, high, key->v.boolV != 0, upper);
+	case DT_STRING:
+		// A key which does not start with the common prefix of the node goes before or after all of its keys.
+		length = strlen(key->v.stringV);
+		result = comparePrefix(key->v.stringV, length, node, &prefixLength);
+		if (result != 0)
+			return result < 0 ? 0 : high;
+		string = key->v.stringV + prefixLength;
+		length -= prefixLength;
+		memset(head, 0, STRING_KEY_HEAD);
+		memcpy(head, string, length < STRING_KEY_HEAD ? length : STRING_KEY_HEAD);
+
+		// The keys before "low" come before the position we look for, the keys from "high" on do not.
+		while (low < high) {
+			middle = (low + high) / 2;
+			result = compareString(string, length, head, node, middle);
+			if (result > 0 || (upper && result == 0))
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		break;
+	}
+	return low;
+}
+
+// Returns the index of the first key of a node which is greater than or equal to the given key.
+int findEntry(Node * node, Value * key) {
+	return searchNode(node, key, FALSE);
+}
+
+// Returns the index of the first key of a node which is greater than the given key.
+int findEntryAfter(Node * node, Value * key) {
+	return searchNode(node, key, TRUE);
+}
+
+// Returns the index of the child of an internal node whose subtree contains the given key,
+// i.e. the child to the right of the last key which is less than or equal to the key.
+int findChild(Node * node, Value * key) {
+	return searchNode(node, key, TRUE);
+}
+
+// Finds the record (NodeData) to which a key refers.
+RC findRecord(BTreeManager * treeManager, Value * key, NodeData * record) {
+	Node leaf;
+	unsigned int version;
+	RID ref;
+	int i;
+	bool valid;
+	RC result;
+
+	do {
+		if ((result = findLeaf(treeManager, key, NULL, &leaf, &version)) != RC_OK)
+			return result;
+
+		// A key with several RIDs refers to the first RID of its posting list, which is read once the leaf is known to be right.
+		i = findEntry(&leaf, key);
+		result = RC_IM_KEY_NOT_FOUND;
+		if (i < getNumKeys(&leaf) && compareKey(key, &leaf, i) == 0) {
+			ref = leaf.pointers.rids[i];
+			result = RC_OK;
+		}
+		valid = checkVersion(&leaf, version);
+		if (valid && result == RC_OK)
+			result = getFirstPosting(treeManager, &ref, &record->rid);
+
+		// The posting list belongs to the leaf, so it has not changed either if the leaf has not.
+		valid = valid && checkVersion(&leaf, version);
+		releaseNode(treeManager, &leaf);
+	} while (!valid);
+	return result;
+}
+
+// Finds all RIDs of a key, in RID order. "numResults" is set to the number of RIDs of the key,
+// of which the first "maxResults" are stored in "results".
+RC findAllRecords(BTreeManager * treeManager, Value * key, RID * results, int maxResults, int * numResults) {
+	RID postings[MAX_POSTINGS_PER_PAGE];
+	PostingHeader header;
+	Node leaf;
+	unsigned int version;
+	RID ref;
+	int i, pageNum, stored;
+	bool valid;
+	RC result;
+
+	while (TRUE) {
+		*numResults = 0;
+		if ((result = findLeaf(treeManager, key, NULL, &leaf, &version)) != RC_OK)
+			return result;
+
+		i = findEntry(&leaf, key);
+		result = RC_IM_KEY_NOT_FOUND;
+		if (i < getNumKeys(&leaf) && compareKey(key, &leaf, i) == 0) {
+			ref = leaf.pointers.rids[i];
+			result = RC_OK;
+		}
+		valid = checkVersion(&leaf, version);
+
+		if (valid && result == RC_OK && ref.slot != POSTING_LIST_SLOT) {
+			if (maxResults > 0)
+				results[0] = ref;
+			*numResults = 1;
+		}
+
+		// Read the pages of the posting list until "results" is full. The first page knows the length of the whole list.
+		// The leaf stays pinned, so that its version tells whether the list has changed, before the next page is read.
+		for (pageNum = ref.page, stored = 0; valid && result == RC_OK && ref.slot == POSTING_LIST_SLOT && pageNum != NO_PAGE
+				&& (stored < maxResults || pageNum == ref.page); pageNum = header.next) {
+			result = readPostings(treeManager, pageNum, &header, postings);
+			if (!(valid = checkVersion(&leaf, version)) || result != RC_OK)
+				break;
+			if (pageNum == ref.page)
+				*numResults = header.count;
+			for (i = 0; i < header.numRids && stored < maxResults; i++)
+				results[stored++] = postings[i];
+		}
+
+		releaseNode(treeManager, &leaf);
+		if (valid)
+			return result;
+	}
+}
+
+// Number of keys ahead of the current one whose nodes findRecords(...) asks the buffer pool to load in the background.
+#define PROBE_PREFETCH_DISTANCE 8
+
+// Orders the keys given to findRecords(...) (used with qsort).
+static int compareProbes(const void * a, const void * b) {
+	return compareValues(((ProbeEntry *) a)->key, ((ProbeEntry *) b)->key);
+}
+
+// Asks the buffer pool to load the children of an internal node which the keys after the current one will visit
+// (the current key visits child "requested"),
+// up to PROBE_PREFETCH_DISTANCE keys ahead, so that reading them overlaps with the lookups before them.
+// "*prefetched" is the last key whose child on this level was requested already; every key is looked at about once per level.
+// The keys are sorted, so the search stops at the first key which may be beyond the node's last child.
+static void prefetchChildren(BTreeManager * treeManager, Node * node, int requested, ProbeEntry * probes, int current, int numProbes, int * prefetched) {
+	int last = current + PROBE_PREFETCH_DISTANCE < numProbes ? current + PROBE_PREFETCH_DISTANCE : numProbes - 1;
+	int p, child;
+
+	for (p = (*prefetched > current ? *prefetched : current) + 1; p <= last; p++) {
+		child = findChild(node, probes[p].key);
+		if (child == node->header->numKeys)
+			break;
+		if (child != requested) {
+			prefetchPages(&treeManager->bufferPool, node->pointers.children[child], 1);
+			requested = child;
+		}
+		*prefetched = p;
+	}
+}
 
-	Node * new_root;
+// Finds the records of "numKeys" keys at once. The RID of keys[i] is stored in results[i] and status[i] is set to
+// RC_OK, or to RC_IM_KEY_NOT_FOUND if the key is not in the B+ Tree.
+// The keys are looked up in sorted order, and the nodes of the previous descent stay pinned. A key only descends from the
+// lowest of these nodes whose key range contains it, so keys on the same leaf share the whole descent.
+// The pinned nodes are read without latches. Their versions tell whether they are still as they were read.
+RC findRecords(BTreeManager * treeManager, Value * keys, int numKeys, RID * results, RC * status) {
+	ProbeEntry * probes;
+	Node path[MAX_TREE_HEIGHT + 1];
+	unsigned int versions[MAX_TREE_HEIGHT + 1];
+	int childIndex[MAX_TREE_HEIGHT];
+	int prefetched[MAX_TREE_HEIGHT];
+	int depth = -1;		// Level of the pinned leaf in "path", -1 if no node is pinned
+	int level, i, p, entry, pageNum;
+	bool valid, found;
+	Value * key;
+	RID ref;
+	RC result = RC_OK;
+
+	for (i = 0; i < numKeys; i++)
+		status[i] = RC_IM_KEY_NOT_FOUND;
+	for (i = 0; i < MAX_TREE_HEIGHT; i++)
+		prefetched[i] = -1;
+	if (numKeys <= 0 || getRootPage(treeManager) == NO_PAGE)
+		return RC_OK;
+
+	probes = malloc(numKeys * sizeof(ProbeEntry));
+	if (probes == NULL)
+		return RC_ERROR;
+	for (i = 0; i < numKeys; i++) {
+		probes[i].key = &keys[i];
+		probes[i].index = i;
+	}
+	qsort(probes, numKeys, sizeof(ProbeEntry), compareProbes);
+
+	for (p = 0; p < numKeys; p++) {
+		key = probes[p].key;
+
+		do {
+			// Find the lowest pinned node whose range contains the key. The keys are sorted, so the key is never
+			// below a range. It is within the range of a child unless it reaches the key to the child's right.
+			level = depth < 0 ? -1 : 0;
+			while (level < depth && (childIndex[level] == getNumKeys(&path[level]) || compareKey(key, &path[level], childIndex[level]) < 0))
+				level++;
+
+			// That node and the nodes above it must not have changed since they were read, else the key starts at the root.
+			for (i = 0; i <= level && i <= depth && checkVersion(&path[i], versions[i]); i++)
+				;
+			if (i <= level && i <= depth)
+				level = -1;
+			for (i = depth; i > level; i--)
+				releaseNode(treeManager, &path[i]);
+			depth = level;
+
+			if (depth < 0) {
+				// An empty tree has none of the keys.
+				if ((pageNum = getRootPage(treeManager)) == NO_PAGE)
+					break;
+				if ((result = getNode(treeManager, pageNum, &path[0])) != RC_OK)
+					break;
+				versions[0] = readVersion(&path[0]);
+				depth = 0;
+			}
+
+			// Descend from that node to the leaf.
+			valid = depth > 0 || getRootPage(treeManager) == path[0].page.pageNum;
+			while (valid && !path[depth].header->isLeaf) {
+				childIndex[depth] = findChild(&path[depth], key);
+				prefetchChildren(treeManager, &path[depth], childIndex[depth], probes, p, numKeys, &prefetched[depth]);
+				pageNum = path[depth].pointers.children[childIndex[depth]];
+				if (!(valid = checkVersion(&path[depth], versions[depth])))
+					break;
+				if ((result = getNode(treeManager, pageNum, &path[depth + 1])) != RC_OK)
+					break;
+				versions[depth + 1] = readVersion(&path[depth + 1]);
+				depth++;
+				valid = checkVersion(&path[depth - 1], versions[depth - 1]);
+			}
+			if (result != RC_OK)
+				break;
+
+			if (valid) {
+				entry = findEntry(&path[depth], key);
+				found = entry < getNumKeys(&path[depth]) && compareKey(key, &path[depth], entry) == 0;
+				if (found)
+					ref = path[depth].pointers.rids[entry];
+				valid = checkVersion(&path[depth], versions[depth]);
+				if (valid && found) {
+					status[probes[p].index] = getFirstPosting(treeManager, &ref, &results[probes[p].index]);
+					valid = checkVersion(&path[depth], versions[depth]);
+				}
+			}
+
+			// Another thread changed a node on the way. Look the key up again from the root.
+			if (!valid) {
+				for (i = depth; i >= 0; i--)
+					releaseNode(treeManager, &path[i]);
+				depth = -1;
+				status[probes[p].index] = RC_IM_KEY_NOT_FOUND;
+			}
+		} while (!valid);
+		if (result != RC_OK)
+			break;
+	}
+
+	// The keys which were not looked up because of an error get its error code.
+	for (i = p; i < numKeys; i++)
+		status[probes[i].index] = result;
+	for (i = depth; i >= 0; i--)
+		releaseNode(treeManager, &path[i]);
+
+	free(probes);
+	return result;
+}
+
+/*********** DELETION *************/
+
+// Remove the key at "index" and the pointer that goes with it from the the specified node.
+// In an internal node that is the child to the right of the key.
+void removeEntryFromNode(Node * n, int index) {
+	int num_moved = n->header->numKeys - index - 1;
+
+	moveKeys(n, index, index + 1, num_moved);
+	if (n->header->isLeaf)
+		memmove(&n->pointers.rids[index], &n->pointers.rids[index + 1], num_moved * sizeof(RID));
+	else
+		memmove(&n->pointers.children[index + 1], &n->pointers.children[index + 2], num_moved * sizeof(int));
+	n->header->numKeys--;
+}
+
+// Puts a node which is no longer part of the tree on the list of free pages and releases it.
+RC freeNode(BTreeManager * treeManager, Node * n) {
+	resetNode(n);
+	treeManager->numNodes--;
+	releasePage(treeManager, &n->page);
+	return RC_OK;
+}
+
+// This function adjusts the root after a record has been deleted from the B+ Tree. The root is released.
+RC adjustRoot(BTreeManager * treeManager, Node * root) {
 
 	// If the root is not empty then it means that key and pointer has been deleted already.
-	// Do nothing and return the root.
-	if (root->num_keys > 0)
-		return root;
-
-	if (!root->is_leaf) {
-		//If the root is not empty and if it has a child, promote
-		// the first (only) child as the new root.
-		new_root = root->pointers[0];
-		new_root->parent = NULL;
+	// Do nothing.
+	if (root->header->numKeys > 0) {
+		releaseNode(treeManager, root);
+		return RC_OK;
+	}
+
+	if (!root->header->isLeaf) {
+		// If the root is empty and if it has a child, promote the first (only) child as the new root.
+		setRootPage(treeManager, root->pointers.children[0]);
 	} else {
-		// If the root is not empty and if it is a leaf (has no children), then the whole tree is empty.
-		new_root = NULL;
+		// If the root is empty and if it is a leaf (has no children), then the whole tree is empty.
+		setRootPage(treeManager, NO_PAGE);
 	}
 
-	// De-allocate memory space... Free up space...
-	free(root->keys);
-	free(root->pointers);
-	free(root);
+	// Give the page of the old root back.
+	return freeNode(treeManager, root);
+}
 
-	return new_root;
+// Finds the first and the last key of the node which results from merging node "right" into node "left" (with the key "middle"
+// between them, if it is not NULL). Returns FALSE if the merged node has no keys.
+static bool getMergedKeys(Node * left, NodeKey * middle, Node * right, NodeKey * first, NodeKey * last) {
+	int numLeft = left->header->numKeys;
+	int numRight = right->header->numKeys;
+
+	if (numLeft > 0)
+		getKey(left, 0, first);
+	else if (middle != NULL)
+		*first = *middle;
+	else if (numRight > 0)
+		getKey(right, 0, first);
+	else
+		return FALSE;
+
+	if (numRight > 0)
+		getKey(right, numRight - 1, last);
+	else if (middle != NULL)
+		*last = *middle;
+	else
+		getKey(left, numLeft - 1, last);
+	return TRUE;
 }
 
-// Combines a node that has become too small after deletion with a neighboring node that
-// can accept the additional entries without exceeding the maximum.
-Node * mergeNodes(BTreeManager * treeManager, Node * n, Node * neighbor, int neighbor_index, int k_prime) {
+// Returns TRUE if the characters of the keys of node "right" (and of the key "middle" between the two nodes, if it is not NULL)
+// fit into node "left" together with its own keys. The merged node stores the common prefix of all of its keys once.
+static bool hasRoomToMerge(Node * left, NodeKey * middle, Node * right) {
+	NodeKey first, last;
+	int prefixLength, space;
 
-	int i, j, neighbor_insertion_index, n_end;
+	if (left->keyType != DT_STRING || !getMergedKeys(left, middle, right, &first, &last))
+		return TRUE;
+
+	prefixLength = getCommonLength(first.v.stringV, last.v.stringV, MAX_STRING_KEY_LENGTH);
+	space = prefixLength + getSuffixSpace(left, prefixLength) + getSuffixSpace(right, prefixLength);
+	if (middle != NULL)
+		space += strlen(middle->v.stringV) - prefixLength;
+	return space <= PAGE_SIZE - left->heapBase;
+}
+
+// Combines a node that has become too small after deletion with a neighboring node that
+// can accept the additional entries without exceeding the maximum. All three nodes are released.
+RC mergeNodes(BTreeManager * treeManager, NodePath * path, Node * n, Node * neighbor, int neighbor_index, Node * parent, int k_prime_index) {
+	int i;
 	Node * tmp;
-	int bTreeOrder = treeManager->order;
+	NodeKey key, first, last;
+	RC result;
 
 	// Swap neighbor with node if node is on the extreme left and neighbor is to its right.
 	if (neighbor_index == -1) {
@@ -480,72 +1632,57 @@ Node * mergeNodes(BTreeManager * treeManager, Node * n, Node * neighbor, int nei
 		neighbor = tmp;
 	}
 
-	// Starting point in the neighbor for copying keys and pointers from n.
-	// n and neighbor have swapped places in the special case of n being a leftmost child.
-	neighbor_insertion_index = neighbor->num_keys;
-
-	// If its a non-leaf node, append k_prime and the following pointer.
-	// Also, append all pointers and keys from the neighbor.
-	if (!n->is_leaf) {
-		neighbor->keys[neighbor_insertion_index] = k_prime;
-		neighbor->num_keys++;
-
-		n_end = n->num_keys;
-
-		for (i = neighbor_insertion_index + 1, j = 0; j < n_end; i++, j++) {
-			neighbor->keys[i] = n->keys[j];
-			neighbor->pointers[i] = n->pointers[j];
-			neighbor->num_keys++;
-			n->num_keys--;
-		}
+	// In a leaf, point n's next leaf back to the neighbor first, so that nothing has been changed yet if that fails.
+	if (n->header->isLeaf && n->header->next != NO_PAGE && (result = setPrevLeaf(treeManager, n->header->next, neighbor->page.pageNum)) != RC_OK) {
+		releaseNode(treeManager, n);
+		releaseNode(treeManager, neighbor);
+		releaseNode(treeManager, parent);
+		return result;
+	}
 
-		neighbor->pointers[i] = n->pointers[j];
+	// The neighbor gets the common prefix of all keys of the merged node, so that their characters fit (see hasRoomToMerge(...)).
+	if (!n->header->isLeaf)
+		getKey(parent, k_prime_index, &key);
+	if (neighbor->keyType == DT_STRING && getMergedKeys(neighbor, n->header->isLeaf ? NULL : &key, n, &first, &last))
+		compactStrings(neighbor, -1, first.v.stringV, getCommonLength(first.v.stringV, last.v.stringV, MAX_STRING_KEY_LENGTH));
 
-		// Pointing all children to the same parent.
-		for (i = 0; i < neighbor->num_keys + 1; i++) {
-			tmp = (Node *) neighbor->pointers[i];
-			tmp->parent = neighbor;
+	// n and neighbor have swapped places in the special case of n being a leftmost child.
+	// Append all keys and pointers of n to the neighbor.
+	if (!n->header->isLeaf) {
+		// If its a non-leaf node, append k_prime and the first child of n first.
+		appendKey(neighbor, &key);
+		neighbor->pointers.children[neighbor->header->numKeys] = n->pointers.children[0];
+
+		for (i = 0; i < n->header->numKeys; i++) {
+			getKey(n, i, &key);
+			appendKey(neighbor, &key);
+			neighbor->pointers.children[neighbor->header->numKeys] = n->pointers.children[i + 1];
 		}
 	} else {
-		// In a leaf, append the keys and pointers of n to the neighbor.
-		// Set the neighbor's last pointer to point to what had been n's right neighbor.
-		for (i = neighbor_insertion_index, j = 0; j < n->num_keys; i++, j++) {
-			neighbor->keys[i] = n->keys[j];
-			neighbor->pointers[i] = n->pointers[j];
-			neighbor->num_keys++;
+		for (i = 0; i < n->header->numKeys; i++) {
+			getKey(n, i, &key);
+			appendKey(neighbor, &key);
+			neighbor->pointers.rids[neighbor->header->numKeys - 1] = n->pointers.rids[i];
 		}
-		neighbor->pointers[bTreeOrder - 1] = n->pointers[bTreeOrder - 1];
+
+		// In a leaf, set the neighbor's next leaf to what had been n's next leaf (which points back to the neighbor already).
+		neighbor->header->next = n->header->next;
 	}
 
-	treeManager->root = deleteEntry(treeManager, n->parent, k_prime, n);
+	markNodeDirty(treeManager, neighbor);
+	releaseNode(treeManager, neighbor);
+	freeNode(treeManager, n);
 
-	// De-allocate memory space... Free up space...
-	free(n->keys);
-	free(n->pointers);
-	free(n);
-	return treeManager->root;
+	// Remove k_prime and the pointer to n from the parent.
+	return deleteEntry(treeManager, path, parent, k_prime_index);
 }
 
-// This function deletes an entry from the B+ tree. It removes the record having the specified key and pointer
-// from the leaf, and then makes all appropriate changes to preserve the B+ tree properties.
-Node * deleteEntry(BTreeManager * treeManager, Node * n, Value * key, void * pointer) {
-	//printf("\n INSIDE DELETE ENTRY \n");
-	int min_keys;
-	Node * neighbor;
-	int neighbor_index;
-	int k_prime_index, k_prime;
-	int capacity;
+// Returns the minimum number of keys of a node other than the root.
+static int getMinKeys(BTreeManager * treeManager, bool isLeaf) {
 	int bTreeOrder = treeManager->order;
+	int min_keys;
 
-	// Remove key and pointer from node.
-	n = removeEntryFromNode(treeManager, n, key, pointer);
-
-	// If n is root then perform adjustements
-	if (n == treeManager->root)
-		return adjustRoot(treeManager->root);
-
-	// Determine minimum allowable size of node, to be preserved after deletion.
-	if (n->is_leaf) {
+	if (isLeaf) {
 		if ((bTreeOrder - 1) % 2 == 0)
 			min_keys = (bTreeOrder - 1) / 2;
 		else
@@ -557,232 +1694,1138 @@ Node * deleteEntry(BTreeManager * treeManager, Node * n, Value * key, void * poi
 			min_keys = (bTreeOrder) / 2 + 1;
 		min_keys--;
 	}
+	return min_keys;
+}
+
+// Returns TRUE if a node other than the root is too small without the key at "removed" (or, if it is -1, as it is),
+// so that it is merged with a neighbor or takes a key from it. A DT_STRING node whose characters filled the page may have
+// been split with fewer keys than the minimum, so it is only too small if its characters take less than half of the space.
+static bool isUnderflow(BTreeManager * treeManager, Node * node, int removed) {
+	int numKeys = node->header->numKeys - (removed >= 0);
+	int space;
+
+	if (numKeys >= getMinKeys(treeManager, node->header->isLeaf))
+		return FALSE;
+	if (node->keyType != DT_STRING)
+		return TRUE;
+	space = getStringSpace(node);
+	if (removed >= 0)
+		space -= ((StringKey *) node->keys)[removed].length;
+	return 2 * space < PAGE_SIZE - node->heapBase;
+}
+
+// This function deletes the entry at "index" of node "n" (which is latched already and is released) and then makes all
+// appropriate changes to preserve the B+ tree properties. The parent of "n" is the last node of "path".
+RC deleteEntry(BTreeManager * treeManager, NodePath * path, Node * n, int index) {
+	Node parent, neighbor;
+	NodeKey k_prime;
+	int neighbor_index, neighbor_page;
+	int k_prime_index;
+	int capacity;
+	int bTreeOrder = treeManager->order;
+	RC result;
+
+	// Remove key and pointer from node.
+	removeEntryFromNode(n, index);
+	markNodeDirty(treeManager, n);
+
+	// If n is root then perform adjustements
+	if (path->depth == 0)
+		return adjustRoot(treeManager, n);
 
 	// Node stays at or above minimum.
-	if (n->num_keys >= min_keys)
-		return treeManager->root;
+	if (!isUnderflow(treeManager, n, -1)) {
+		releaseNode(treeManager, n);
+		return RC_OK;
+	}
 
 	// If the node falls below minimum, either merging or redistribution is needed.
 	// Find the appropriate neighbor node with which to merge. Also find the key (k_prime)
 	// in the parent between the pointer to node n and the pointer to the neighbor.
-	neighbor_index = getNeighborIndex(n);
+	path->depth--;
+	if ((result = getNode(treeManager, path->pages[path->depth], &parent)) != RC_OK) {
+		releaseNode(treeManager, n);
+		return result;
+	}
+
+	// A parent which kept a single child (see redistributeNodes(...)) has no neighbor for n.
+	if (parent.header->numKeys == 0) {
+		releaseNode(treeManager, &parent);
+		releaseNode(treeManager, n);
+		return RC_OK;
+	}
+	neighbor_index = path->indexes[path->depth] - 1;
 	k_prime_index = neighbor_index == -1 ? 0 : neighbor_index;
-	k_prime = n->parent->keys[k_prime_index];
-	neighbor =
-			(neighbor_index == -1) ? n->parent->pointers[1] : n->parent->pointers[neighbor_index];
+	neighbor_page = parent.pointers.children[neighbor_index == -1 ? 1 : neighbor_index];
+	if ((result = getNode(treeManager, neighbor_page, &neighbor)) != RC_OK) {
+		releaseNode(treeManager, &parent);
+		releaseNode(treeManager, n);
+		return result;
+	}
+
+	// The parent and the neighbor change with n. A neighboring leaf may be latched by an insert or delete which only changes it.
+	if ((result = latchModifiedNode(treeManager, &parent)) != RC_OK || (result = latchModifiedNode(treeManager, &neighbor)) != RC_OK) {
+		releaseNode(treeManager, &neighbor);
+		releaseNode(treeManager, &parent);
+		releaseNode(treeManager, n);
+		return result;
+	}
 
-	capacity = n->is_leaf ? bTreeOrder : bTreeOrder - 1;
+	capacity = n->header->isLeaf ? bTreeOrder : bTreeOrder - 1;
+	if (!n->header->isLeaf)
+		getKey(&parent, k_prime_index, &k_prime);
 
-	if (neighbor->num_keys + n->num_keys < capacity)
+	if (neighbor.header->numKeys + n->header->numKeys < capacity
+			&& (neighbor_index == -1 ? hasRoomToMerge(n, n->header->isLeaf ? NULL : &k_prime, &neighbor)
+									: hasRoomToMerge(&neighbor, n->header->isLeaf ? NULL : &k_prime, n)))
 		// Merging
-		return mergeNodes(treeManager, n, neighbor, neighbor_index, k_prime);
+		return mergeNodes(treeManager, path, n, &neighbor, neighbor_index, &parent, k_prime_index);
 	else
 		// Re-distributing
-		return redistributeNodes(treeManager->root, n, neighbor, neighbor_index, k_prime_index, k_prime);
+		return redistributeNodes(treeManager, n, &neighbor, neighbor_index, &parent, k_prime_index);
 }
 
-// This function deletes the the entry/record having the specified key.
-Node * delete(BTreeManager * treeManager, Value * key) {
-	//printf("\n INSIDE DELETE()...");
-
-	Node * record = findRecord(treeManager->root, key);
-	NodeData * key_leaf = findLeaf(treeManager->root, key);
+// Deletes the entry with the key, or only the RID "rid" of the key (see delete(...)). If "restructure" is FALSE, only
+// the leaf (and the key's posting list) is changed, and "done" is set to FALSE if the delete needs a structure modification
+// instead. Otherwise the caller holds structureLatch and releases the latched nodes afterwards.
+static RC deleteRecord(BTreeManager * treeManager, Value * key, RID * rid, bool restructure, bool * done) {
+	NodePath path;
+	Node leaf;
+	unsigned int version;
+	RID * ref;
+	int index, numRids;
+	RC result = RC_OK;
+
+	*done = TRUE;
+	while (TRUE) {
+		if ((result = findLeaf(treeManager, key, &path, &leaf, &version)) != RC_OK)
+			return result;
+
+		// Latch the leaf. Without structureLatch, the leaf must not have changed since it was found.
+		if (restructure) {
+			if ((result = latchModifiedNode(treeManager, &leaf)) != RC_OK) {
+				releaseNode(treeManager, &leaf);
+				return result;
+			}
+			break;
+		}
+		if (tryLatchNode(&leaf, version))
+			break;
+		releaseNode(treeManager, &leaf);
+	}
 
-	if (record != NULL && key_leaf != NULL) {
-		treeManager->root = deleteEntry(treeManager, key_leaf, key, record);
-		free(record);
+	index = findEntry(&leaf, key);
+	ref = &leaf.pointers.rids[index];
+	if (index == leaf.header->numKeys || compareKey(key, &leaf, index) != 0)
+		result = RC_IM_KEY_NOT_FOUND;
+	else if (rid != NULL && ref->slot == POSTING_LIST_SLOT) {
+		// Remove the RID from the key's posting list, which keeps at least one RID.
+		if ((result = removePosting(treeManager, ref, *rid)) == RC_OK) {
+			__sync_fetch_and_sub(&treeManager->numEntries, 1);
+			markNodeDirty(treeManager, &leaf);
+		}
+	} else if (rid != NULL && compareRids(*ref, *rid) != 0)
+		result = RC_IM_KEY_NOT_FOUND;
+	else if (!restructure && (path.depth == 0 ? leaf.header->numKeys <= 1 : isUnderflow(treeManager, &leaf, index)))
+		// The leaf would become too small (or the tree empty).
+		*done = FALSE;
+	else {
+		// The entry is removed from the leaf together with the pages of its posting list.
+		numRids = 1;
+		if (ref->slot == POSTING_LIST_SLOT && (result = freePostingList(treeManager, ref->page, &numRids)) != RC_OK) {
+			if (!restructure)
+				unlatchNode(&leaf);
+			releaseNode(treeManager, &leaf);
+			return result;
+		}
+		__sync_fetch_and_sub(&treeManager->numEntries, numRids);
+		if (restructure)
+			return deleteEntry(treeManager, &path, &leaf, index);
+		removeEntryFromNode(&leaf, index);
+		markNodeDirty(treeManager, &leaf);
 	}
-	//printf("\n EXITING DELETE()...");
-	return treeManager->root;
+
+	if (!restructure)
+		unlatchNode(&leaf);
+	releaseNode(treeManager, &leaf);
+	return result;
+}
+
+// This function deletes the the entry/record having the specified key. If "rid" is not NULL, only that RID of the key
+// is deleted, and the key stays as long as it has other RIDs. Otherwise the key is deleted with all of its RIDs.
+// Most deletes only change their leaf, which they latch while other threads use the rest of the tree. A delete which
+// leaves the leaf too small is done again as a structure modification.
+RC delete(BTreeManager * treeManager, Value * key, RID * rid) {
+	bool done;
+	RC result;
+
+	result = deleteRecord(treeManager, key, rid, FALSE, &done);
+	if (done)
+		return result;
+
+	pthread_mutex_lock(&treeManager->structureLatch);
+	result = deleteRecord(treeManager, key, rid, TRUE, &done);
+	unlatchModifiedNodes(treeManager);
+	pthread_mutex_unlock(&treeManager->structureLatch);
+	return result;
 }
 
 // This function redistributes the entries between two nodes when one has become too small after deletion
-// but its neighbor is too big to append the small node's entries without exceeding the maximum
-Node * redistributeNodes(Node * root, Node * n, Node * neighbor, int neighbor_index, int k_prime_index, int k_prime) {
-	int i;
-	Node * tmp;
+// but its neighbor is too big to append the small node's entries without exceeding the maximum.
+// All three nodes are released.
+RC redistributeNodes(BTreeManager * treeManager, Node * n, Node * neighbor, int neighbor_index, Node * parent, int k_prime_index) {
+	int n_keys = n->header->numKeys;
+	int neighbor_keys = neighbor->header->numKeys;
+	NodeKey key, separator, other;
+
+	// Find the key n gets and the key which separates n and the neighbor afterwards.
+	// In a leaf the moved key goes with its RID, and the separator is the shortest key between the two leaves.
+	if (neighbor_index != -1) {
+		if (!n->header->isLeaf) {
+			getKey(parent, k_prime_index, &key);
+			getKey(neighbor, neighbor_keys - 1, &separator);
+		} else if (neighbor_keys > 1) {
+			getKey(neighbor, neighbor_keys - 1, &key);
+			getKey(neighbor, neighbor_keys - 2, &other);
+			getSeparator(&other, &key, &separator);
+		}
+	} else {
+		if (!n->header->isLeaf) {
+			getKey(parent, k_prime_index, &key);
+			getKey(neighbor, 0, &separator);
+		} else if (neighbor_keys > 1) {
+			getKey(neighbor, 0, &key);
+			getKey(neighbor, 1, &other);
+			getSeparator(&key, &other, &separator);
+		}
+	}
+
+	// The characters of DT_STRING keys of very different lengths may not fit. Then n stays smaller than the minimum.
+	if (neighbor_keys < (n->header->isLeaf ? 2 : 1) || !hasRoomForKey(n, &key, -1) || !hasRoomForKey(parent, &separator, k_prime_index)) {
+		releaseNode(treeManager, n);
+		releaseNode(treeManager, neighbor);
+		releaseNode(treeManager, parent);
+		return RC_OK;
+	}
 
 	if (neighbor_index != -1) {
 		// If n has neighbor to the left, pull the neighbor's last key-pointer pair over from the neighbor's right end to n's left end.
-		if (!n->is_leaf)
-			n->pointers[n->num_keys + 1] = n->pointers[n->num_keys];
-		for (i = n->num_keys; i > 0; i--) {
-			n->keys[i] = n->keys[i - 1];
-			n->pointers[i] = n->pointers[i - 1];
-		}
-		if (!n->is_leaf) {
-			n->pointers[0] = neighbor->pointers[neighbor->num_keys];
-			tmp = (Node *) n->pointers[0];
-			tmp->parent = n;
-			neighbor->pointers[neighbor->num_keys] = NULL;
-			n->keys[0] = k_prime;
-			n->parent->keys[k_prime_index] = neighbor->keys[neighbor->num_keys - 1];
+		moveKeys(n, 1, 0, n_keys);
+		n->header->numKeys++;
+		if (!n->header->isLeaf) {
+			memmove(&n->pointers.children[1], &n->pointers.children[0], (n_keys + 1) * sizeof(int));
+			n->pointers.children[0] = neighbor->pointers.children[neighbor_keys];
 		} else {
-			n->pointers[0] = neighbor->pointers[neighbor->num_keys - 1];
-			neighbor->pointers[neighbor->num_keys - 1] = NULL;
-			n->keys[0] = neighbor->keys[neighbor->num_keys - 1];
-			n->parent->keys[k_prime_index] = n->keys[0];
+			memmove(&n->pointers.rids[1], &n->pointers.rids[0], n_keys * sizeof(RID));
+			n->pointers.rids[0] = neighbor->pointers.rids[neighbor_keys - 1];
 		}
+		setKey(n, 0, &key);
+		setKey(parent, k_prime_index, &separator);
 	} else {
 		// If n is the leftmost child, take a key-pointer pair from the neighbor to the right.
 		// Move the neighbor's leftmost key-pointer pair to n's rightmost position.
-		if (n->is_leaf) {
-			n->keys[n->num_keys] = neighbor->keys[0];
-			n->pointers[n->num_keys] = neighbor->pointers[0];
-			n->parent->keys[k_prime_index] = neighbor->keys[1];
+		n->header->numKeys++;
+		setKey(n, n_keys, &key);
+		setKey(parent, k_prime_index, &separator);
+		if (n->header->isLeaf) {
+			n->pointers.rids[n_keys] = neighbor->pointers.rids[0];
+			memmove(&neighbor->pointers.rids[0], &neighbor->pointers.rids[1], (neighbor_keys - 1) * sizeof(RID));
 		} else {
-			n->keys[n->num_keys] = k_prime;
-			n->pointers[n->num_keys + 1] = neighbor->pointers[0];
-			tmp = (Node *) n->pointers[n->num_keys + 1];
-			tmp->parent = n;
-			n->parent->keys[k_prime_index] = neighbor->keys[0];
-		}
-		for (i = 0; i < neighbor->num_keys - 1; i++) {
-			neighbor->keys[i] = neighbor->keys[i + 1];
-			neighbor->pointers[i] = neighbor->pointers[i + 1];
+			n->pointers.children[n_keys + 1] = neighbor->pointers.children[0];
+			memmove(&neighbor->pointers.children[0], &neighbor->pointers.children[1], neighbor_keys * sizeof(int));
 		}
-		if (!n->is_leaf)
-			neighbor->pointers[i] = neighbor->pointers[i + 1];
+		moveKeys(neighbor, 0, 1, neighbor_keys - 1);
 	}
 
 	// n now has one more key and one more pointer; the neighbor has one fewer of each.
-	n->num_keys++;
-	neighbor->num_keys--;
+	neighbor->header->numKeys--;
+
+	markNodeDirty(treeManager, n);
+	markNodeDirty(treeManager, neighbor);
+	markNodeDirty(treeManager, parent);
+	releaseNode(treeManager, n);
+	releaseNode(treeManager, neighbor);
+	releaseNode(treeManager, parent);
+	return RC_OK;
+}
+
+/*********** POSTING LISTS *************/
+
+// Bytes of a posting list page available for the RIDs after the first one
+#define POSTING_SPACE (PAGE_SIZE - (int) sizeof(PostingHeader))
+
+// Compares two RIDs by page and then by slot, which is the order of the RIDs in a posting list.
+int compareRids(RID rid, RID other) {
+	if (rid.page != other.page)
+		return (rid.page > other.page) - (rid.page < other.page);
+	return (rid.slot > other.slot) - (rid.slot < other.slot);
+}
+
+// Returns the two numbers which store "rid" after "previous" on a posting list page.
+static void getRidDelta(RID previous, RID rid, unsigned int * pages, unsigned int * slot) {
+	*pages = rid.page - previous.page;
+	*slot = *pages == 0 ? rid.slot - previous.slot : rid.slot;
+}
+
+// Returns the number of bytes a number takes with 7 bits per byte.
+static int getVarintLength(unsigned int value) {
+	int length = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		length++;
+	}
+	return length;
+}
+
+// Returns the number of bytes "rid" takes after "previous" on a posting list page.
+static int getRidLength(RID previous, RID rid) {
+	unsigned int pages, slot;
+
+	getRidDelta(previous, rid, &pages, &slot);
+	return getVarintLength(pages) + getVarintLength(slot);
+}
+
+// Stores a number with 7 bits per byte, lowest bits first. The highest bit of a byte is set if more bytes follow.
+static char * putVarint(char * out, unsigned int value) {
+	while (value >= 0x80) {
+		*out++ = (char) (value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (char) value;
+	return out;
+}
+
+// Reads a number stored by putVarint(...) and returns the position after it. It reads at most five bytes.
+static char * getVarint(char * in, unsigned int * value) {
+	int shift = 0;
+
+	*value = 0;
+	while ((*in & 0x80) && shift < 28) {
+		*value |= (unsigned int) (*in++ & 0x7F) << shift;
+		shift += 7;
+	}
+	*value |= (unsigned int) (unsigned char) *in++ << shift;
+	return in;
+}
+
+// Stores "rid" after the last RID of a posting list page, which must have room for it.
+static void appendPosting(PostingHeader * header, RID rid) {
+	char * data = (char *) (header + 1);
+	char * out = data + header->used;
+	unsigned int pages, slot;
+
+	getRidDelta(header->last, rid, &pages, &slot);
+	out = putVarint(putVarint(out, pages), slot);
+	header->used = out - data;
+	header->last = rid;
+	header->numRids++;
+}
+
+// Stores "numRids" sorted RIDs on a posting list page in place of the RIDs which were on it. They must fit.
+static void writePostings(PostingHeader * header, RID * rids, int numRids) {
+	int i;
+
+	header->numRids = 1;
+	header->used = 0;
+	header->first = rids[0];
+	header->last = rids[0];
+	for (i = 1; i < numRids; i++)
+		appendPosting(header, rids[i]);
+}
+
+// Reads the RIDs of a posting list page with the header "header" and the RIDs "in" into "rids" and returns their number.
+// It stops at the end of the used bytes, reading at most ten bytes beyond them.
+static int decodePostings(PostingHeader * header, char * in, RID * rids) {
+	char * end = in + header->used;
+	unsigned int pages, slot;
+	int i;
+
+	rids[0] = header->first;
+	for (i = 1; i < header->numRids && in < end; i++) {
+		in = getVarint(getVarint(in, &pages), &slot);
+		rids[i].page = rids[i - 1].page + pages;
+		rids[i].slot = pages == 0 ? rids[i - 1].slot + slot : slot;
+	}
+	return i;
+}
+
+// Returns the number of bytes the RIDs after the first one take on a posting list page.
+static int getPostingsLength(RID * rids, int numRids) {
+	int length = 0;
+	int i;
+
+	for (i = 1; i < numRids; i++)
+		length += getRidLength(rids[i - 1], rids[i]);
+	return length;
+}
+
+// Sets the next page (if "next" is TRUE) or the previous page of the posting list page "pageNum" to "link".
+static RC setPostingLink(BTreeManager * treeManager, int pageNum, bool next, int link) {
+	BM_PageHandle page;
+	RC result;
+
+	if ((result = pinPage(&treeManager->bufferPool, &page, pageNum)) != RC_OK)
+		return result;
+	if (next)
+		((PostingHeader *) page.data)->next = link;
+	else
+		((PostingHeader *) page.data)->prev = link;
+	markDirty(&treeManager->bufferPool, &page);
+	return unpinPage(&treeManager->bufferPool, &page);
+}
+
+// Adds a new page with "numRids" sorted RIDs to a posting list right after the pinned page "page".
+// "head" is the first page of the list, which records the last page.
+static RC insertPostingPage(BTreeManager * treeManager, PostingHeader * head, BM_PageHandle * page, RID * rids, int numRids) {
+	PostingHeader * header = (PostingHeader *) page->data;
+	PostingHeader * newHeader;
+	BM_PageHandle newPage;
+	RC result;
+
+	if ((result = allocatePage(treeManager, &newPage)) != RC_OK)
+		return result;
+	newHeader = (PostingHeader *) newPage.data;
+	writePostings(newHeader, rids, numRids);
+	newHeader->prev = page->pageNum;
+	newHeader->next = header->next;
+	newHeader->tail = NO_PAGE;
+	newHeader->count = 0;
+
+	if (header->next == NO_PAGE)
+		head->tail = newPage.pageNum;
+	else if ((result = setPostingLink(treeManager, header->next, FALSE, newPage.pageNum)) != RC_OK) {
+		releasePage(treeManager, &newPage);
+		return result;
+	}
+	header->next = newPage.pageNum;
 
-	return root;
+	markDirty(&treeManager->bufferPool, &newPage);
+	return unpinPage(&treeManager->bufferPool, &newPage);
 }
 
-/*********** PRINTING *************/
+// Stores the sorted RIDs of a key on as many new posting list pages as they need. "firstPage" is set to the first page.
+RC createPostingList(BTreeManager * treeManager, RID * rids, int numRids, int * firstPage) {
+	BM_PageHandle page, previous;
+	PostingHeader * header;
+	int start, end, length, size, freed;
+	RC result;
+
+	// Fill one page after the other with as many RIDs as fit.
+	for (start = 0; start < numRids; start = end) {
+		if ((result = allocatePage(treeManager, &page)) != RC_OK) {
+			// The pages filled so far end the list, so they can be given back like a whole list.
+			if (start > 0) {
+				markDirty(&treeManager->bufferPool, &previous);
+				unpinPage(&treeManager->bufferPool, &previous);
+				freePostingList(treeManager, *firstPage, &freed);
+			}
+			return result;
+		}
+
+		for (end = start + 1, length = 0; end < numRids && length + (size = getRidLength(rids[end - 1], rids[end])) <= POSTING_SPACE; end++)
+			length += size;
+		header = (PostingHeader *) page.data;
+		writePostings(header, rids + start, end - start);
+		header->next = NO_PAGE;
+		header->tail = NO_PAGE;
+		header->count = 0;
+
+		if (start == 0) {
+			*firstPage = page.pageNum;
+			header->prev = NO_PAGE;
+		} else {
+			header->prev = previous.pageNum;
+			((PostingHeader *) previous.data)->next = page.pageNum;
+			markDirty(&treeManager->bufferPool, &previous);
+			unpinPage(&treeManager->bufferPool, &previous);
+		}
+		previous = page;
+	}
+	markDirty(&treeManager->bufferPool, &previous);
+	unpinPage(&treeManager->bufferPool, &previous);
 
-// This function helps in printing the B+ Tree
-void enqueue(BTreeManager * treeManager, Node * new_node) {
-	Node * c;
-	if (treeManager->queue == NULL) {
-		treeManager->queue = new_node;
-		treeManager->queue->next = NULL;
+	// The first page records the last page and the length of the whole list.
+	if ((result = pinPage(&treeManager->bufferPool, &page, *firstPage)) != RC_OK) {
+		freePostingList(treeManager, *firstPage, &freed);
+		return result;
+	}
+	header = (PostingHeader *) page.data;
+	header->tail = previous.pageNum;
+	header->count = numRids;
+	markDirty(&treeManager->bufferPool, &page);
+	return unpinPage(&treeManager->bufferPool, &page);
+}
+
+// Copies the header of the posting list page "pageNum" into "header" and its RIDs into "rids",
+// which has room for MAX_POSTINGS_PER_PAGE RIDs.
+// Readers do not latch the page, which may change while it is copied. The caller checks the version of the key's
+// leaf afterwards, so the copy only needs to stay within its buffers.
+RC readPostings(BTreeManager * treeManager, int pageNum, PostingHeader * header, RID * rids) {
+	char data[POSTING_SPACE + 16];
+	BM_PageHandle page;
+	RC result;
+
+	if ((result = pinPage(&treeManager->bufferPool, &page, pageNum)) != RC_OK)
+		return result;
+	memcpy(header, page.data, sizeof(PostingHeader));
+	memcpy(data, page.data + sizeof(PostingHeader), POSTING_SPACE);
+	memset(data + POSTING_SPACE, 0, 16);
+	if ((result = unpinPage(&treeManager->bufferPool, &page)) != RC_OK)
+		return result;
+
+	if (header->numRids < 1 || header->numRids > MAX_POSTINGS_PER_PAGE)
+		header->numRids = 1;
+	if (header->used < 0 || header->used > POSTING_SPACE)
+		header->used = 0;
+	header->numRids = decodePostings(header, data, rids);
+	return RC_OK;
+}
+
+// Returns the first RID of a key whose RID in its leaf is "ref": "ref" itself, or the first RID of its posting list.
+RC getFirstPosting(BTreeManager * treeManager, RID * ref, RID * rid) {
+	BM_PageHandle page;
+	RC result;
+
+	if (ref->slot != POSTING_LIST_SLOT) {
+		*rid = *ref;
+		return RC_OK;
+	}
+	if ((result = pinPage(&treeManager->bufferPool, &page, ref->page)) != RC_OK)
+		return result;
+	*rid = ((PostingHeader *) page.data)->first;
+	return unpinPage(&treeManager->bufferPool, &page);
+}
+
+// Adds "rid" to the RIDs of a key. "ref" is the key's RID in its leaf: either a single RID, which is replaced
+// by a new posting list of both RIDs, or the first page of the key's posting list. The caller marks the leaf dirty.
+RC addPosting(BTreeManager * treeManager, RID * ref, RID rid) {
+	RID rids[MAX_POSTINGS_PER_PAGE + 1];
+	BM_PageHandle first, page;
+	PostingHeader * head, * header;
+	int comparison, numRids, i, next;
+	RC result;
+
+	if (ref->slot != POSTING_LIST_SLOT) {
+		if ((comparison = compareRids(*ref, rid)) == 0)
+			return RC_IM_KEY_ALREADY_EXISTS;
+		rids[0] = comparison < 0 ? *ref : rid;
+		rids[1] = comparison < 0 ? rid : *ref;
+		if ((result = createPostingList(treeManager, rids, 2, &next)) != RC_OK)
+			return result;
+		ref->page = next;
+		ref->slot = POSTING_LIST_SLOT;
+		return RC_OK;
+	}
+
+	if ((result = pinPage(&treeManager->bufferPool, &first, ref->page)) != RC_OK)
+		return result;
+	head = (PostingHeader *) first.data;
+
+	// Records mostly get increasing RIDs, so most RIDs go after the last one of the list.
+	// Otherwise find the first page whose last RID is not smaller than it.
+	if ((result = pinPage(&treeManager->bufferPool, &page, head->tail)) != RC_OK) {
+		unpinPage(&treeManager->bufferPool, &first);
+		return result;
+	}
+	header = (PostingHeader *) page.data;
+	if (compareRids(rid, header->last) <= 0) {
+		unpinPage(&treeManager->bufferPool, &page);
+		if ((result = pinPage(&treeManager->bufferPool, &page, first.pageNum)) != RC_OK) {
+			unpinPage(&treeManager->bufferPool, &first);
+			return result;
+		}
+		header = (PostingHeader *) page.data;
+		while (compareRids(rid, header->last) > 0) {
+			next = header->next;
+			unpinPage(&treeManager->bufferPool, &page);
+			if ((result = pinPage(&treeManager->bufferPool, &page, next)) != RC_OK) {
+				unpinPage(&treeManager->bufferPool, &first);
+				return result;
+			}
+			header = (PostingHeader *) page.data;
+		}
+	}
+
+	if (compareRids(rid, header->last) > 0) {
+		// Append the RID to the last page, or start a new last page if it is full.
+		if (header->used + getRidLength(header->last, rid) <= POSTING_SPACE)
+			appendPosting(header, rid);
+		else
+			result = insertPostingPage(treeManager, head, &page, &rid, 1);
 	} else {
-		c = treeManager->queue;
-		while (c->next != NULL) {
-			c = c->next;
+		// Insert the RID in the middle of the page. If they no longer fit, the upper half of the RIDs moves to a new page.
+		decodePostings(header, (char *) (header + 1), rids);
+		numRids = header->numRids;
+		for (i = 0; compareRids(rids[i], rid) < 0; i++)
+			;
+		if (compareRids(rids[i], rid) == 0)
+			result = RC_IM_KEY_ALREADY_EXISTS;
+		else {
+			memmove(&rids[i + 1], &rids[i], (numRids - i) * sizeof(RID));
+			rids[i] = rid;
+			numRids++;
+			if (getPostingsLength(rids, numRids) <= POSTING_SPACE)
+				writePostings(header, rids, numRids);
+			else if ((result = insertPostingPage(treeManager, head, &page, rids + numRids / 2, numRids - numRids / 2)) == RC_OK)
+				writePostings(header, rids, numRids / 2);
 		}
-		c->next = new_node;
-		new_node->next = NULL;
 	}
+
+	if (result == RC_OK)
+		head->count++;
+	markDirty(&treeManager->bufferPool, &page);
+	markDirty(&treeManager->bufferPool, &first);
+	unpinPage(&treeManager->bufferPool, &page);
+	unpinPage(&treeManager->bufferPool, &first);
+	return result;
+}
+
+// Removes "rid" from the posting list of a key, which has at least two RIDs. "ref" is the key's RID in its leaf.
+// It is set to the new first page if the first page becomes empty, or to the last RID of the key, which does not
+// need a posting list. The caller marks the leaf dirty.
+RC removePosting(BTreeManager * treeManager, RID * ref, RID rid) {
+	RID rids[MAX_POSTINGS_PER_PAGE];
+	BM_PageHandle page;
+	PostingHeader * header;
+	int firstPage = ref->page;
+	int tail, count, pageNum, next, prev, i;
+	RC result;
+
+	// Find the first page whose last RID is not smaller than it. The first page records the last page and the length of the list.
+	if ((result = pinPage(&treeManager->bufferPool, &page, firstPage)) != RC_OK)
+		return result;
+	header = (PostingHeader *) page.data;
+	tail = header->tail;
+	count = header->count;
+	while (compareRids(rid, header->last) > 0 && header->next != NO_PAGE) {
+		next = header->next;
+		unpinPage(&treeManager->bufferPool, &page);
+		if ((result = pinPage(&treeManager->bufferPool, &page, next)) != RC_OK)
+			return result;
+		header = (PostingHeader *) page.data;
+	}
+
+	decodePostings(header, (char *) (header + 1), rids);
+	for (i = 0; i < header->numRids && compareRids(rids[i], rid) < 0; i++)
+		;
+	if (i == header->numRids || compareRids(rids[i], rid) != 0) {
+		unpinPage(&treeManager->bufferPool, &page);
+		return RC_IM_KEY_NOT_FOUND;
+	}
+
+	if (header->numRids > 1) {
+		memmove(&rids[i], &rids[i + 1], (header->numRids - i - 1) * sizeof(RID));
+		writePostings(header, rids, header->numRids - 1);
+		markDirty(&treeManager->bufferPool, &page);
+		unpinPage(&treeManager->bufferPool, &page);
+	} else {
+		// The page becomes empty and leaves the list.
+		pageNum = page.pageNum;
+		next = header->next;
+		prev = header->prev;
+		releasePage(treeManager, &page);
+		if (prev != NO_PAGE && (result = setPostingLink(treeManager, prev, TRUE, next)) != RC_OK)
+			return result;
+		if (next != NO_PAGE && (result = setPostingLink(treeManager, next, FALSE, prev)) != RC_OK)
+			return result;
+		if (pageNum == firstPage)
+			firstPage = next;
+		if (pageNum == tail)
+			tail = prev;
+	}
+
+	if ((result = pinPage(&treeManager->bufferPool, &page, firstPage)) != RC_OK)
+		return result;
+	header = (PostingHeader *) page.data;
+
+	// The last RID of a key goes back into its leaf.
+	if (count == 2) {
+		*ref = header->first;
+		releasePage(treeManager, &page);
+		return RC_OK;
+	}
+
+	header->tail = tail;
+	header->count = count - 1;
+	ref->page = firstPage;
+	markDirty(&treeManager->bufferPool, &page);
+	return unpinPage(&treeManager->bufferPool, &page);
+}
+
+// Frees all pages of a posting list. "numRids" is set to the number of RIDs which were on it.
+RC freePostingList(BTreeManager * treeManager, int firstPage, int * numRids) {
+	BM_PageHandle page;
+	int pageNum, next;
+	RC result;
+
+	for (pageNum = firstPage; pageNum != NO_PAGE; pageNum = next) {
+		if ((result = pinPage(&treeManager->bufferPool, &page, pageNum)) != RC_OK)
+			return result;
+		if (pageNum == firstPage)
+			*numRids = ((PostingHeader *) page.data)->count;
+		next = ((PostingHeader *) page.data)->next;
+		releasePage(treeManager, &page);
+	}
+	return RC_OK;
 }
 
-// This function helps in printing the B+ Tree
-Node * dequeue(BTreeManager * treeManager) {
-	Node * n = treeManager->queue;
-	treeManager->queue = treeManager->queue->next;
-	n->next = NULL;
-	return n;
+/*********** BULK LOADING *************/
+
+// Orders the entries given to bulkLoad(...) by their keys, and entries with the same key by their RIDs (used with qsort).
+static int compareBulkEntries(const void * a, const void * b) {
+	int result = compareValues(((BulkEntry *) a)->key, ((BulkEntry *) b)->key);
+	return result != 0 ? result : compareRids(((BulkEntry *) a)->rid, ((BulkEntry *) b)->rid);
 }
 
-// This function gives the length in edges of the path from any node to the root.
-int path_to_root(Node * root, Node * child) {
-	int length = 0;
-	Node * c = child;
-	while (c != root) {
-		c = c->parent;
-		length++;
+// Returns the number of entries a node gets for the fill factor. It is kept between the minimum and the maximum of a node.
+static int getBulkFill(float fillFactor, int minPerNode, int maxPerNode) {
+	int perNode = (int) (fillFactor * maxPerNode + 0.5f);
+
+	if (perNode < minPerNode)
+		perNode = minPerNode;
+	if (perNode > maxPerNode)
+		perNode = maxPerNode;
+	return perNode;
+}
+
+// Returns the number of nodes that "numEntries" entries are spread over evenly, so that every node gets
+// at most "perNode" entries. If that would leave less than "minPerNode" entries in a node, fewer nodes are used.
+// Either way no node gets more entries than fit, because perNode <= maximum and 2 * minPerNode - 1 <= maximum.
+static int countBulkNodes(int numEntries, int perNode, int minPerNode) {
+	int numNodes = (numEntries + perNode - 1) / perNode;
+
+	if (numNodes > 1 && numEntries / numNodes < minPerNode)
+		numNodes = numEntries / minPerNode;
+	return numNodes > 0 ? numNodes : 1;
+}
+
+// Returns TRUE if the DT_STRING key "key" fits into a node filled by bulkLoad(...) whose "numKeys" keys start with "first"
+// and have "length" characters in total, so that the characters of the keys with their common prefix take at most "space" bytes.
+static bool fitsBulkNode(NodeKey * first, NodeKey * key, int numKeys, int length, int space) {
+	int prefixLength = getCommonLength(first->v.stringV, key->v.stringV, MAX_STRING_KEY_LENGTH);
+	return prefixLength + length + (int) strlen(key->v.stringV) - (numKeys + 1) * prefixLength <= space;
+}
+
+// Returns the number of nodes the rest of a level needs once node "i" is next. It is the number of nodes planned,
+// unless DT_STRING nodes got fewer keys than planned because their characters filled the page.
+static int getBulkNodes(int i, int numNodes, int numLeft, int perNode, int minPerNode) {
+	int needed = countBulkNodes(numLeft, perNode, minPerNode);
+	return i + (numNodes - i > needed ? numNodes - i : needed);
+}
+
+// Gives back the posting lists which bulkLoad(...) created for the first "numKeys" entries when it fails before the tree is complete.
+static void freeBulkPostingLists(BTreeManager * treeManager, BulkEntry * entries, int numKeys) {
+	int i, numRids;
+
+	for (i = 0; i < numKeys; i++)
+		if (entries[i].rid.slot == POSTING_LIST_SLOT)
+			freePostingList(treeManager, entries[i].rid.page, &numRids);
+}
+
+// Makes room for "numNodes" nodes in the arrays which bulkLoad(...) keeps for a level. Returns FALSE if there is no memory.
+static bool growBulkArrays(int ** pages, NodeKey ** separators, int * maxNodes, int numNodes) {
+	int * newPages;
+	NodeKey * newSeparators;
+
+	if (numNodes <= *maxNodes)
+		return TRUE;
+
+	// realloc(...) may have moved the pages even if the separators cannot grow, so the new pointer is kept either way.
+	// The capacity only grows once both arrays have the room, so a failure leaves "maxNodes" right for the smaller one.
+	newPages = realloc(*pages, 2 * numNodes * sizeof(int));
+	if (newPages != NULL)
+		*pages = newPages;
+	newSeparators = newPages != NULL ? realloc(*separators, 2 * numNodes * sizeof(NodeKey)) : NULL;
+	if (newSeparators != NULL)
+		*separators = newSeparators;
+	if (newPages == NULL || newSeparators == NULL)
+		return FALSE;
+	*maxNodes = 2 * numNodes;
+	return TRUE;
+}
+
+// Builds the B+ Tree of an empty index from the entries, one level at a time from the leaves up.
+// Node i of a level gets numEntries / numNodes entries, plus one for the first numEntries % numNodes nodes.
+// A DT_STRING node gets fewer entries if their characters would take more than its share of the page, and then the entries
+// which are left are spread over the rest of the nodes.
+// The nodes are created one after the other, so each level is written to consecutive pages of the index file.
+RC bulkLoad(BTreeManager * treeManager, BulkEntry * entries, int numEntries, float fillFactor) {
+	int bTreeOrder = treeManager->order;
+	int numNodes, maxNodes, numChildren, numKeys, perNode, minPerNode, size, next, length, space, i, j;
+	int * pages;
+	RID * rids;
+	NodeKey * separators;
+	NodeKey key, first, last;
+	Node node, previous;
+	RC result;
+
+	if (numEntries == 0)
+		return RC_OK;
+
+	// Sort the entries unless they are sorted already. Equal keys end up next to each other.
+	for (i = 1; i < numEntries && compareBulkEntries(&entries[i - 1], &entries[i]) < 0; i++)
+		;
+	if (i < numEntries)
+		qsort(entries, numEntries, sizeof(BulkEntry), compareBulkEntries);
+
+	// A key may only appear more than once if the index allows duplicate keys, and then only with different RIDs.
+	for (i = 1; i < numEntries; i++)
+		if (compareValues(entries[i - 1].key, entries[i].key) == 0 && (treeManager->unique || compareRids(entries[i - 1].rid, entries[i].rid) == 0))
+			return RC_IM_KEY_ALREADY_EXISTS;
+
+	// The RIDs of a key which appears more than once go to a posting list, and its entries are replaced by one entry which refers to it.
+	numKeys = numEntries;
+	if (!treeManager->unique) {
+		if ((rids = malloc(numEntries * sizeof(RID))) == NULL)
+			return RC_INSERT_ERROR;
+		for (i = 0, numKeys = 0; i < numEntries; i = j) {
+			rids[0] = entries[i].rid;
+			for (j = i + 1; j < numEntries && compareValues(entries[i].key, entries[j].key) == 0; j++)
+				rids[j - i] = entries[j].rid;
+			entries[numKeys] = entries[i];
+			if (j - i > 1) {
+				if ((result = createPostingList(treeManager, rids, j - i, &entries[numKeys].rid.page)) != RC_OK) {
+					freeBulkPostingLists(treeManager, entries, numKeys);
+					free(rids);
+					return result;
+				}
+				entries[numKeys].rid.slot = POSTING_LIST_SLOT;
+			}
+			numKeys++;
+		}
+		free(rids);
 	}
-	return length;
+
+	// A leaf needs as many keys as after a split, see insertIntoLeafAfterSplitting(...).
+	if ((bTreeOrder - 1) % 2 == 0)
+		minPerNode = (bTreeOrder - 1) / 2;
+	else
+		minPerNode = (bTreeOrder - 1) / 2 + 1;
+	perNode = getBulkFill(fillFactor, minPerNode, bTreeOrder - 1);
+	numNodes = countBulkNodes(numKeys, perNode, minPerNode);
+
+	// The characters of the keys of a DT_STRING node take the same share of their space, between half and all of it.
+	space = (int) ((PAGE_SIZE - treeManager->heapBase) * (fillFactor < 0.5f ? 0.5f : fillFactor));
+
+	// The page of every node of the level being built and the key which separates it from the node before.
+	// The separator of every node but the first becomes a key of the level above.
+	maxNodes = numNodes;
+	pages = malloc(maxNodes * sizeof(int));
+	separators = malloc(maxNodes * sizeof(NodeKey));
+	if (pages == NULL || separators == NULL) {
+		free(pages);
+		free(separators);
+		return RC_INSERT_ERROR;
+	}
+
+	// Fill the leaves and link each one to the next. The previous leaf stays pinned until the next one has a page.
+	for (i = 0, next = 0; next < numKeys; i++) {
+		numNodes = getBulkNodes(i, numNodes, numKeys - next, perNode, minPerNode);
+		result = growBulkArrays(&pages, &separators, &maxNodes, numNodes) ? createLeaf(treeManager, &node) : RC_INSERT_ERROR;
+		if (result != RC_OK) {
+			if (i > 0)
+				releaseNode(treeManager, &previous);
+			freeBulkPostingLists(treeManager, entries, numKeys);
+			free(pages);
+			free(separators);
+			return result;
+		}
+
+		// The shortest key between the last key of the previous leaf and the first key of this one separates them.
+		makeKey(&first, entries[next].key);
+		separators[i] = first;
+		if (i > 0) {
+			makeKey(&last, entries[next - 1].key);
+			getSeparator(&last, &first, &separators[i]);
+		}
+
+		// The leaf starts with the prefix of its first key, which gets shorter with every key that does not share all of it.
+		size = (numKeys - next + numNodes - i - 1) / (numNodes - i);
+		setNodePrefix(&node, &first, &first);
+		for (j = 0, length = 0; j < size; j++, next++) {
+			makeKey(&key, entries[next].key);
+			if (key.dt == DT_STRING) {
+				if (j > 0 && !fitsBulkNode(&first, &key, j, length, space))
+					break;
+				length += strlen(key.v.stringV);
+			}
+			appendKey(&node, &key);
+			node.pointers.rids[j] = entries[next].rid;
+		}
+		pages[i] = node.page.pageNum;
+
+		if (i > 0) {
+			previous.header->next = pages[i];
+			node.header->prev = pages[i - 1];
+			releaseNode(treeManager, &previous);
+		}
+		previous = node;
+	}
+	releaseNode(treeManager, &previous);
+	numNodes = i;
+
+	// An internal node needs as many children as after a split, see insertIntoNodeAfterSplitting(...).
+	if (bTreeOrder % 2 == 0)
+		minPerNode = bTreeOrder / 2;
+	else
+		minPerNode = bTreeOrder / 2 + 1;
+	perNode = getBulkFill(fillFactor, minPerNode, bTreeOrder);
+
+	// Build the internal levels until a level has a single node, the root.
+	// A node only reads the entries of its own children, which are never before its own entry, so the arrays are reused in place.
+	while (numNodes > 1) {
+		numChildren = numNodes;
+		numNodes = countBulkNodes(numChildren, perNode, minPerNode);
+
+		for (i = 0, next = 0; next < numChildren; i++) {
+			numNodes = getBulkNodes(i, numNodes, numChildren - next, perNode, minPerNode);
+			if ((result = createNode(treeManager, &node)) != RC_OK) {
+				free(pages);
+				free(separators);
+				return result;
+			}
+
+			size = (numChildren - next + numNodes - i - 1) / (numNodes - i);
+			node.pointers.children[0] = pages[next];
+			if (size > 1)
+				setNodePrefix(&node, &separators[next + 1], &separators[next + 1]);
+			for (j = 1, length = 0; j < size; j++) {
+				if (separators[next + j].dt == DT_STRING) {
+					if (j > 1 && !fitsBulkNode(&separators[next + 1], &separators[next + j], j - 1, length, space))
+						break;
+					length += strlen(separators[next + j].v.stringV);
+				}
+				appendKey(&node, &separators[next + j]);
+				node.pointers.children[j] = pages[next + j];
+			}
+			if (i != next)
+				separators[i] = separators[next];
+			pages[i] = node.page.pageNum;
+			next += j;
+
+			releaseNode(treeManager, &node);
+		}
+		numNodes = i;
+	}
+
+	// Other threads only see the new nodes from here on, so they were not latched while they were filled.
+	treeManager->numEntries = numEntries;
+	setRootPage(treeManager, pages[0]);
+
+	free(pages);
+	free(separators);
+	return RC_OK;
 }
 
 /*********** SUPPORT MULTIPLE DATATYPES *************/
 
-// This function compares two keys and returns TRUE if first key is less than second key.
-bool isLess(Value * key1, Value * key2) {
-	switch (key1->dt) {
+// This function copies a key into the structure which carries keys between nodes.
+void makeKey(NodeKey * nodeKey, Value * key) {
+	nodeKey->dt = key->dt;
+	switch (key->dt) {
 	case DT_INT:
-		if (key1->v.intV < key2->v.intV) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
+		nodeKey->v.intV = key->v.intV;
 		break;
 	case DT_FLOAT:
-		if (key1->v.floatV < key2->v.floatV) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
+		nodeKey->v.floatV = key->v.floatV;
 		break;
 	case DT_STRING:
-		if (strcmp(key1->v.stringV, key2->v.stringV) == -1) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
+		strncpy(nodeKey->v.stringV, key->v.stringV, MAX_STRING_KEY_LENGTH);
+		nodeKey->v.stringV[MAX_STRING_KEY_LENGTH] = '\0';
 		break;
 	case DT_BOOL:
-		// Boolean datatype can only be Equal or Not Equal To
-		return FALSE;
+		nodeKey->v.boolV = key->v.boolV;
 		break;
 	}
 }
 
-// This function compares two keys and returns TRUE if first key is greater than second key.
-bool isGreater(Value * key1, Value * key2) {
-	switch (key1->dt) {
+// This function makes a value of a key copied by makeKey(...) or getKey(...). A DT_STRING value points into "nodeKey".
+void makeValue(Value * value, NodeKey * nodeKey) {
+	value->dt = nodeKey->dt;
+	switch (nodeKey->dt) {
 	case DT_INT:
-		if (key1->v.intV > key2->v.intV) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
+		value->v.intV = nodeKey->v.intV;
 		break;
 	case DT_FLOAT:
-		if (key1->v.floatV > key2->v.floatV) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
+		value->v.floatV = nodeKey->v.floatV;
 		break;
 	case DT_STRING:
-		if (strcmp(key1->v.stringV, key2->v.stringV) == 1) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
+		value->v.stringV = nodeKey->v.stringV;
 		break;
 	case DT_BOOL:
-		// Boolean datatype can only be Equal or Not Equal To
-		return FALSE;
+		value->v.boolV = nodeKey->v.boolV;
 		break;
 	}
 }
 
-// This function compares two keys and returns TRUE if first key is equal to the second key else returns FALSE.
-bool isEqual(Value * key1, Value * key2) {
-	switch (key1->dt) {
+// This function compares a key with the key at "index" of a node.
+// It returns a negative value, zero or a positive value if the key is less than, equal to or greater than the stored key.
+int compareKey(Value * key, Node * node, int index) {
+	int stored;
+	float storedFloat;
+	int length, prefixLength, result;
+	char head[STRING_KEY_HEAD];
+
+	switch (node->keyType) {
 	case DT_INT:
-		if (key1->v.intV == key2->v.intV) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
-		break;
+		stored = ((int *) node->keys)[index];
+		return (key->v.intV > stored) - (key->v.intV < stored);
 	case DT_FLOAT:
-		if (key1->v.floatV == key2->v.floatV) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
-		break;
+		storedFloat = ((float *) node->keys)[index];
+		return (key->v.floatV > storedFloat) - (key->v.floatV < storedFloat);
 	case DT_STRING:
-		if (strcmp(key1->v.stringV, key2->v.stringV) == 0) {
-			return TRUE;
-		} else {
-			return FALSE;
-		}
-		break;
+		length = strlen(key->v.stringV);
+		if ((result = comparePrefix(key->v.stringV, length, node, &prefixLength)) != 0)
+			return result;
+		length -= prefixLength;
+		memset(head, 0, STRING_KEY_HEAD);
+		memcpy(head, key->v.stringV + prefixLength, length < STRING_KEY_HEAD ? length : STRING_KEY_HEAD);
+		return compareString(key->v.stringV + prefixLength, length, head, node, index);
 	case DT_BOOL:
-		if (key1->v.boolV == key2->v.boolV) {
-			return TRUE;
-		} else {
-			return FALSE;
+		stored = ((int *) node->keys)[index];
+		return (key->v.boolV != 0) - stored;
+	}
+	return 0;
+}
+
+// This function compares two keys of the B+ Tree's datatype in the order of the keys in the nodes.
+// It returns a negative value, zero or a positive value if the key is less than, equal to or greater than the other key.
+int compareValues(Value * key, Value * other) {
+	switch (key->dt) {
+	case DT_INT:
+		return (key->v.intV > other->v.intV) - (key->v.intV < other->v.intV);
+	case DT_FLOAT:
+		return (key->v.floatV > other->v.floatV) - (key->v.floatV < other->v.floatV);
+	case DT_STRING:
+		return strcmp(key->v.stringV, other->v.stringV);
+	case DT_BOOL:
+		return (key->v.boolV != 0) - (other->v.boolV != 0);
+	}
+	return 0;
+}
+
+// Number of bytes of a DT_INT, DT_FLOAT or DT_BOOL attribute of an encoded composite key
+#define ENCODED_NUMBER_LENGTH 5
+#define ENCODED_BOOL_LENGTH 1
+
+// Stores a number as 5 digits in base 255, most significant first. Every digit is stored plus one, so that no byte is zero
+// and a smaller number has smaller bytes.
+static char * encodeNumber(char * out, unsigned int value) {
+	int i;
+
+	for (i = ENCODED_NUMBER_LENGTH - 1; i >= 0; i--) {
+		out[i] = (char) (value % 255 + 1);
+		value /= 255;
+	}
+	return out + ENCODED_NUMBER_LENGTH;
+}
+
+// Reads a number stored by encodeNumber(...).
+static unsigned int decodeNumber(char * in) {
+	unsigned int value = 0;
+	int i;
+
+	for (i = 0; i < ENCODED_NUMBER_LENGTH; i++)
+		value = value * 255 + (unsigned char) in[i] - 1;
+	return value;
+}
+
+// This function encodes a composite key, i.e. one value for every key attribute, into a DT_STRING key in "buffer"
+// (MAX_STRING_KEY_LENGTH + 1 bytes). The encoded keys compare (byte by byte) in the lexicographic order of the values,
+// so a composite key is stored and searched like any other DT_STRING key. The values are encoded one after the other:
+//  - DT_INT / DT_FLOAT: the bits of the number, turned into an unsigned number with the same order, see encodeNumber(...).
+//  - DT_BOOL: one byte, 1 for FALSE and 2 for TRUE.
+//  - DT_STRING: the characters, followed by the bytes 1 1. A character 1 is stored as 1 2, so a string which ends
+//    comes before all longer strings.
+// No byte is zero, so the encoded key is a string. Returns RC_IM_KEY_TOO_LONG if it does not fit.
+RC encodeCompositeKey(BTreeManager * treeManager, Value * values, char * buffer) {
+	char * out = buffer;
+	char * end = buffer + MAX_STRING_KEY_LENGTH;
+	unsigned int bits;
+	float number;
+	char * c;
+	int i;
+
+	for (i = 0; i < treeManager->numKeyAttrs; i++) {
+		if (values[i].dt != treeManager->keyTypes[i])
+			return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+		switch (values[i].dt) {
+		case DT_INT:
+			if (end - out < ENCODED_NUMBER_LENGTH)
+				return RC_IM_KEY_TOO_LONG;
+			out = encodeNumber(out, (unsigned int) values[i].v.intV ^ 0x80000000u);
+			break;
+		case DT_FLOAT:
+			if (end - out < ENCODED_NUMBER_LENGTH)
+				return RC_IM_KEY_TOO_LONG;
+			// -0 and 0 are the same key. A negative number orders its bits the other way round.
+			number = values[i].v.floatV == 0 ? 0 : values[i].v.floatV;
+			memcpy(&bits, &number, sizeof(bits));
+			out = encodeNumber(out, (bits & 0x80000000u) ? ~bits : bits | 0x80000000u);
+			break;
+		case DT_BOOL:
+			if (end - out < ENCODED_BOOL_LENGTH)
+				return RC_IM_KEY_TOO_LONG;
+			*out++ = values[i].v.boolV ? 2 : 1;
+			break;
+		case DT_STRING:
+			for (c = values[i].v.stringV; *c != '\0'; c++) {
+				if (end - out < (*c == 1 ? 2 : 1))
+					return RC_IM_KEY_TOO_LONG;
+				*out++ = *c;
+				if (*c == 1)
+					*out++ = 2;
+			}
+			if (end - out < 2)
+				return RC_IM_KEY_TOO_LONG;
+			*out++ = 1;
+			*out++ = 1;
+			break;
+		}
+	}
+	*out = '\0';
+	return RC_OK;
+}
+
+// This function decodes a key encoded by encodeCompositeKey(...) into one value per key attribute.
+// The characters of DT_STRING values are stored in "strings" (MAX_STRING_KEY_LENGTH + MAX_KEY_ATTRS bytes).
+// A separator in an internal node may end within an attribute (see getSeparator(...)). Then only the attributes before
+// that one are decoded. Returns the number of decoded attributes.
+int decodeCompositeKey(BTreeManager * treeManager, char * key, Value * values, char * strings) {
+	unsigned int bits;
+	int i;
+
+	for (i = 0; i < treeManager->numKeyAttrs; i++) {
+		values[i].dt = treeManager->keyTypes[i];
+		if (strnlen(key, ENCODED_NUMBER_LENGTH) < (values[i].dt == DT_BOOL ? ENCODED_BOOL_LENGTH : values[i].dt == DT_STRING ? 2 : ENCODED_NUMBER_LENGTH))
+			return i;
+		switch (values[i].dt) {
+		case DT_INT:
+			values[i].v.intV = (int) (decodeNumber(key) ^ 0x80000000u);
+			key += ENCODED_NUMBER_LENGTH;
+			break;
+		case DT_FLOAT:
+			bits = decodeNumber(key);
+			bits = (bits & 0x80000000u) ? bits & ~0x80000000u : ~bits;
+			memcpy(&values[i].v.floatV, &bits, sizeof(bits));
+			key += ENCODED_NUMBER_LENGTH;
+			break;
+		case DT_BOOL:
+			values[i].v.boolV = *key++ == 2;
+			break;
+		case DT_STRING:
+			values[i].v.stringV = strings;
+			while (key[0] != 1 || key[1] != 1) {
+				if (key[0] == '\0' || key[1] == '\0')
+					return i;
+				*strings++ = *key;
+				key += *key == 1 ? 2 : 1;
+			}
+			*strings++ = '\0';
+			key += 2;
+			break;
 		}
-		break;
 	}
+	return i;
 }
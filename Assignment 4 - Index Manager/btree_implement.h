@@ -1,78 +1,327 @@
 #ifndef BTREE_IMPLEMENT_H
 #define BTREE_IMPLEMENT_H
 
+#include <pthread.h>
+
 #include "btree_mgr.h"
 #include "buffer_mgr.h"
 
+// Page of the index file which holds the B+ Tree's metadata. The nodes are stored on the pages after it.
+#define METADATA_PAGE 0
+
+// Page number used for a missing page (empty tree, last leaf, end of the free page list).
+#define NO_PAGE -1
+
+// Maximum length of a DT_STRING key. Keys are stored inside the node pages.
+#define MAX_STRING_KEY_LENGTH 64
+
+// Number of leading characters of a DT_STRING key (after the common prefix of its node) kept in the key array of a node.
+#define STRING_KEY_HEAD 4
+
+// Number of DT_STRING keys of the maximum length whose characters fit on a node page of any order
+#define MIN_STRING_KEYS_PER_NODE 4
+
+// Maximum height of the B+ Tree. Every level at least doubles the number of leaves.
+#define MAX_TREE_HEIGHT 32
+
+// Maximum number of attributes of a composite key
+#define MAX_KEY_ATTRS 8
+
+// Maximum number of nodes a structure modification latches. It changes at most three nodes per level.
+#define MAX_LATCHED_NODES (3 * MAX_TREE_HEIGHT + 2)
+
+// Bit of the version of a node which is set while a thread has latched the node
+#define NODE_LATCHED 1u
+
+// Slot of the RID of a leaf entry whose key has several RIDs. The page of the RID is the first page of the key's posting list.
+#define POSTING_LIST_SLOT -1
+
+// Structure that is stored on the metadata page of the index file
+typedef struct BTreeMetadata {
+	DataType keyType;
+	int order;
+	int rootPage;
+	int numNodes;
+	int numEntries;
+	int numPages;	// Pages of the index file in use, including the metadata page
+	int freePage;	// First page of the list of pages released by deletes
+	int unique;		// A key has one RID only. Otherwise the RIDs of a key are stored in a posting list.
+	int numKeyAttrs;
+	DataType keyTypes[MAX_KEY_ATTRS];
+} BTreeMetadata;
+
+// Structure that holds a copy of a key while it is moved between nodes
+typedef struct NodeKey {
+	DataType dt;
+	union {
+		int intV;
+		float floatV;
+		bool boolV;
+		char stringV[MAX_STRING_KEY_LENGTH + 1];
+	} v;
+} NodeKey;
+
 // Structure that holds the actual data of an entry
 typedef struct NodeData {
 	RID rid;
 } NodeData;
 
-// Structure that represents a node in the B+ Tree
+// Structure that holds one entry (key and RID) given to bulkLoadBtree(...)
+typedef struct BulkEntry {
+	Value * key;
+	RID rid;
+} BulkEntry;
+
+// Structure that holds one key given to findKeys(...) and its position in the caller's array
+typedef struct ProbeEntry {
+	Value * key;
+	int index;
+} ProbeEntry;
+
+// Structure of a DT_STRING key in the key array of a node. The characters after the common prefix of the node's keys
+// are stored at "offset" in the same page. Comparisons which differ in the head never touch the rest of the string.
+typedef struct StringKey {
+	char head[STRING_KEY_HEAD];
+	unsigned short offset;
+	unsigned short length;
+} StringKey;
+
+/* Layout of a page of a posting list, which holds the RIDs of one key of an index that allows duplicate keys:
+ *
+ *   PostingHeader | RIDs after the first one | free space
+ *
+ * The RIDs of a key are sorted, and the pages of its posting list are linked in that order.
+ * Each RID after the first one of a page is stored as its difference to the RID before it: the number of pages after
+ * that RID's page, then the slot (or the number of slots after that RID's slot if the page is the same).
+ * Both numbers are stored with 7 bits per byte, so a RID close to the one before it takes two bytes instead of eight.
+ */
+typedef struct PostingHeader {
+	unsigned int version;	// Version the page had as a node, see the LATCHING PROTOCOL. Posting lists leave it alone.
+	int next;		// Next page of the posting list
+	int prev;		// Previous page of the posting list
+	int numRids;	// RIDs on this page
+	int used;		// Bytes of the RIDs after the first one
+	RID first;
+	RID last;
+	int tail;		// First page of the list only: last page of the list
+	int count;		// First page of the list only: RIDs of the whole list
+} PostingHeader;
+
+// Maximum number of RIDs on a page of a posting list. Every RID after the first one takes at least two bytes.
+#define MAX_POSTINGS_PER_PAGE ((PAGE_SIZE - (int) sizeof(PostingHeader)) / 2 + 1)
+
+/* LATCHING PROTOCOL
+
+   Several threads may use an open B+ Tree at the same time. The nodes are synchronized with optimistic lock coupling:
+
+   - Every node page starts with a version. A thread which changes a node latches it by making the version odd, and makes
+     it even again when it is done, so that every change of a node gives it a new version.
+   - Readers never latch. They read the version of a node, read the node, and check that the version is still the same.
+     Otherwise they start over. On the way down, a reader reads the version of the child before it checks the parent's
+     version again, so the child is still the parent's child. A page number read from a node is only used after the check.
+   - An insert or delete which only changes its leaf (or the posting list of a key in it) descends like a reader and then
+     latches the leaf, which succeeds only if the leaf's version is still the one it read. Other threads keep working
+     on the rest of the tree.
+   - A structure modification (an insert which splits nodes, a delete which merges or redistributes nodes, or a change of the
+     root) holds structureLatch, so internal nodes never change under it. It latches every node it changes and releases all
+     of them at the end (see latchModifiedNode(...)), so that readers see either none or all of its changes.
+   - pageLatch protects the allocation of pages (numPages and freePage), which posting lists do outside of structure modifications.
+
+   A thread waits for a latched node by yielding the processor. Only a structure modification waits for a latch while it holds
+   one, so latches never deadlock. Pages keep their version when they are freed and used again, so that a reader which was
+   on a freed page notices it.
+*/
+
+/* Layout of a node page:
+ *
+ *   NodeHeader | keys[order - 1] | pointers[order - 1] | free space | string characters | common prefix
+ *
+ * The keys are stored one after the other with a fixed width: an int/float/bool, or a StringKey.
+ * The pointers are a separate array: RIDs in a leaf, or the pages of the children in an internal node
+ * (child i is left of key i, child i + 1 is right of it).
+ * The characters of DT_STRING keys are stored from the end of the page downwards. The prefix which all keys of the node
+ * have in common is stored once at the very end, and every key only stores the characters after it.
+ * A DT_STRING node is full when it has order - 1 keys or when the characters of another key do not fit, so that nodes
+ * of keys with long common prefixes (URLs, user names) hold more keys than nodes of keys without.
+ */
+typedef struct NodeHeader {
+	unsigned int version;	// See the LATCHING PROTOCOL
+	int isLeaf;
+	int numKeys;
+	int next;		// Leaf: page of the next leaf. Free page: next page of the free page list.
+	int prev;		// Leaf: page of the previous leaf
+	int heapStart;	// Offset of the first string character in use
+	int prefixLength;	// Length of the common prefix of the DT_STRING keys
+} NodeHeader;
+
+// Structure that represents a node in the B+ Tree. It points into the node's page which is pinned in the buffer pool.
 typedef struct Node {
-	void ** pointers;
-	Value ** keys;
-	struct Node * parent;
-	bool is_leaf;
-	int num_keys;
-	struct Node * next; // Used for queue.
+	BM_PageHandle page;
+	NodeHeader * header;
+	char * keys;
+	union {
+		RID * rids;
+		int * children;
+	} pointers;
+	DataType keyType;
+	int heapBase;	// Offset of the first byte after the pointers
+	int maxKeys;
 } Node;
 
+// Structure that records the internal nodes visited from the root down to a leaf.
+// It replaces parent pointers, which would have to be rewritten in every child when a node splits.
+typedef struct NodePath {
+	int depth;
+	int pages[MAX_TREE_HEIGHT];
+	int indexes[MAX_TREE_HEIGHT];	// Index of the child followed in each node
+} NodePath;
+
 // Structure that stores additional information of B+ Tree
+// There is one for every open index, shared by all handles which opened it (see openBtree(...)).
 typedef struct BTreeManager {
-	BM_BufferPool bufferPool;
-	BM_PageHandle pageHandler;
+	char * idxId;			// Name of the index file
+	int numHandles;			// Open handles of the index
+	struct BTreeManager * nextOpen;	// Next open index
+	BM_BufferPool bufferPool;	// Buffer pool of the index file, shared by all handles of the index
 	int order;
 	int numNodes;
 	int numEntries;
-	Node * root;
-	Node * queue;
-	DataType keyType;
+	int rootPage;
+	int numPages;
+	int freePage;
+	bool unique;
+	int numKeyAttrs;
+	DataType keyTypes[MAX_KEY_ATTRS];	// Datatypes of the key attributes
+	DataType keyType;		// Datatype of the keys in the nodes. Composite keys are stored as DT_STRING keys.
+	int keyWidth;			// Bytes per key in the key array
+	int pointersOffset;		// Offset of the pointer array in a node page
+	int heapBase;			// Offset of the first byte after the pointer array
+	pthread_mutex_t structureLatch;	// Serializes structure modifications (see LATCHING PROTOCOL)
+	pthread_mutex_t pageLatch;		// Protects numPages and freePage
+	int numLatched;					// Nodes latched by the running structure modification
+	BM_PageHandle latched[MAX_LATCHED_NODES];
 } BTreeManager;
 
 //Structure that faciltates the scan operation on the B+ Tree
+// The scan reads a copy of the current leaf, which it takes while the leaf's version does not change (see LATCHING PROTOCOL).
+// If the tree changes under the scan, it finds its place again by the key and RID of the last entry it returned.
 typedef struct ScanManager {
 	int keyIndex;
-	int totalKeys;
-	int order;
-	Node * node;
+	int leafPage;		// Page of the current leaf, NO_PAGE when the scan is finished
+	Node leaf;			// The current leaf, pinned
+	unsigned int version;	// Version of the current leaf when it was copied
+	Node node;			// Copy of the current leaf in "leafData"
+	char leafData[PAGE_SIZE];
+	BTreeManager * treeManager;
+	bool reverse;		// Scan from the largest key to the smallest, following the previous leaves
+	bool hasStart;		// The scan starts at "start" instead of the first (or last) leaf
+	bool startInclusive;	// The entry with key "start" is part of the scan
+	Value start;		// First key of the range in scan direction. A DT_STRING key is a copy owned by the scan.
+	bool hasEnd;		// The scan stops at "end" instead of the last (or first) leaf
+	bool endInclusive;	// The entry with key "end" is part of the scan
+	Value end;			// Last key of the range in scan direction. A DT_STRING key is a copy owned by the scan.
+	bool hasLast;		// An entry has been returned. The scan continues after "lastKey" and "lastRid".
+	NodeKey lastKey;
+	RID lastRid;
+	int postingPage;	// Next page to read of the posting list being scanned, NO_PAGE if there is none
+	int postingIndex;	// Index in "postings" of the next RID to return
+	int numPostings;
+	RID postings[MAX_POSTINGS_PER_PAGE];	// RIDs of the posting list page read last
 } ScanManager;
 
-// Functions to find an element (record) in the B+ Tree
-Node * findLeaf(Node * root, Value * key);
-NodeData * findRecord(Node * root, Value * key);
+// Searches of the key arrays of DT_INT, DT_BOOL and DT_FLOAT nodes
+typedef enum KeySearch {
+	KEY_SEARCH_LINEAR = 0,	// Compare one key after the other
+	KEY_SEARCH_BINARY = 1,	// Binary search
+	KEY_SEARCH_SSE2 = 2,	// Binary search down to a few keys, then compare 4 keys per instruction
+	KEY_SEARCH_AVX2 = 3		// Binary search down to a few keys, then compare 8 keys per instruction
+} KeySearch;
+
+// Functions to search the key arrays of the nodes
+RC setKeySearch(KeySearch method);
+void selectKeySearch(void);
+int searchIntKeys(int * keys, int numKeys, int key, bool upper);
+int searchFloatKeys(float * keys, int numKeys, float key, bool upper);
+
+// Functions to latch the nodes, see the LATCHING PROTOCOL
+unsigned int readVersion(Node * node);
+bool checkVersion(Node * node, unsigned int version);
+void latchNode(Node * node);
+bool tryLatchNode(Node * node, unsigned int version);
+void unlatchNode(Node * node);
+RC latchModifiedNode(BTreeManager * treeManager, Node * node);
+void unlatchModifiedNodes(BTreeManager * treeManager);
+int getRootPage(BTreeManager * treeManager);
 
-// Functions to support printing of the B+ Tree
-void enqueue(BTreeManager * treeManager, Node * new_node);
-Node * dequeue(BTreeManager * treeManager);
-int path_to_root(Node * root, Node * child);
+// Functions to access the nodes (pages) of the B+ Tree through the buffer pool
+RC readMetadata(BTreeManager * treeManager);
+RC writeMetadata(BTreeManager * treeManager);
+int getMaxKeys(DataType keyType);
+void setNodeLayout(BTreeManager * treeManager);
+RC getNode(BTreeManager * treeManager, int pageNum, Node * node);
+bool copyNode(BTreeManager * treeManager, Node * node, unsigned int version, Node * copy, char * data);
+void releaseNode(BTreeManager * treeManager, Node * node);
+void markNodeDirty(BTreeManager * treeManager, Node * node);
+RC setPrevLeaf(BTreeManager * treeManager, int pageNum, int prev);
+void resetNode(Node * node);
+void setNodePrefix(Node * node, NodeKey * first, NodeKey * last);
+void compactNode(Node * node);
+bool hasRoomForKey(Node * node, NodeKey * key, int replace);
+void getSeparator(NodeKey * left, NodeKey * right, NodeKey * separator);
+void getKey(Node * node, int index, NodeKey * key);
+void setKey(Node * node, int index, NodeKey * key);
+void appendKey(Node * node, NodeKey * key);
+void moveKeys(Node * node, int to, int from, int count);
+
+// Functions to find an element (record) in the B+ Tree
+RC findLeaf(BTreeManager * treeManager, Value * key, NodePath * path, Node * leaf, unsigned int * version);
+RC findOuterLeaf(BTreeManager * treeManager, bool last, Node * leaf, unsigned int * version);
+RC findRecord(BTreeManager * treeManager, Value * key, NodeData * record);
+RC findRecords(BTreeManager * treeManager, Value * keys, int numKeys, RID * results, RC * status);
+RC findAllRecords(BTreeManager * treeManager, Value * key, RID * results, int maxResults, int * numResults);
+int findEntry(Node * node, Value * key);
+int findEntryAfter(Node * node, Value * key);
+int findChild(Node * node, Value * key);
 
 // Functions to support addition of an element (record) in the B+ Tree
-NodeData * makeRecord(RID * rid);
-Node * insertIntoLeaf(BTreeManager * treeManager, Node * leaf, Value * key, NodeData * pointer);
-Node * createNewTree(BTreeManager * treeManager, Value * key, NodeData * pointer);
-Node * createNode(BTreeManager * treeManager);
-Node * createLeaf(BTreeManager * treeManager);
-Node * insertIntoLeafAfterSplitting(BTreeManager * treeManager, Node * leaf, Value * key, NodeData * pointer);
-Node * insertIntoNode(BTreeManager * treeManager, Node * parent, int left_index, Value * key, Node * right);
-Node * insertIntoNodeAfterSplitting(BTreeManager * treeManager, Node * parent, int left_index, Value * key, Node * right);
-Node * insertIntoParent(BTreeManager * treeManager, Node * left, Value * key, Node * right);
-Node * insertIntoNewRoot(BTreeManager * treeManager, Node * left, Value * key, Node * right);
-int getLeftIndex(Node * parent, Node * left);
+RC insert(BTreeManager * treeManager, Value * key, NodeData * pointer);
+RC insertIntoLeaf(BTreeManager * treeManager, Node * leaf, Value * key, NodeData * pointer);
+RC createNewTree(BTreeManager * treeManager, Value * key, NodeData * pointer);
+RC createNode(BTreeManager * treeManager, Node * node);
+RC createLeaf(BTreeManager * treeManager, Node * leaf);
+RC insertIntoLeafAfterSplitting(BTreeManager * treeManager, NodePath * path, Node * leaf, Value * key, NodeData * pointer);
+RC insertIntoNode(BTreeManager * treeManager, Node * parent, int left_index, NodeKey * key, int right);
+RC insertIntoNodeAfterSplitting(BTreeManager * treeManager, NodePath * path, Node * parent, int left_index, NodeKey * key, int right);
+RC insertIntoParent(BTreeManager * treeManager, NodePath * path, int left, NodeKey * key, int right);
+RC insertIntoNewRoot(BTreeManager * treeManager, int left, NodeKey * key, int right);
 
 // Functions to support deleting of an element (record) in the B+ Tree
-Node * adjustRoot(Node * root);
-Node * mergeNodes(BTreeManager * treeManager, Node * n, Node * neighbor, int neighbor_index, int k_prime);
-Node * redistributeNodes(Node * root, Node * n, Node * neighbor, int neighbor_index, int k_prime_index, int k_prime);
-Node * deleteEntry(BTreeManager * treeManager, Node * n, Value * key, void * pointer);
-Node * delete(BTreeManager * treeManager, Value * key);
-Node * removeEntryFromNode(BTreeManager * treeManager, Node * n, Value * key, Node * pointer);
-int getNeighborIndex(Node * n);
+RC adjustRoot(BTreeManager * treeManager, Node * root);
+RC mergeNodes(BTreeManager * treeManager, NodePath * path, Node * n, Node * neighbor, int neighbor_index, Node * parent, int k_prime_index);
+RC redistributeNodes(BTreeManager * treeManager, Node * n, Node * neighbor, int neighbor_index, Node * parent, int k_prime_index);
+RC deleteEntry(BTreeManager * treeManager, NodePath * path, Node * n, int index);
+RC delete(BTreeManager * treeManager, Value * key, RID * rid);
+void removeEntryFromNode(Node * n, int index);
+RC freeNode(BTreeManager * treeManager, Node * n);
+
+// Functions to store the RIDs of keys which have several of them
+RC createPostingList(BTreeManager * treeManager, RID * rids, int numRids, int * firstPage);
+RC readPostings(BTreeManager * treeManager, int pageNum, PostingHeader * header, RID * rids);
+RC getFirstPosting(BTreeManager * treeManager, RID * ref, RID * rid);
+RC addPosting(BTreeManager * treeManager, RID * ref, RID rid);
+RC removePosting(BTreeManager * treeManager, RID * ref, RID rid);
+RC freePostingList(BTreeManager * treeManager, int firstPage, int * numRids);
+int compareRids(RID rid, RID other);
+
+// Functions to build a B+ Tree from many entries at once
+RC bulkLoad(BTreeManager * treeManager, BulkEntry * entries, int numEntries, float fillFactor);
 
 // Functions to support KEYS of multiple datatypes.
-bool isLess(Value * key1, Value * key2);
-bool isGreater(Value * key1, Value * key2);
-bool isEqual(Value * key1, Value * key2);
+void makeKey(NodeKey * nodeKey, Value * key);
+void makeValue(Value * value, NodeKey * nodeKey);
+int compareKey(Value * key, Node * node, int index);
+int compareValues(Value * key, Value * other);
+RC encodeCompositeKey(BTreeManager * treeManager, Value * values, char * buffer);
+int decodeCompositeKey(BTreeManager * treeManager, char * key, Value * values, char * strings);
 
 #endif // BTREE_IMPLEMENT_H
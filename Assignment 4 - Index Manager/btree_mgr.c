@@ -4,53 +4,56 @@
 #include "buffer_mgr.h"
 #include "tables.h"
 #include "btree_implement.h"
-
-// This structure stores the metadata for our Index Manager
-BTreeManager * treeManager = NULL;
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// Number of pages of the buffer pool of an open index
+#define INDEX_BUFFER_PAGES 1000
+
+// The open indexes. Every index file is opened once, with one BTreeManager and one buffer pool which all handles of it share,
+// so that any number of indexes (e.g. one per column of a table) can be open at the same time.
+static BTreeManager * openIndexes = NULL;
+static pthread_mutex_t openIndexesLatch = PTHREAD_MUTEX_INITIALIZER;
+
+// This function returns the open index with the file name "idxId", or NULL if it is not open. The caller holds openIndexesLatch.
+static BTreeManager * findOpenIndex(char *idxId) {
+	BTreeManager *manager;
+
+	for (manager = openIndexes; manager != NULL; manager = manager->nextOpen)
+		if (strcmp(manager->idxId, idxId) == 0)
+			return manager;
+	return NULL;
+}
 
 // This function initializes our Index Manager.
 RC initIndexManager(void *mgmtData) {
 	initStorageManager();
+
+	// Use the fastest search of the keys within a node that this CPU supports.
+	selectKeySearch();
 	//printf("\n initIndexManager SUCCESS");
 	return RC_OK;
 }
 
-// This function shutdowns the Index Manager.
+// This function shutdowns the Index Manager. All indexes must have been closed.
 RC shutdownIndexManager() {
-	treeManager = NULL;
+	bool open;
+
+	pthread_mutex_lock(&openIndexesLatch);
+	open = openIndexes != NULL;
+	pthread_mutex_unlock(&openIndexesLatch);
+	if (open)
+		return RC_IM_INDEX_OPEN;
 	//printf("\n shutdownIndexManager SUCCESS");
 	return RC_OK;
 }
 
-// This function creates a new B+ Tree with name "idxId",
-// datatype of the key as "keyType" and order specified by "n".
-RC createBtree(char *idxId, DataType keyType, int n) {
-	int maxNodes = PAGE_SIZE / sizeof(Node);
-
-	// Return error if we cannot accommodate a B++ Tree of that order.
-	if (n > maxNodes) {
-		printf("\n n = %d > Max. Nodes = %d \n", n, maxNodes);
-		return RC_ORDER_TOO_HIGH_FOR_PAGE;
-	}
-
-	// Initialize the members of our B+ Tree metadata structure.
-	treeManager = (BTreeManager *) malloc(sizeof(BTreeManager));
-	treeManager->order = n + 2;		// Setting order of B+ Tree
-	treeManager->numNodes = 0;		// No nodes initially.
-	treeManager->numEntries = 0;	// No entries initially
-	treeManager->root = NULL;		// No root node
-	treeManager->queue = NULL;		// No node for printing
-	treeManager->keyType = keyType;	// Set datatype to "keyType"
-
-	// Initialize Buffer Manager and store in our structure.
-	BM_BufferPool * bm = (BM_BufferPool *) malloc(sizeof(BM_BufferPool));
-	treeManager->bufferPool = *bm;
-
+// This function creates the index file "idxId" whose first page is the metadata page "data".
+static RC createIndexFile(char *idxId, char *data) {
 	SM_FileHandle fileHandler;
 	RC result;
 
-	char data[PAGE_SIZE];
-
 	// Create page file. Return error code if error occurs.
 	if ((result = createPageFile(idxId)) != RC_OK)
 		return result;
@@ -59,9 +62,11 @@ RC createBtree(char *idxId, DataType keyType, int n) {
 	if ((result = openPageFile(idxId, &fileHandler)) != RC_OK)
 		return result;
 
-	// Write empty content to page.  Return error code if error occurs.
-	if ((result = writeBlock(0, &fileHandler, data)) != RC_OK)
+	// Write the metadata to the first page.  Return error code if error occurs.
+	if ((result = writeBlock(METADATA_PAGE, &fileHandler, data)) != RC_OK) {
+		closePageFile(&fileHandler);
 		return result;
+	}
 
 	// Close page file.  Return error code if error occurs.
 	if ((result = closePageFile(&fileHandler)) != RC_OK)
@@ -71,116 +76,270 @@ RC createBtree(char *idxId, DataType keyType, int n) {
 	return (RC_OK);
 }
 
+// This function creates a new B+ Tree with name "idxId",
+// datatype of the key as "keyType" and order specified by "n".
+RC createBtree(char *idxId, DataType keyType, int n) {
+	// A key of one attribute, with one RID per key.
+	return createCompositeBtree(idxId, &keyType, 1, n, TRUE);
+}
+
+// This function creates a new B+ Tree with name "idxId" and order specified by "n", whose keys consist of "numKeyAttrs"
+// attributes with the datatypes "keyTypes" (for a table, the datatypes of the schema's keyAttrs).
+// Keys of more than one attribute are passed to the index functions as an array with one value per attribute and are
+// ordered lexicographically. If "unique" is FALSE, a key may be inserted with several RIDs.
+RC createCompositeBtree(char *idxId, DataType *keyTypes, int numKeyAttrs, int n, bool unique) {
+	if (numKeyAttrs < 1 || numKeyAttrs > MAX_KEY_ATTRS)
+		return RC_ERROR;
+
+	// Composite keys are stored in the nodes like DT_STRING keys, see encodeCompositeKey(...).
+	DataType keyType = numKeyAttrs == 1 ? keyTypes[0] : DT_STRING;
+	int maxKeys = getMaxKeys(keyType);
+
+	// A node holds up to n + 1 keys. Return error if we cannot accommodate them on one page.
+	if (n + 1 > maxKeys)
+		return RC_ORDER_TOO_HIGH_FOR_PAGE;
+
+	// Initialize the members of our B+ Tree metadata structure.
+	BTreeMetadata metadata;
+	memset(&metadata, 0, sizeof(BTreeMetadata));
+	metadata.keyType = keyType;		// Set datatype of the keys in the nodes to "keyType"
+	metadata.unique = unique;		// Whether a key may have several RIDs
+	metadata.numKeyAttrs = numKeyAttrs;
+	memcpy(metadata.keyTypes, keyTypes, numKeyAttrs * sizeof(DataType));
+	metadata.order = n + 2;			// Setting order of B+ Tree
+	metadata.rootPage = NO_PAGE;	// No root node
+	metadata.numNodes = 0;			// No nodes initially.
+	metadata.numEntries = 0;		// No entries initially
+	metadata.numPages = 1;			// Only the metadata page
+	metadata.freePage = NO_PAGE;	// No free pages
+
+	char data[PAGE_SIZE];
+	memset(data, 0, PAGE_SIZE);
+	memcpy(data, &metadata, sizeof(BTreeMetadata));
+
+	// An open index would lose its file under its buffer pool.
+	RC result;
+	pthread_mutex_lock(&openIndexesLatch);
+	result = findOpenIndex(idxId) != NULL ? RC_IM_INDEX_OPEN : createIndexFile(idxId, data);
+	pthread_mutex_unlock(&openIndexesLatch);
+	return result;
+}
+
+// This function loads the B+ Tree stored in the index file "idxId" into a new BTreeManager with its own buffer pool.
+static RC loadIndex(char *idxId, BTreeManager **manager) {
+	BTreeManager *treeManager = (BTreeManager *) malloc(sizeof(BTreeManager));
+	RC result;
+
+	treeManager->idxId = strdup(idxId);
+	treeManager->numHandles = 0;
+
+	// Initialize a Buffer Pool using Buffer Manager. The nodes are pinned through it,
+	// so with LRU the upper levels of the tree stay in memory.
+	if ((result = initBufferPool(&treeManager->bufferPool, treeManager->idxId, INDEX_BUFFER_PAGES, RS_LRU, NULL)) != RC_OK) {
+		free(treeManager->idxId);
+		free(treeManager);
+		return result;
+	}
+
+	// Load the B+ Tree's metadata from the first page of the index file.
+	if ((result = readMetadata(treeManager)) != RC_OK) {
+		shutdownBufferPool(&treeManager->bufferPool);
+		free(treeManager->idxId);
+		free(treeManager);
+		return result;
+	}
+	setNodeLayout(treeManager);
+
+	// Several threads may use the tree at the same time, see the LATCHING PROTOCOL.
+	pthread_mutex_init(&treeManager->structureLatch, NULL);
+	pthread_mutex_init(&treeManager->pageLatch, NULL);
+	treeManager->numLatched = 0;
+
+	*manager = treeManager;
+	return RC_OK;
+}
+
 // This functions opens an existing B+ Tree from the specified page "idxId"
+// If the index is open already, the new handle shares its BTreeManager and buffer pool with the other handles.
 RC openBtree(BTreeHandle **tree, char *idxId) {
+	BTreeManager *treeManager;
+	RC result = RC_OK;
+
+	pthread_mutex_lock(&openIndexesLatch);
+	if ((treeManager = findOpenIndex(idxId)) == NULL && (result = loadIndex(idxId, &treeManager)) == RC_OK) {
+		treeManager->nextOpen = openIndexes;
+		openIndexes = treeManager;
+	}
+	if (result == RC_OK)
+		treeManager->numHandles++;
+	pthread_mutex_unlock(&openIndexesLatch);
+	if (result != RC_OK)
+		return result;
+
 	// Retrieve B+ Tree handle and assign our metadata structure
 	*tree = (BTreeHandle *) malloc(sizeof(BTreeHandle));
+	(*tree)->keyType = treeManager->keyTypes[0];
+	(*tree)->idxId = idxId;
 	(*tree)->mgmtData = treeManager;
 
-	// Initialize a Buffer Pool using Buffer Manager
-	RC result = initBufferPool(&treeManager->bufferPool, idxId, 1000, RS_FIFO, NULL);
-
-	if (result == RC_OK) {
-		//printf("\n openBtree SUCCESS");
-		return RC_OK;
-	}
-	return result;
+	//printf("\n openBtree SUCCESS");
+	return RC_OK;
 }
 
-// This function closes the B+ Tree, shutdowns the buffer pool and
-// de-allocates all utilized memory space.
+// This function closes a handle of the B+ Tree. When the last handle of the index is closed, it writes the metadata and
+// all modified nodes back to the index file, shutdowns the buffer pool and de-allocates all utilized memory space.
 RC closeBtree(BTreeHandle *tree) {
 	// Retrieve B+ Tree's metadata information.
-	BTreeManager * treeManager = (BTreeManager*) tree->mgmtData;
-
-	// Mark page dirty so that it can written back to the disk.
-	markDirty(&treeManager->bufferPool, &treeManager->pageHandler);
-
-	// Shutdown the buffer pool.
-	shutdownBufferPool(&treeManager->bufferPool);
+	BTreeManager * manager = (BTreeManager*) tree->mgmtData;
+	BTreeManager ** link;
+	RC result = RC_OK;
+
+	pthread_mutex_lock(&openIndexesLatch);
+	if (manager->numHandles == 1) {
+		// Store the metadata on the first page so that the B+ Tree can be opened again.
+		// Then shutdown the buffer pool. This writes all dirty nodes back to the disk.
+		if ((result = writeMetadata(manager)) == RC_OK)
+			result = shutdownBufferPool(&manager->bufferPool);
+		if (result != RC_OK) {
+			pthread_mutex_unlock(&openIndexesLatch);
+			return result;
+		}
 
-	// Release memory space.
-	free(treeManager);
+		// Remove the index from the open indexes and release memory space.
+		for (link = &openIndexes; *link != manager; link = &(*link)->nextOpen)
+			;
+		*link = manager->nextOpen;
+		pthread_mutex_destroy(&manager->structureLatch);
+		pthread_mutex_destroy(&manager->pageLatch);
+		free(manager->idxId);
+		free(manager);
+	} else
+		manager->numHandles--;
+	pthread_mutex_unlock(&openIndexesLatch);
 	free(tree);
 
 	//printf("\n closeBtree SUCCESS");
 	return RC_OK;
 }
 
-// This method deleted the B+ Tree by deleting the associated page with it.
+// This method deleted the B+ Tree by deleting the associated page with it. The index must not be open.
 RC deleteBtree(char *idxId) {
 	RC result;
-	if ((result = destroyPageFile(idxId)) != RC_OK)
+
+	pthread_mutex_lock(&openIndexesLatch);
+	result = findOpenIndex(idxId) != NULL ? RC_IM_INDEX_OPEN : destroyPageFile(idxId);
+	pthread_mutex_unlock(&openIndexesLatch);
+	if (result != RC_OK)
 		return result;
 	//printf("\n deleteBtree SUCCESS");
 	return RC_OK;
 }
 
+// This function turns a key given to the index manager into the key stored in the nodes. A composite key, given as an
+// array with one value per key attribute, is encoded into a DT_STRING key in "buffer" (see encodeCompositeKey(...)).
+static RC getTreeKey(BTreeManager *treeManager, Value *key, Value *treeKey, char *buffer) {
+	if (treeManager->numKeyAttrs == 1) {
+		*treeKey = *key;
+		return RC_OK;
+	}
+	treeKey->dt = DT_STRING;
+	treeKey->v.stringV = buffer;
+	return encodeCompositeKey(treeManager, key, buffer);
+}
+
 // This function adds a new entry/record with the specified key and RID.
+// If the B+ Tree allows duplicate keys, an existing key gets the RID in addition to its other RIDs.
 RC insertKey(BTreeHandle *tree, Value *key, RID rid) {
 	// Retrieve B+ Tree's metadata information.
 	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
-	NodeData * pointer;
-	Node * leaf;
-
-	int bTreeOrder = treeManager->order;
+	char buffer[MAX_STRING_KEY_LENGTH + 1];
+	Value treeKey;
+	NodeData pointer;
+	RC result;
 
-	//printf("\n INSERTING KEY = %d and rid = %d", key->v.intV, rid.page);
-	//printf("\n INSERTING page = %d and slot = %d", rid.page, rid.slot);
+	// A negative slot is not the RID of a record. The leaves use it to refer to posting lists.
+	if (rid.slot < 0)
+		return RC_ERROR;
 
-	// Check is a record with the spcified key already exists.
-	if (findRecord(treeManager->root, key) != NULL) {
-		printf("\n insertKey :: KEY EXISTS");
-		return RC_IM_KEY_ALREADY_EXISTS;
-	}
+	// String keys are stored inside the node pages, so they cannot be longer than MAX_STRING_KEY_LENGTH.
+	if (treeManager->numKeyAttrs == 1 && key->dt == DT_STRING && strlen(key->v.stringV) > MAX_STRING_KEY_LENGTH)
+		return RC_IM_KEY_TOO_LONG;
+	if ((result = getTreeKey(treeManager, key, &treeKey, buffer)) != RC_OK)
+		return result;
 
 	// Create a new record (NodeData) for the value RID.
-	pointer = makeRecord(&rid);
+	pointer.rid = rid;
 
-	// If the tree doesn't exist yet, create a new tree.
-	if (treeManager->root == NULL) {
-		treeManager->root = createNewTree(treeManager, key, pointer);
-		//printf("\n insertKey :: First Node created");
-		//printTree(tree);
-		return RC_OK;
-	}
+	// Insert it into the leaf where the key belongs, creating the tree if it doesn't exist yet.
+	return insert(treeManager, &treeKey, &pointer);
+}
 
-	// If the tree already exists, then find a leaf where the key can be inserted.
-	leaf = findLeaf(treeManager->root, key);
+// This method searches the B+ Tree for the specified key and if found stores the RID (value)
+// for that key in the memory location pointed by "result" parameter. For a key with several RIDs, that is the first of them.
+extern RC findKey(BTreeHandle *tree, Value *key, RID *result) {
+	// Retrieve B+ Tree's metadata information.
+	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	char buffer[MAX_STRING_KEY_LENGTH + 1];
+	Value treeKey;
+	NodeData r;
+	RC rc;
 
-	if (leaf->num_keys < bTreeOrder - 1) {
-		// If the leaf has room for the new key, then insert the new key into that leaf.
-		leaf = insertIntoLeaf(treeManager, leaf, key, pointer);
-	} else {
-		// If the leaf dows not have room for the new key, split leaf and then insert the new key into that leaf.
-		treeManager->root = insertIntoLeafAfterSplitting(treeManager, leaf, key, pointer);
-	}
+	if ((rc = getTreeKey(treeManager, key, &treeKey, buffer)) != RC_OK)
+		return rc;
 
-	// Print the B+ Tree for debugging purpose.
-	//printf("\n");
-	//printTree(tree);
+	// Search the tree for the specified key.
+	// If it is not found, then the key does not exist in the B+ Tree.
+	rc = findRecord(treeManager, &treeKey, &r);
+	if (rc != RC_OK)
+		return rc;
+
+	// If found, then store the value (RID) to "result"
+	*result = r.rid;
 	return RC_OK;
 }
 
-// This method searches the B+ Tree for the specified key and if found stores the RID (value)
-// for that key in the memory location pointed by "result" parameter.
-extern RC findKey(BTreeHandle *tree, Value *key, RID *result) {
+// This method searches the B+ Tree for "numKeys" keys at once. For every key keys[i], status[i] is set to RC_OK and
+// the RID is stored in results[i] if the key is found, or status[i] is set to RC_IM_KEY_NOT_FOUND.
+// The keys may be in any order, but lookups are fastest if many of them are close to each other in the key order.
+// Composite keys are passed one after the other, i.e. key i starts at keys[i * number of key attributes].
+extern RC findKeys(BTreeHandle *tree, Value *keys, int numKeys, RID *results, RC *status) {
 	// Retrieve B+ Tree's metadata information.
 	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	Value *treeKeys;
+	char *buffers;
+	int i;
+	RC result;
 
-	// Search the tree for the specified key.
-	NodeData * r = findRecord(treeManager->root, key);
+	// Search the tree for all keys together, sharing the nodes visited by keys which are close.
+	if (treeManager->numKeyAttrs == 1)
+		return findRecords(treeManager, keys, numKeys, results, status);
 
-	// If returned record is NULL, then the key does not exist in the B+ Tree.
-	if (r == NULL) {
-		return RC_IM_KEY_NOT_FOUND;
-	} else {
-		//printf("NodeData -- key %d, page %d, slot = %d \n", key->v.intV, r->rid.page, r->rid.slot);
-	}
+	// Encode all composite keys first.
+	treeKeys = (Value *) malloc((numKeys > 0 ? numKeys : 1) * sizeof(Value));
+	buffers = (char *) malloc((numKeys > 0 ? numKeys : 1) * (MAX_STRING_KEY_LENGTH + 1));
+	for (i = 0, result = RC_OK; i < numKeys && result == RC_OK; i++)
+		result = getTreeKey(treeManager, &keys[i * treeManager->numKeyAttrs], &treeKeys[i], buffers + i * (MAX_STRING_KEY_LENGTH + 1));
+	if (result == RC_OK)
+		result = findRecords(treeManager, treeKeys, numKeys, results, status);
 
-	// If not NULL, then store the value (RID) to "result"
-	*result = r->rid;
-	return RC_OK;
+	free(treeKeys);
+	free(buffers);
+	return result;
+}
+
+// This method searches the B+ Tree for all RIDs of the specified key and stores up to "maxResults" of them, in RID order,
+// in "results". "numResults" is set to the number of RIDs of the key, which may be more than "maxResults".
+extern RC findKeyEntries(BTreeHandle *tree, Value *key, RID *results, int maxResults, int *numResults) {
+	// Retrieve B+ Tree's metadata information.
+	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	char buffer[MAX_STRING_KEY_LENGTH + 1];
+	Value treeKey;
+	RC result;
+
+	*numResults = 0;
+	if ((result = getTreeKey(treeManager, key, &treeKey, buffer)) != RC_OK)
+		return result;
+	return findAllRecords(treeManager, &treeKey, results, maxResults, numResults);
 }
 
 // This function retrieves the number of nodes present in the B+ Tree.
@@ -207,163 +366,532 @@ RC getNumEntries(BTreeHandle *tree, int *result) {
 	return RC_OK;
 }
 
-// This function retrieves the datatype of the keys in the B+ Tree.
+// This function retrieves the datatype of the keys (of the first key attribute) in the B+ Tree.
 // The result is stored in the memory location pointed by "result" parameter.
 RC getKeyType(BTreeHandle *tree, DataType *result) {
 	// Retrieve B+ Tree's metadata information.
 	BTreeManager * treeManager = (BTreeManager *) tree->mgmtData;
 
 	// Set the "result" content to keyType which stores the datatype of the Key found in our metadata.
-	*result = treeManager->keyType;
+	*result = treeManager->keyTypes[0];
 	return RC_OK;
 }
 
-// This function deletes the entry/record with the specified "key" in the B+ Tree.
+// This function deletes the entry/record with the specified "key" in the B+ Tree, with all of its RIDs.
 RC deleteKey(BTreeHandle *tree, Value *key) {
 	// Retrieve B+ Tree's metadata information.
 	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	char buffer[MAX_STRING_KEY_LENGTH + 1];
+	Value treeKey;
+	RC result;
+
+	if ((result = getTreeKey(treeManager, key, &treeKey, buffer)) != RC_OK)
+		return result;
 
 	// Deleting the entry with the specified key.
-	treeManager->root = delete(treeManager, key);
-	//printTree(tree);
-	return RC_OK;
+	return delete(treeManager, &treeKey, NULL);
+}
+
+// This function deletes one RID of the specified "key" in the B+ Tree. The key is deleted with its last RID.
+RC deleteKeyEntry(BTreeHandle *tree, Value *key, RID rid) {
+	// Retrieve B+ Tree's metadata information.
+	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	char buffer[MAX_STRING_KEY_LENGTH + 1];
+	Value treeKey;
+	RC result;
+
+	if ((result = getTreeKey(treeManager, key, &treeKey, buffer)) != RC_OK)
+		return result;
+
+	// Deleting the RID, and the entry if it was the key's only RID.
+	return delete(treeManager, &treeKey, &rid);
 }
 
 // This function initializes the scan which is used to scan the entries in the B+ Tree.
 RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle) {
+	// Scan the whole key range in ascending order.
+	return openTreeRangeScan(tree, NULL, FALSE, NULL, FALSE, FALSE, handle);
+}
+
+// This function reads the posting list page "pageNum" into the scan and positions the scan on its first RID
+// (on its last RID for a reverse scan). If "last" is TRUE, "pageNum" is the first page of a posting list
+// and the last page of the list is read instead. "valid" is set to FALSE if the current leaf changed meanwhile,
+// in which case the page may not have belonged to the posting list any more.
+static RC readScanPostings(ScanManager *scanmeta, int pageNum, bool last, bool *valid) {
+	PostingHeader header;
+	RC rc;
+
+	if ((rc = readPostings(scanmeta->treeManager, pageNum, &header, scanmeta->postings)) != RC_OK)
+		return rc;
+	if (!(*valid = checkVersion(&scanmeta->leaf, scanmeta->version)))
+		return RC_OK;
+	if (last && header.tail != pageNum)
+		return readScanPostings(scanmeta, header.tail, FALSE, valid);
+
+	scanmeta->numPostings = header.numRids;
+	scanmeta->postingIndex = scanmeta->reverse ? header.numRids - 1 : 0;
+	scanmeta->postingPage = scanmeta->reverse ? header.prev : header.next;
+	return RC_OK;
+}
+
+// This function positions the scan on the first RID after "lastRid" (before it for a reverse scan) in the posting list
+// whose first page is "pageNum". If there is none, the posting list is used up.
+static RC seekScanPostings(ScanManager *scanmeta, int pageNum, bool *valid) {
+	int step = scanmeta->reverse ? -1 : 1;
+	RC rc;
+
+	if ((rc = readScanPostings(scanmeta, pageNum, scanmeta->reverse, valid)) != RC_OK || !*valid)
+		return rc;
+	while (TRUE) {
+		// Skip the RIDs of the page which were returned already.
+		while (scanmeta->postingIndex >= 0 && scanmeta->postingIndex < scanmeta->numPostings
+				&& compareRids(scanmeta->postings[scanmeta->postingIndex], scanmeta->lastRid) * step <= 0)
+			scanmeta->postingIndex += step;
+		if ((scanmeta->postingIndex >= 0 && scanmeta->postingIndex < scanmeta->numPostings) || scanmeta->postingPage == NO_PAGE)
+			return RC_OK;
+		if ((rc = readScanPostings(scanmeta, scanmeta->postingPage, FALSE, valid)) != RC_OK || !*valid)
+			return rc;
+	}
+}
+
+// This function positions the scan on the first entry of the range, or, once entries were returned, on the entry after
+// the last one returned. It descends from the root to the leaf with that entry and copies the leaf.
+// The entry may also be on the next (previous) leaf, in which case the index is just past the end of the leaf.
+static RC positionScan(ScanManager *scanmeta) {
+	BTreeManager *treeManager = scanmeta->treeManager;
+	int step = scanmeta->reverse ? -1 : 1;
+	Value lastKey;
+	RID rid;
+	int index;
+	bool valid;
+	RC rc;
+
+	if (scanmeta->leafPage != NO_PAGE)
+		releaseNode(treeManager, &scanmeta->leaf);
+	scanmeta->leafPage = NO_PAGE;
+	if (scanmeta->hasLast)
+		makeValue(&lastKey, &scanmeta->lastKey);
+
+	while (TRUE) {
+		scanmeta->postingPage = NO_PAGE;
+		scanmeta->postingIndex = 0;
+		scanmeta->numPostings = 0;
+
+		// Without a start key, that is the leftmost leaf (the rightmost leaf for a reverse scan).
+		if (scanmeta->hasLast)
+			rc = findLeaf(treeManager, &lastKey, NULL, &scanmeta->leaf, &scanmeta->version);
+		else if (scanmeta->hasStart)
+			rc = findLeaf(treeManager, &scanmeta->start, NULL, &scanmeta->leaf, &scanmeta->version);
+		else
+			rc = findOuterLeaf(treeManager, scanmeta->reverse, &scanmeta->leaf, &scanmeta->version);
+
+		// If the tree has become empty, there are no more entries.
+		if (rc == RC_IM_KEY_NOT_FOUND)
+			return RC_OK;
+		if (rc != RC_OK)
+			return rc;
+		scanmeta->leafPage = scanmeta->leaf.page.pageNum;
+		if (!copyNode(treeManager, &scanmeta->leaf, scanmeta->version, &scanmeta->node, scanmeta->leafData)) {
+			releaseNode(treeManager, &scanmeta->leaf);
+			scanmeta->leafPage = NO_PAGE;
+			continue;
+		}
+
+		if (!scanmeta->hasLast) {
+			if (!scanmeta->hasStart)
+				scanmeta->keyIndex = scanmeta->reverse ? scanmeta->node.header->numKeys - 1 : 0;
+			else if (scanmeta->reverse)
+				scanmeta->keyIndex = (scanmeta->startInclusive ? findEntryAfter(&scanmeta->node, &scanmeta->start) : findEntry(&scanmeta->node, &scanmeta->start)) - 1;
+			else
+				scanmeta->keyIndex = scanmeta->startInclusive ? findEntry(&scanmeta->node, &scanmeta->start) : findEntryAfter(&scanmeta->node, &scanmeta->start);
+			return RC_OK;
+		}
+
+		// Find the last key returned. If it is still there, continue with its RIDs after the last one returned.
+		index = scanmeta->reverse ? findEntryAfter(&scanmeta->node, &lastKey) - 1 : findEntry(&scanmeta->node, &lastKey);
+		scanmeta->keyIndex = index;
+		if (index < 0 || index >= scanmeta->node.header->numKeys || compareKey(&lastKey, &scanmeta->node, index) != 0)
+			return RC_OK;
+
+		rid = scanmeta->node.pointers.rids[index];
+		if (rid.slot != POSTING_LIST_SLOT) {
+			if (compareRids(rid, scanmeta->lastRid) * step <= 0)
+				scanmeta->keyIndex += step;
+			return RC_OK;
+		}
+		scanmeta->keyIndex += step;
+		if ((rc = seekScanPostings(scanmeta, rid.page, &valid)) != RC_OK || valid)
+			return rc;
+
+		// The leaf changed while its posting list was read.
+		releaseNode(treeManager, &scanmeta->leaf);
+		scanmeta->leafPage = NO_PAGE;
+	}
+}
+
+// This function moves the scan to the next (previous) leaf once the current leaf is used up, or finishes the scan.
+// The current leaf is checked to be unchanged after the next leaf's version is read, so the next leaf is still its neighbor.
+// Otherwise the scan finds its place again from the root.
+static RC moveScan(ScanManager *scanmeta) {
+	BTreeManager *treeManager = scanmeta->treeManager;
+	unsigned int version;
+	Node next;
+	int pageNum;
+	RC rc;
+
+	pageNum = scanmeta->reverse ? scanmeta->node.header->prev : scanmeta->node.header->next;
+
+	// If no next leaf, it means no more entries to be scanned..
+	if (pageNum == NO_PAGE) {
+		releaseNode(treeManager, &scanmeta->leaf);
+		scanmeta->leafPage = NO_PAGE;
+		return RC_OK;
+	}
+
+	if ((rc = getNode(treeManager, pageNum, &next)) != RC_OK)
+		return rc;
+	version = readVersion(&next);
+	if (!checkVersion(&scanmeta->leaf, scanmeta->version) || !copyNode(treeManager, &next, version, &scanmeta->node, scanmeta->leafData)) {
+		releaseNode(treeManager, &next);
+		return positionScan(scanmeta);
+	}
+
+	releaseNode(treeManager, &scanmeta->leaf);
+	scanmeta->leaf = next;
+	scanmeta->version = version;
+	scanmeta->leafPage = pageNum;
+	scanmeta->keyIndex = scanmeta->reverse ? scanmeta->node.header->numKeys - 1 : 0;
+	return RC_OK;
+}
+
+// This function initializes a scan of the entries with keys between "low" and "high". A NULL bound leaves that end of the range open.
+// "lowInclusive" / "highInclusive" tell whether entries with a key equal to the bound are part of the range.
+// The scan returns the entries in ascending key order, or in descending key order if "reverse" is TRUE.
+// Other threads may change the tree during the scan. Every entry which is in the range during the whole scan is returned once.
+RC openTreeRangeScan(BTreeHandle *tree, Value *low, bool lowInclusive, Value *high, bool highInclusive, bool reverse, BT_ScanHandle **handle) {
 	// Retrieve B+ Tree's metadata information.
 	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	ScanManager *scanmeta;
+	char lowBuffer[MAX_STRING_KEY_LENGTH + 1];
+	char highBuffer[MAX_STRING_KEY_LENGTH + 1];
+	Value lowKey, highKey;
+	Value *start, *end;
+	RC result;
+
+	if (getRootPage(treeManager) == NO_PAGE) {
+		//printf("Empty tree.\n");
+		return RC_NO_RECORDS_TO_SCAN;
+	}
+
+	// Use the keys as they are stored in the nodes.
+	if (low != NULL) {
+		if ((result = getTreeKey(treeManager, low, &lowKey, lowBuffer)) != RC_OK)
+			return result;
+		low = &lowKey;
+	}
+	if (high != NULL) {
+		if ((result = getTreeKey(treeManager, high, &highKey, highBuffer)) != RC_OK)
+			return result;
+		high = &highKey;
+	}
+	start = reverse ? high : low;
+	end = reverse ? low : high;
 
 	// Retrieve B+ Tree Scan's metadata information.
-	ScanManager *scanmeta = malloc(sizeof(ScanManager));
+	scanmeta = malloc(sizeof(ScanManager));
+
+	// Initializing (setting) the Scan's metadata information. The keys are copied because the caller may free them.
+	scanmeta->leafPage = NO_PAGE;
+	scanmeta->treeManager = treeManager;
+	scanmeta->reverse = reverse;
+	scanmeta->hasStart = start != NULL;
+	scanmeta->startInclusive = reverse ? highInclusive : lowInclusive;
+	scanmeta->hasEnd = end != NULL;
+	scanmeta->endInclusive = reverse ? lowInclusive : highInclusive;
+	scanmeta->hasLast = FALSE;
+	if (start != NULL) {
+		scanmeta->start = *start;
+		if (start->dt == DT_STRING)
+			scanmeta->start.v.stringV = strdup(start->v.stringV);
+	}
+	if (end != NULL) {
+		scanmeta->end = *end;
+		if (end->dt == DT_STRING)
+			scanmeta->end.v.stringV = strdup(end->v.stringV);
+	}
 
 	// Allocating some memory space.
 	*handle = malloc(sizeof(BT_ScanHandle));
+	(*handle)->tree = tree;
+	(*handle)->mgmtData = scanmeta;
 
-	Node * node = treeManager->root;
-
-	if (treeManager->root == NULL) {
-		//printf("Empty tree.\n");
-		return RC_NO_RECORDS_TO_SCAN;
-	} else {
-		//printf("\n openTreeScan() ......... Inside ELse  ");
-		while (!node->is_leaf)
-			node = node->pointers[0];
-
-		// Initializing (setting) the Scan's metadata information.
-		scanmeta->keyIndex = 0;
-		scanmeta->totalKeys = node->num_keys;
-		scanmeta->node = node;
-		scanmeta->order = treeManager->order;
-		(*handle)->mgmtData = scanmeta;
-		//printf("\n keyIndex = %d, totalKeys = %d ", scanmeta->keyIndex, scanmeta->totalKeys);
+	// Descend once to the leaf with the first entry of the range.
+	if ((result = positionScan(scanmeta)) != RC_OK) {
+		closeTreeScan(*handle);
+		*handle = NULL;
 	}
-	return RC_OK;
+	return result;
 }
 
 // This function is used to traverse the entries in the B+ Tree.
 // It stores the record details i.e. RID in the memory location pointed by "result" parameter.
+// A key with several RIDs returns all of them, in RID order (in reverse RID order for a reverse scan).
 RC nextEntry(BT_ScanHandle *handle, RID *result) {
-	//printf("\n INSIDE nextEntry()...... ");
 	// Retrieve B+ Tree Scan's metadata information.
 	ScanManager * scanmeta = (ScanManager *) handle->mgmtData;
-
-	// Retrieving all the information.
-	int keyIndex = scanmeta->keyIndex;
-	int totalKeys = scanmeta->totalKeys;
-	int bTreeOrder = scanmeta->order;
+	BTreeManager * treeManager = scanmeta->treeManager;
+	int step = scanmeta->reverse ? -1 : 1;
+	int comparison;
+	bool valid;
 	RID rid;
+	RC rc;
 
-	//printf("\n keyIndex = %d, totalKeys = %d ", keyIndex, totalKeys);
-	Node * node = scanmeta->node;
+	while (TRUE) {
+		// Return error if there is no current leaf i.e. the scan is finished.
+		if (scanmeta->leafPage == NO_PAGE)
+			return RC_IM_NO_MORE_ENTRIES;
 
-	// Return error if current node is empty i.e. NULL
-	if (node == NULL) {
-		return RC_IM_NO_MORE_ENTRIES;
-	}
+		// Continue with the posting list of the previous key, reading its next (previous) page when a page is used up.
+		if (scanmeta->postingIndex >= 0 && scanmeta->postingIndex < scanmeta->numPostings) {
+			*result = scanmeta->lastRid = scanmeta->postings[scanmeta->postingIndex];
+			scanmeta->postingIndex += step;
+			return RC_OK;
+		}
+		if (scanmeta->postingPage != NO_PAGE) {
+			if ((rc = readScanPostings(scanmeta, scanmeta->postingPage, FALSE, &valid)) != RC_OK)
+				return rc;
+			if (!valid && (rc = positionScan(scanmeta)) != RC_OK)
+				return rc;
+			continue;
+		}
 
-	if (keyIndex < totalKeys) {
-		// If current key entry is present on the same leaf node.
-		rid = ((NodeData *) node->pointers[keyIndex])->rid;
-		//printf(" ... KEYS = %d", node->keys[keyIndex]->v.intV);
-		//printf("  page = %d, slot = %d  ", rid.page, rid.slot);
-		scanmeta->keyIndex++;
-	} else {
-		// If all the entries on the leaf node have been scanned, Go to next node...
-		if (node->pointers[bTreeOrder - 1] != NULL) {
-			node = node->pointers[bTreeOrder - 1];
-			scanmeta->keyIndex = 1;
-			scanmeta->totalKeys = node->num_keys;
-			scanmeta->node = node;
-			rid = ((NodeData *) node->pointers[0])->rid;
-			//printf("  page = %d, slot = %d  ", rid.page, rid.slot);
-		} else {
-			// If no next node, it means no more enteies to be scanned..
-			return RC_IM_NO_MORE_ENTRIES;
+		// If all the entries on the leaf node have been scanned, Go to next (or previous) leaf...
+		if (scanmeta->keyIndex >= scanmeta->node.header->numKeys || scanmeta->keyIndex < 0) {
+			if ((rc = moveScan(scanmeta)) != RC_OK)
+				return rc;
+			continue;
+		}
+
+		// Finish the scan at the first entry past the end of the range.
+		if (scanmeta->hasEnd) {
+			comparison = compareKey(&scanmeta->end, &scanmeta->node, scanmeta->keyIndex);
+			if (scanmeta->reverse)
+				comparison = -comparison;
+			if (comparison < 0 || (comparison == 0 && !scanmeta->endInclusive)) {
+				releaseNode(treeManager, &scanmeta->leaf);
+				scanmeta->leafPage = NO_PAGE;
+				return RC_IM_NO_MORE_ENTRIES;
+			}
 		}
+
+		// Store the record/result/RID. A key with several RIDs starts with the first (last) RID of its posting list.
+		rid = scanmeta->node.pointers.rids[scanmeta->keyIndex];
+		getKey(&scanmeta->node, scanmeta->keyIndex, &scanmeta->lastKey);
+		scanmeta->hasLast = TRUE;
+		scanmeta->keyIndex += step;
+		if (rid.slot != POSTING_LIST_SLOT) {
+			*result = scanmeta->lastRid = rid;
+			return RC_OK;
+		}
+
+		// None of the key's RIDs has been returned yet.
+		scanmeta->lastRid.page = scanmeta->reverse ? INT_MAX : -1;
+		scanmeta->lastRid.slot = scanmeta->reverse ? INT_MAX : -1;
+		if ((rc = readScanPostings(scanmeta, rid.page, scanmeta->reverse, &valid)) != RC_OK)
+			return rc;
+		if (!valid && (rc = positionScan(scanmeta)) != RC_OK)
+			return rc;
 	}
-	// Store the record/result/RID.
-	*result = rid;
-	return RC_OK;
 }
 
 // This function closes the scan mechanism and frees up resources.
 extern RC closeTreeScan(BT_ScanHandle *handle) {
+	ScanManager * scanmeta = (ScanManager *) handle->mgmtData;
+
+	// Unpin the current leaf if the scan did not run to its end.
+	if (scanmeta->leafPage != NO_PAGE)
+		releaseNode(scanmeta->treeManager, &scanmeta->leaf);
+
+	if (scanmeta->hasStart && scanmeta->start.dt == DT_STRING)
+		free(scanmeta->start.v.stringV);
+	if (scanmeta->hasEnd && scanmeta->end.dt == DT_STRING)
+		free(scanmeta->end.v.stringV);
+	free(scanmeta);
 	handle->mgmtData = NULL;
 	free(handle);
 	return RC_OK;
 }
 
+// This function builds an empty B+ Tree from "numEntries" keys and their RIDs in one pass instead of inserting them
+// one after the other. The keys need not be sorted. Each node is filled up to "fillFactor" (0 < fillFactor <= 1)
+// of its capacity, so that later inserts do not split every node at once.
+// If the B+ Tree allows duplicate keys, a key may be given several times with different RIDs.
+RC bulkLoadBtree(BTreeHandle *tree, Value **keys, RID *rids, int numEntries, float fillFactor) {
+	// Retrieve B+ Tree's metadata information.
+	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
+	BulkEntry *entries;
+	Value *treeKeys = NULL;
+	char *buffers = NULL;
+	bool flusherStarted;
+	int i;
+	RC result;
+
+	// The whole tree is built from scratch, so it must not have any entries yet.
+	if (getRootPage(treeManager) != NO_PAGE)
+		return RC_IM_TREE_NOT_EMPTY;
+	if (numEntries < 0 || fillFactor <= 0 || fillFactor > 1)
+		return RC_ERROR;
+
+	entries = (BulkEntry *) malloc((numEntries > 0 ? numEntries : 1) * sizeof(BulkEntry));
+	if (treeManager->numKeyAttrs > 1) {
+		treeKeys = (Value *) malloc((numEntries > 0 ? numEntries : 1) * sizeof(Value));
+		buffers = (char *) malloc((numEntries > 0 ? numEntries : 1) * (MAX_STRING_KEY_LENGTH + 1));
+	}
+	for (i = 0; i < numEntries; i++) {
+		entries[i].key = keys[i];
+		entries[i].rid = rids[i];
+
+		// A negative slot is not the RID of a record, see insertKey(...).
+		// String keys are stored inside the node pages, so they cannot be longer than MAX_STRING_KEY_LENGTH.
+		// A composite key is encoded into a string, which must fit as well.
+		if (rids[i].slot < 0)
+			result = RC_ERROR;
+		else if (treeKeys == NULL)
+			result = keys[i]->dt == DT_STRING && strlen(keys[i]->v.stringV) > MAX_STRING_KEY_LENGTH ? RC_IM_KEY_TOO_LONG : RC_OK;
+		else if ((result = getTreeKey(treeManager, keys[i], &treeKeys[i], buffers + i * (MAX_STRING_KEY_LENGTH + 1))) == RC_OK)
+			entries[i].key = &treeKeys[i];
+		if (result != RC_OK) {
+			free(entries);
+			free(treeKeys);
+			free(buffers);
+			return result;
+		}
+	}
+
+	// Let the background flusher write the new nodes while the tree is built. It writes runs of consecutive pages
+	// with one system call, and the nodes of each level are on consecutive pages.
+	flusherStarted = startBackgroundFlusher(&treeManager->bufferPool, treeManager->bufferPool.numPages / 4) == RC_OK;
+
+	// Inserts which create the root wait until the tree is built. One of them may have come first.
+	pthread_mutex_lock(&treeManager->structureLatch);
+	result = getRootPage(treeManager) != NO_PAGE ? RC_IM_TREE_NOT_EMPTY : bulkLoad(treeManager, entries, numEntries, fillFactor);
+	pthread_mutex_unlock(&treeManager->structureLatch);
+
+	if (flusherStarted)
+		stopBackgroundFlusher(&treeManager->bufferPool);
+	free(entries);
+	free(treeKeys);
+	free(buffers);
+	return result;
+}
+
+// This function prints the values of a composite key, as stored in the nodes.
+// A separator which ends within an attribute is printed with the attributes before it, followed by "...".
+static void printCompositeKey(BTreeManager *treeManager, char *key) {
+	Value values[MAX_KEY_ATTRS];
+	char strings[MAX_STRING_KEY_LENGTH + MAX_KEY_ATTRS];
+	int numValues, i;
+
+	numValues = decodeCompositeKey(treeManager, key, values, strings);
+	printf("(");
+	for (i = 0; i < numValues; i++) {
+		if (i > 0)
+			printf(",");
+		switch (values[i].dt) {
+		case DT_INT:
+			printf("%d", values[i].v.intV);
+			break;
+		case DT_FLOAT:
+			printf("%.02f", values[i].v.floatV);
+			break;
+		case DT_STRING:
+			printf("%s", values[i].v.stringV);
+			break;
+		case DT_BOOL:
+			printf("%d", values[i].v.boolV);
+			break;
+		}
+	}
+	if (numValues < treeManager->numKeyAttrs)
+		printf(numValues > 0 ? ",..." : "...");
+	printf(") ");
+}
+
 // This function prints the B+ Tree
 extern char *printTree(BTreeHandle *tree) {
 	BTreeManager *treeManager = (BTreeManager *) tree->mgmtData;
 	printf("\nPRINTING TREE:\n");
-	Node * n = NULL;
+	Node n;
+	NodeKey key;
+	int * queue;
+	int * levels;
+	int head = 0;
+	int tail = 0;
 	int i = 0;
 	int rank = 0;
-	int new_rank = 0;
 
-	if (treeManager->root == NULL) {
+	// The structure of the tree stays the same while it is printed, and each node is latched while it is printed.
+	pthread_mutex_lock(&treeManager->structureLatch);
+	if (treeManager->rootPage == NO_PAGE) {
+		pthread_mutex_unlock(&treeManager->structureLatch);
 		printf("Empty tree.\n");
 		return '\0';
 	}
-	treeManager->queue = NULL;
-	enqueue(treeManager, treeManager->root);
-	while (treeManager->queue != NULL) {
-		n = dequeue(treeManager);
-		if (n->parent != NULL && n == n->parent->pointers[0]) {
-			new_rank = path_to_root(treeManager->root, n);
-			if (new_rank != rank) {
-				rank = new_rank;
-				printf("\n");
-			}
+
+	// Visit the nodes level by level. Every node is queued once, so numNodes places are enough.
+	queue = (int *) malloc(treeManager->numNodes * sizeof(int));
+	levels = (int *) malloc(treeManager->numNodes * sizeof(int));
+	queue[tail] = treeManager->rootPage;
+	levels[tail++] = 0;
+
+	while (head < tail) {
+		if (getNode(treeManager, queue[head], &n) != RC_OK)
+			break;
+		latchNode(&n);
+		if (levels[head] != rank) {
+			rank = levels[head];
+			printf("\n");
 		}
+		head++;
 
 		// Print key depending on datatype of the key.
-		for (i = 0; i < n->num_keys; i++) {
-			switch (treeManager->keyType) {
+		for (i = 0; i < n.header->numKeys; i++) {
+			getKey(&n, i, &key);
+			if (treeManager->numKeyAttrs > 1)
+				printCompositeKey(treeManager, key.v.stringV);
+			else switch (treeManager->keyType) {
 			case DT_INT:
-				printf("%d ", (*n->keys[i]).v.intV);
+				printf("%d ", key.v.intV);
 				break;
 			case DT_FLOAT:
-				printf("%.02f ", (*n->keys[i]).v.floatV);
+				printf("%.02f ", key.v.floatV);
 				break;
 			case DT_STRING:
-				printf("%s ", (*n->keys[i]).v.stringV);
+				printf("%s ", key.v.stringV);
 				break;
 			case DT_BOOL:
-				printf("%d ", (*n->keys[i]).v.boolV);
+				printf("%d ", key.v.boolV);
 				break;
 			}
-			printf("(%d - %d) ", ((NodeData *) n->pointers[i])->rid.page, ((NodeData *) n->pointers[i])->rid.slot);
+			if (n.header->isLeaf && n.pointers.rids[i].slot == POSTING_LIST_SLOT)
+				printf("(posting list %d) ", n.pointers.rids[i].page);
+			else if (n.header->isLeaf)
+				printf("(%d - %d) ", n.pointers.rids[i].page, n.pointers.rids[i].slot);
 		}
-		if (!n->is_leaf)
-			for (i = 0; i <= n->num_keys; i++)
-				enqueue(treeManager, n->pointers[i]);
+		if (!n.header->isLeaf)
+			for (i = 0; i <= n.header->numKeys; i++) {
+				queue[tail] = n.pointers.children[i];
+				levels[tail++] = rank + 1;
+			}
 
+		unlatchNode(&n);
+		releaseNode(treeManager, &n);
 		printf("| ");
 	}
 	printf("\n");
+	pthread_mutex_unlock(&treeManager->structureLatch);
 
+	free(queue);
+	free(levels);
 	return '\0';
 }
@@ -22,6 +22,7 @@ extern RC shutdownIndexManager ();
 
 // create, destroy, open, and close an btree index
 extern RC createBtree (char *idxId, DataType keyType, int n);
+extern RC createCompositeBtree (char *idxId, DataType *keyTypes, int numKeyAttrs, int n, bool unique);
 extern RC openBtree (BTreeHandle **tree, char *idxId);
 extern RC closeBtree (BTreeHandle *tree);
 extern RC deleteBtree (char *idxId);
@@ -33,12 +34,19 @@ extern RC getKeyType (BTreeHandle *tree, DataType *result);
 
 // index access
 extern RC findKey (BTreeHandle *tree, Value *key, RID *result);
+extern RC findKeys (BTreeHandle *tree, Value *keys, int numKeys, RID *results, RC *status);
 extern RC insertKey (BTreeHandle *tree, Value *key, RID rid);
+extern RC findKeyEntries (BTreeHandle *tree, Value *key, RID *results, int maxResults, int *numResults);
 extern RC deleteKey (BTreeHandle *tree, Value *key);
+extern RC deleteKeyEntry (BTreeHandle *tree, Value *key, RID rid);
 extern RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle);
+extern RC openTreeRangeScan (BTreeHandle *tree, Value *low, bool lowInclusive, Value *high, bool highInclusive, bool reverse, BT_ScanHandle **handle);
 extern RC nextEntry (BT_ScanHandle *handle, RID *result);
 extern RC closeTreeScan (BT_ScanHandle *handle);
 
+// build an empty btree from many entries at once
+extern RC bulkLoadBtree (BTreeHandle *tree, Value **keys, RID *rids, int numEntries, float fillFactor);
+
 // debug and test functions
 extern char *printTree (BTreeHandle *tree);
 
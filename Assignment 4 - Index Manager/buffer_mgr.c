@@ -1,9 +1,70 @@
 #include<stdio.h>
 #include<stdlib.h>
+#include<pthread.h>
+#include<unistd.h>
+#include<time.h>
+#include<string.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include <math.h>
 
+// Number of independently latched partitions of the page table. It must be a power of two.
+#define PAGE_TABLE_PARTITIONS 16
+
+// LRU-K parameters. K itself is passed through stratData of initBufferPool(...) as an int (NULL selects LRU-2).
+#define LRU_K_DEFAULT_K 2
+// References to a page within this many page references of its previous reference are correlated
+// (e.g. a B+ tree node visited again by the same lookup) and are not counted as a new reference.
+// Small pools use at most numPages / 4 so that not every buffered page is inside its correlated period.
+#define LRU_K_CORRELATED_PERIOD 4
+// The history of a replaced page is retained for this many page references per page frame of the pool.
+#define LRU_K_RETAINED_PERIOD 8
+
+// Background flusher parameters (see startBackgroundFlusher(...)). The flusher writes at most FLUSHER_BATCH_PAGES pages
+// per round and checks the pool every FLUSHER_INTERVAL_MS milliseconds even if no miss wakes it up.
+#define FLUSHER_BATCH_PAGES 64
+#define FLUSHER_INTERVAL_MS 100
+
+// Read-ahead parameters (see prefetchPages(...) and setReadAhead(...)). Sequential access is detected after
+// SEQUENTIAL_MISSES misses on consecutive pages. At most PREFETCH_QUEUE_SIZE requests wait for the prefetcher
+// and one request loads at most MAX_PREFETCH_PAGES pages.
+#define SEQUENTIAL_MISSES 2
+#define PREFETCH_QUEUE_SIZE 16
+#define MAX_PREFETCH_PAGES 64
+
+// Replacement lists used by LRU, ARC and 2Q algorithms (see ReplacementList).
+// LRU keeps all its unpinned frames in RECENT_LIST. ARC calls the lists T1/T2 and their ghost lists B1/B2.
+// 2Q calls them A1in/Am and only keeps ghosts (A1out) of pages replaced from A1in.
+#define NO_LIST -1
+#define RECENT_LIST 0
+#define FREQUENT_LIST 1
+
+/*
+   LATCHING PROTOCOL
+
+   - partitionLatches[p] protects the page table buckets b with (b & (PAGE_TABLE_PARTITIONS - 1)) == p.
+   - Each page frame's latch protects its pageNum, dirtyBit, fixCount, hitNum, refNum, lastRef, LRU-K history, isLoading
+     isFlushing, isPrefetched and ioResult.
+   - replacementLatch serializes misses i.e. victim selection, write back of dirty victims and the
+     replacement strategy's bookkeeping (including the LRU-K retained history and the CLOCK hand). Hits never take it.
+   - listLatch protects the replacement lists of LRU, ARC and 2Q (replacementLists, frameLinks and the frames'
+     listId). The ghost lists are only used on misses and are protected by replacementLatch.
+
+   Latches are always acquired in the order replacementLatch -> partition latch -> frame latch -> listLatch.
+   A hit only takes the partition latch of its page and the frame latch, so hits on different pages
+   proceed in parallel. A miss re-checks the page table while holding replacementLatch and installs
+   the frame in the page table (marked isLoading) before the disk read starts, so two clients missing
+   on the same page trigger only one disk read. The second client waits on the frame's ioDone condition.
+   If the read fails, the frame is removed from the page table and its pageNum set to NO_PAGE before ioDone is
+   signalled. The waiting clients find NO_PAGE, drop their pins and return the read's error.
+
+   The background flusher copies a dirty page out of its frame under the frame latch, clears dirtyBit and sets
+   isFlushing until the copy is on disk. Every other writer of that page (replacement, forcePage, forceFlushPool)
+   first waits on ioDone until isFlushing is cleared, so writes of the same page never overtake each other.
+   Replacement writes a dirty victim the same way (from victimBuffer): the victim stays in the page table with isFlushing
+   set and is only removed if it is still clean and unpinned after the write. A victim whose write fails stays dirty.
+*/
+
 // This structure represents one page frame in buffer pool (memory).
 typedef struct Page
 {
@@ -11,259 +72,1219 @@ typedef struct Page
 	PageNumber pageNum; // An identification integer given to each page
 	int dirtyBit; // Used to indicate whether the contents of the page has been modified by the client
 	int fixCount; // Used to indicate the number of clients using that page at a given instance
-	int hitNum;   // Used by LRU algorithm to get the least recently used page	
+	int hitNum;   // Used by CLOCK algorithm as the reference bit of the page
 	int refNum;   // Used by LFU algorithm to get the least frequently used page
+	long long lastRef; // Used by LRU-K algorithm: time of the most recent reference, correlated or not
+	int hashNext; // Index of the next page frame in the same page table bucket (-1 ends the chain)
+	int listId;   // Replacement list holding the page frame (RECENT_LIST, FREQUENT_LIST or NO_LIST)
+	bool isLoading; // TRUE while the page is being read from disk. Clients pinning the page wait on ioDone
+	bool isFlushing; // TRUE while the background flusher writes a copy of the page to disk
+	bool isPrefetched; // TRUE if the page was read ahead and no client has pinned it yet
+	RC ioResult;  // Error of the failed read of the page, returned to the clients which waited for it (see abandonLoading(...))
+	pthread_mutex_t latch; // Per-frame latch (see LATCHING PROTOCOL)
+	pthread_cond_t ioDone; // Signalled when the page has been read from disk
 } PageFrame;
 
-// "bufferSize" represents the size of the buffer pool i.e. maximum number of page frames that can be kept into the buffer pool
-int bufferSize = 0;
+// This structure links an element (page frame or ghost entry) into a replacement list.
+typedef struct ListLink
+{
+	int prev; // Index of the less recently used neighbour (-1 at the head)
+	int next; // Index of the more recently used neighbour (-1 at the tail)
+} ListLink;
+
+// This structure is a doubly linked list threaded through an array of ListLinks.
+// "head" is the least recently used element and "tail" the most recently used one.
+typedef struct ReplacementList
+{
+	int head;
+	int tail;
+	int size;
+} ReplacementList;
+
+// This structure remembers a page which has been replaced recently (a ghost), used by ARC and 2Q algorithms.
+typedef struct GhostEntry
+{
+	PageNumber pageNum; // Replaced page (NO_PAGE if the entry is free)
+	int listId;   // Ghost list holding the entry (RECENT_LIST or FREQUENT_LIST)
+	int hashNext; // Index of the next ghost entry in the same ghost table bucket (-1 ends the chain)
+} GhostEntry;
+
+// This structure is a page the background flusher is about to write, used to sort the dirty pages by page number.
+typedef struct FlushCandidate
+{
+	PageNumber pageNum; // Page to write
+	int frameIndex;     // Page frame holding the page
+} FlushCandidate;
+
+// This structure is a read-ahead request waiting for the prefetcher thread.
+typedef struct PrefetchRequest
+{
+	PageNumber firstPage; // First page to load
+	int numPages;         // Number of consecutive pages to load
+} PrefetchRequest;
+
+// This structure holds the reference history of a page which has been replaced, so that LRU-K does not
+// forget how often the page was used when it comes back soon after (see LRU_K_RETAINED_PERIOD).
+typedef struct RetainedHistory
+{
+	PageNumber pageNum; // Page the history belongs to (NO_PAGE if the entry is empty)
+	long long lastRef;  // Time of the most recent reference of the page
+	long long *history; // K times of the most recent uncorrelated references. history[0] is the most recent one
+} RetainedHistory;
+
+// This structure is stored in the buffer pool's mgmtData and holds the bookkeeping of one buffer pool.
+typedef struct BufferManager
+{
+	PageFrame *pageFrames; // Array of numPages page frames
+	char *pageArena; // Page aligned block of numPages x PAGE_SIZE bytes. Page frame i caches its page at pageArena + i x PAGE_SIZE
+	char *victimBuffer; // One more page after the page frames in pageArena. takeFrame(...) writes a dirty victim from this copy
+	SM_FileHandle fileHandle; // Page file opened once in initBufferPool(...) and closed in shutdownBufferPool(...). Used with preadBlock(...) and the other positioned calls, which leave curPagePos alone, so concurrent misses do not race on it
+	int *pageTable; // Hash index from page number to page frame. Each bucket is the first frame of a chain linked through hashNext
+	int pageTableMask; // Number of buckets - 1. The number of buckets is a power of two
+	int usedFrames; // Number of page frames holding a page. Frames are filled in order so this is also the next empty frame
+	pthread_mutex_t partitionLatches[PAGE_TABLE_PARTITIONS]; // Latches of the page table partitions
+	pthread_mutex_t replacementLatch; // Serializes misses (see LATCHING PROTOCOL)
+
+	// Replacement lists of LRU, ARC and 2Q algorithms linked through frameLinks.
+	// LRU only keeps unpinned frames in its list. ARC and 2Q keep every frame holding a page in one of their lists.
+	ReplacementList replacementLists[2];
+	ListLink *frameLinks;
+	pthread_mutex_t listLatch;
+
+	// Ghost lists of ARC and 2Q algorithms. "ghosts" is linked into ghostLists (or freeGhosts) through ghostLinks
+	// and indexed by page number through ghostTable. "missGhostList" is the ghost list of the page being pinned by
+	// the current miss (NO_LIST if the page is not a ghost) and "missGhost" its ghost entry (-1 once it is forgotten).
+	GhostEntry *ghosts;
+	ListLink *ghostLinks;
+	ReplacementList ghostLists[2];
+	ReplacementList freeGhosts;
+	int *ghostTable;
+	int missGhostList;
+	int missGhost;
+
+	// "arcTarget" is ARC's adaptive target size of T1 (p in the ARC paper).
+	int arcTarget;
+
+	// Background flusher (see startBackgroundFlusher(...)). "flusherLatch" protects flusherRunning and is used with flusherWakeup.
+	// "flushBuffer" holds the copies of the pages written by one round and "flushCandidates" the pages.
+	pthread_t flusherThread;
+	bool flusherRunning;
+	int cleanLowWaterMark;
+	pthread_mutex_t flusherLatch;
+	pthread_cond_t flusherWakeup;
+	char *flushBuffer;
+	FlushCandidate *flushCandidates;
+
+	// Read-ahead (see prefetchPages(...)). "prefetchLatch" protects prefetcherRunning, the request queue and readAheadEnd
+	// (the page after the last page requested so far). "readAheadPages" is the read-ahead window of the sequential
+	// access detection (0 = disabled). "lastMissPage" and "sequentialMisses" are protected by replacementLatch.
+	pthread_t prefetchThread;
+	bool prefetcherRunning;
+	pthread_mutex_t prefetchLatch;
+	pthread_cond_t prefetchWakeup;
+	PrefetchRequest prefetchQueue[PREFETCH_QUEUE_SIZE];
+	int prefetchHead;
+	int prefetchCount;
+	PageNumber readAheadEnd;
+	int readAheadPages;
+	PageNumber lastMissPage;
+	int sequentialMisses;
+
+	// "bufferSize" represents the size of the buffer pool i.e. maximum number of page frames that can be kept into the buffer pool
+	int bufferSize;
 
-// "rearIndex" basically stores the count of number of pages read from the disk.
-// "rearIndex" is also used by FIFO function to calculate the frontIndex i.e.
-int rearIndex = 0;
+	// "rearIndex" basically stores the count of number of pages read from the disk.
+	// "rearIndex" is also used by FIFO function to calculate the frontIndex i.e.
+	int rearIndex;
 
-// "writeCount" counts the number of I/O write to the disk i.e. number of pages writen to the disk
-int writeCount = 0;
+	// "writeCount" counts the number of I/O write to the disk i.e. number of pages writen to the disk
+	int writeCount;
 
-// "hit" a general count which is incremented whenever a page frame is added into the buffer pool.
-// "hit" is used by LRU to determine least recently added page into the buffer pool.
-int hit = 0;
+	// "clockPointer" is the clock hand of CLOCK algorithm. It only moves during victim selection (under replacementLatch).
+	int clockPointer;
 
-// "clockPointer" is used by CLOCK algorithm to point to the last added page in the buffer pool.
-int clockPointer = 0;
+	// "lfuPointer" is used by LFU algorithm to store the least frequently used page frame's position. It speeds up operation  from 2nd replacement onwards.
+	int lfuPointer;
 
-// "lfuPointer" is used by LFU algorithm to store the least frequently used page frame's position. It speeds up operation  from 2nd replacement onwards.
-int lfuPointer = 0;
+	// Bookkeeping of LRU-K algorithm.
+	// "lruK" is K and "correlatedPeriod" the correlated reference period. "refClock" counts the page references (pinPage calls) and serves as LRU-K's clock.
+	// "frameHistory" holds K reference times per page frame (frame i uses frameHistory[i * K ... i * K + K - 1]).
+	// "retainedHistory" is a direct mapped table (indexed like the page table) holding the history of replaced pages.
+	int lruK;
+	int correlatedPeriod;
+	long long refClock;
+	long long *frameHistory;
+	RetainedHistory *retainedHistory;
+	int retainedHistoryMask;
+} BufferManager;
 
-// Defining FIFO (First In First Out) function
-extern void FIFO(BM_BufferPool *const bm, PageFrame *page)
+// This function writes the given page data to the pool's page file using the long-lived file handle
+static RC writePageToDisk(BM_BufferPool *const bm, PageNumber pageNum, SM_PageHandle data)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	RC result = pwriteBlock(pageNum, &bufferManager->fileHandle, data);
+
+	// Increase the writeCount which records the number of writes done by the buffer manager.
+	if(result == RC_OK)
+		__sync_fetch_and_add(&bufferManager->writeCount, 1);
+	return result;
+}
+
+// This function returns the page table bucket of page number pageNum
+static int hashPage(BufferManager *bufferManager, PageNumber pageNum)
+{
+	return (int) (((unsigned int) pageNum * 2654435761u) & bufferManager->pageTableMask);
+}
+
+// This function returns the latch of the page table partition holding page number pageNum
+static pthread_mutex_t *getPartitionLatch(BufferManager *bufferManager, PageNumber pageNum)
+{
+	return &bufferManager->partitionLatches[hashPage(bufferManager, pageNum) & (PAGE_TABLE_PARTITIONS - 1)];
+}
+
+// This function returns the index of the page frame holding page pageNum, or -1 if the page is not in the buffer pool.
+// The caller must hold the partition latch of pageNum.
+static int findFrame(BufferManager *bufferManager, PageNumber pageNum)
+{
+	int frameIndex = bufferManager->pageTable[hashPage(bufferManager, pageNum)];
+
+	while(frameIndex != -1 && bufferManager->pageFrames[frameIndex].pageNum != pageNum)
+		frameIndex = bufferManager->pageFrames[frameIndex].hashNext;
+	return frameIndex;
+}
+
+// This function adds the page frame at frameIndex to the page table under its current page number.
+// The caller must hold the partition latch of that page number.
+static void addToPageTable(BufferManager *bufferManager, int frameIndex)
+{
+	int bucket = hashPage(bufferManager, bufferManager->pageFrames[frameIndex].pageNum);
+
+	bufferManager->pageFrames[frameIndex].hashNext = bufferManager->pageTable[bucket];
+	bufferManager->pageTable[bucket] = frameIndex;
+}
+
+// This function removes the page frame at frameIndex from the page table. It must be called before the frame's page number changes.
+// The caller must hold the partition latch of the frame's page number.
+static void removeFromPageTable(BufferManager *bufferManager, int frameIndex)
+{
+	int *link = &bufferManager->pageTable[hashPage(bufferManager, bufferManager->pageFrames[frameIndex].pageNum)];
+
+	while(*link != -1 && *link != frameIndex)
+		link = &bufferManager->pageFrames[*link].hashNext;
+	if(*link == frameIndex)
+		*link = bufferManager->pageFrames[frameIndex].hashNext;
+}
+
+// This function looks up page pageNum and returns its frame with the partition latch of pageNum held.
+// It returns -1 (and releases the partition latch) if the page is not in the buffer pool.
+static int lookupFrame(BufferManager *bufferManager, PageNumber pageNum)
+{
+	pthread_mutex_t *partitionLatch = getPartitionLatch(bufferManager, pageNum);
+	int frameIndex;
+
+	pthread_mutex_lock(partitionLatch);
+	frameIndex = findFrame(bufferManager, pageNum);
+	if(frameIndex == -1)
+		pthread_mutex_unlock(partitionLatch);
+	return frameIndex;
+}
+
+// This function appends element index to the most recently used end of list.
+static void listAppend(ListLink *links, ReplacementList *list, int index)
+{
+	links[index].prev = list->tail;
+	links[index].next = -1;
+	if(list->tail != -1)
+		links[list->tail].next = index;
+	else
+		list->head = index;
+	list->tail = index;
+	list->size++;
+}
+
+// This function removes element index from list.
+static void listRemove(ListLink *links, ReplacementList *list, int index)
+{
+	if(links[index].prev != -1)
+		links[links[index].prev].next = links[index].next;
+	else
+		list->head = links[index].next;
+	if(links[index].next != -1)
+		links[links[index].next].prev = links[index].prev;
+	else
+		list->tail = links[index].prev;
+	list->size--;
+}
+
+// This function moves page frame frameIndex to the most recently used end of replacement list listId.
+// The caller must hold the frame latch.
+static void moveFrameToList(BufferManager *bufferManager, int frameIndex, int listId)
+{
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+
+	pthread_mutex_lock(&bufferManager->listLatch);
+	if(frame->listId != NO_LIST)
+		listRemove(bufferManager->frameLinks, &bufferManager->replacementLists[frame->listId], frameIndex);
+	if(listId != NO_LIST)
+		listAppend(bufferManager->frameLinks, &bufferManager->replacementLists[listId], frameIndex);
+	frame->listId = listId;
+	pthread_mutex_unlock(&bufferManager->listLatch);
+}
+
+// This function returns the ghost entry of page pageNum or -1 if the page is not a ghost.
+// The caller must hold the replacementLatch (as for all the ghost functions).
+static int findGhost(BufferManager *bufferManager, PageNumber pageNum)
+{
+	int ghostIndex = bufferManager->ghostTable[hashPage(bufferManager, pageNum)];
+
+	while(ghostIndex != -1 && bufferManager->ghosts[ghostIndex].pageNum != pageNum)
+		ghostIndex = bufferManager->ghosts[ghostIndex].hashNext;
+	return ghostIndex;
+}
+
+// This function forgets ghost entry ghostIndex.
+static void removeGhost(BufferManager *bufferManager, int ghostIndex)
+{
+	GhostEntry *ghost = &bufferManager->ghosts[ghostIndex];
+	int *link = &bufferManager->ghostTable[hashPage(bufferManager, ghost->pageNum)];
+
+	while(*link != ghostIndex)
+		link = &bufferManager->ghosts[*link].hashNext;
+	*link = ghost->hashNext;
+
+	listRemove(bufferManager->ghostLinks, &bufferManager->ghostLists[ghost->listId], ghostIndex);
+	listAppend(bufferManager->ghostLinks, &bufferManager->freeGhosts, ghostIndex);
+	ghost->pageNum = NO_PAGE;
+	if(ghostIndex == bufferManager->missGhost)
+		bufferManager->missGhost = -1;
+}
+
+// This function remembers page pageNum at the most recently used end of ghost list listId.
+// If all the ghost entries are in use, the least recently used ghost of the longer ghost list is forgotten.
+static void addGhost(BufferManager *bufferManager, PageNumber pageNum, int listId)
+{
+	int ghostIndex, bucket = hashPage(bufferManager, pageNum);
+
+	if(bufferManager->freeGhosts.size == 0)
+		removeGhost(bufferManager, bufferManager->ghostLists[(bufferManager->ghostLists[RECENT_LIST].size >= bufferManager->ghostLists[FREQUENT_LIST].size) ? RECENT_LIST : FREQUENT_LIST].head);
+
+	ghostIndex = bufferManager->freeGhosts.head;
+	listRemove(bufferManager->ghostLinks, &bufferManager->freeGhosts, ghostIndex);
+	listAppend(bufferManager->ghostLinks, &bufferManager->ghostLists[listId], ghostIndex);
+	bufferManager->ghosts[ghostIndex].pageNum = pageNum;
+	bufferManager->ghosts[ghostIndex].listId = listId;
+	bufferManager->ghosts[ghostIndex].hashNext = bufferManager->ghostTable[bucket];
+	bufferManager->ghostTable[bucket] = ghostIndex;
+}
+
+// This function returns the least recently used unpinned page frame of replacement list listId or -1.
+// The caller must hold the listLatch.
+static int findUnpinnedFrame(BufferManager *bufferManager, int listId)
+{
+	int frameIndex = bufferManager->replacementLists[listId].head;
+
+	while(frameIndex != -1 && bufferManager->pageFrames[frameIndex].fixCount != 0)
+		frameIndex = bufferManager->frameLinks[frameIndex].next;
+	return frameIndex;
+}
+
+// Defining FIFO (First In First Out) function. It returns the index of the victim page frame or -1 if all frames are pinned.
+// Strategies are called with the replacementLatch held. Their choice is only a candidate: pinPage re-checks it under the frame latch.
+extern int FIFO(BM_BufferPool *const bm)
 {
 	//printf("FIFO Started");
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+
 	int i, frontIndex;
-	frontIndex = rearIndex % bufferSize;
+	frontIndex = bufferManager->rearIndex % bufferManager->bufferSize;
 
 	// Interating through all the page frames in the buffer pool
-	for(i = 0; i < bufferSize; i++)
+	for(i = 0; i < bufferManager->bufferSize; i++)
 	{
 		if(pageFrame[frontIndex].fixCount == 0)
+			return frontIndex;
+
+		// If the current page frame is being used by some client, we move on to the next location
+		frontIndex = (frontIndex + 1) % bufferManager->bufferSize;
+	}
+	return -1;
+}
+
+// Defining LFU (Least Frequently Used) function. It returns the index of the victim page frame or -1 if all frames are pinned.
+extern int LFU(BM_BufferPool *const bm)
+{
+	//printf("LFU Started");
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+
+	int i, j, leastFreqIndex = -1, leastFreqRef = 0;
+	i = bufferManager->lfuPointer % bufferManager->bufferSize;
+
+	// Finding the unpinned page frame having minimum refNum (i.e. it is used the least frequent) page frame.
+	// The search starts at lfuPointer so that ties go to the frame after the last replaced one.
+	for(j = 0; j < bufferManager->bufferSize; j++)
+	{
+		if(pageFrame[i].fixCount == 0 && (leastFreqIndex == -1 || pageFrame[i].refNum < leastFreqRef))
 		{
-			// If page in memory has been modified (dirtyBit = 1), then write page to disk
-			if(pageFrame[frontIndex].dirtyBit == 1)
-			{
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pageFrame[frontIndex].pageNum, &fh, pageFrame[frontIndex].data);
-				
-				// Increase the writeCount which records the number of writes done by the buffer manager.
-				writeCount++;
-			}
-			
-			// Setting page frame's content to new page's content
-			pageFrame[frontIndex].data = page->data;
-			pageFrame[frontIndex].pageNum = page->pageNum;
-			pageFrame[frontIndex].dirtyBit = page->dirtyBit;
-			pageFrame[frontIndex].fixCount = page->fixCount;
-			break;
+			leastFreqIndex = i;
+			leastFreqRef = pageFrame[i].refNum;
 		}
-		else
+		i = (i + 1) % bufferManager->bufferSize;
+	}
+
+	if(leastFreqIndex != -1)
+		bufferManager->lfuPointer = (leastFreqIndex + 1) % bufferManager->bufferSize;
+	return leastFreqIndex;
+}
+
+// Defining LRU (Least Recently Used) function. It returns the index of the victim page frame or -1 if all frames are pinned.
+extern int LRU(BM_BufferPool *const bm)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	int leastRecentIndex;
+
+	// The head of the LRU list is the unpinned page frame which was released the longest time ago
+	pthread_mutex_lock(&bufferManager->listLatch);
+	leastRecentIndex = bufferManager->replacementLists[RECENT_LIST].head;
+	pthread_mutex_unlock(&bufferManager->listLatch);
+	return leastRecentIndex;
+}
+
+// Defining CLOCK function. It returns the index of the victim page frame or -1 if all frames are pinned.
+extern int CLOCK(BM_BufferPool *const bm)
+{
+	//printf("CLOCK Started");
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	int i, hand = bufferManager->clockPointer % bufferManager->bufferSize;
+
+	// Two sweeps are enough: the first one clears the reference bits of all unpinned frames.
+	// Each frame is checked under its latch because hits set hitNum under the frame latch only.
+	for(i = 0; i < 2 * bufferManager->bufferSize; i++)
+	{
+		pthread_mutex_lock(&pageFrame[hand].latch);
+		if(pageFrame[hand].fixCount == 0)
 		{
-			// If the current page frame is being used by some client, we move on to the next location
-			frontIndex++;
-			frontIndex = (frontIndex % bufferSize == 0) ? 0 : frontIndex;
+			if(pageFrame[hand].hitNum == 0)
+			{
+				pthread_mutex_unlock(&pageFrame[hand].latch);
+				// Moving the clock hand past the replaced frame
+				bufferManager->clockPointer = hand + 1;
+				return hand;
+			}
+
+			// We set hitNum = 0 so that the frame is replaced on the next sweep unless it is referenced again.
+			pageFrame[hand].hitNum = 0;
 		}
+		pthread_mutex_unlock(&pageFrame[hand].latch);
+		// Incrementing the clock hand so that we can check the next page frame location.
+		hand = (hand + 1) % bufferManager->bufferSize;
 	}
+	bufferManager->clockPointer = hand;
+	return -1;
 }
 
-// Defining LFU (Least Frequently Used) function
-extern void LFU(BM_BufferPool *const bm, PageFrame *page)
+// This function records a reference at time now in the LRU-K history of page frame frameIndex.
+// A reference within the correlated period of the previous one only moves lastRef. Otherwise the correlated
+// references are collapsed i.e. the older history is shifted by the length of the correlated period.
+// The caller must hold the frame latch.
+static void lruKReference(BufferManager *bufferManager, int frameIndex, long long now)
 {
-	//printf("LFU Started");
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	
-	int i, j, leastFreqIndex, leastFreqRef;
-	leastFreqIndex = lfuPointer;	
-	
-	// Interating through all the page frames in the buffer pool
-	for(i = 0; i < bufferSize; i++)
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+	long long *history = bufferManager->frameHistory + (long long) frameIndex * bufferManager->lruK;
+	long long correlatedLength;
+	int i;
+
+	if(history[0] != 0 && now - frame->lastRef <= bufferManager->correlatedPeriod)
 	{
-		if(pageFrame[leastFreqIndex].fixCount == 0)
+		frame->lastRef = now;
+		return;
+	}
+
+	correlatedLength = (history[0] != 0) ? frame->lastRef - history[0] : 0;
+	for(i = bufferManager->lruK - 1; i > 0; i--)
+		history[i] = (history[i - 1] != 0) ? history[i - 1] + correlatedLength : 0;
+	history[0] = frame->lastRef = now;
+}
+
+// This function saves the history of the page in page frame frameIndex before the page is replaced.
+// The caller must hold the replacementLatch.
+static void lruKRetainHistory(BufferManager *bufferManager, int frameIndex)
+{
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+	RetainedHistory *entry = &bufferManager->retainedHistory[(((unsigned int) frame->pageNum * 2654435761u) & bufferManager->retainedHistoryMask)];
+	long long *history = bufferManager->frameHistory + (long long) frameIndex * bufferManager->lruK;
+	int i;
+
+	// A frame given up after a failed read holds no page
+	if(frame->pageNum == NO_PAGE)
+		return;
+
+	// A colliding entry is simply overwritten. The table only needs to remember recently replaced pages.
+	entry->pageNum = frame->pageNum;
+	entry->lastRef = frame->lastRef;
+	for(i = 0; i < bufferManager->lruK; i++)
+		entry->history[i] = history[i];
+}
+
+// This function loads the retained history of page pageNum (or an empty history) into page frame frameIndex.
+// Histories older than LRU_K_RETAINED_PERIOD are dropped. The caller must hold the replacementLatch.
+static void lruKRestoreHistory(BufferManager *bufferManager, int frameIndex, PageNumber pageNum, long long now)
+{
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+	RetainedHistory *entry = &bufferManager->retainedHistory[(((unsigned int) pageNum * 2654435761u) & bufferManager->retainedHistoryMask)];
+	long long *history = bufferManager->frameHistory + (long long) frameIndex * bufferManager->lruK;
+	bool retained = entry->pageNum == pageNum && now - entry->lastRef <= (long long) LRU_K_RETAINED_PERIOD * bufferManager->bufferSize;
+	int i;
+
+	for(i = 0; i < bufferManager->lruK; i++)
+		history[i] = retained ? entry->history[i] : 0;
+	frame->lastRef = retained ? entry->lastRef : 0;
+	if(retained)
+		entry->pageNum = NO_PAGE;
+}
+
+// Defining LRU-K function. It returns the index of the victim page frame or -1 if all frames are pinned.
+// The victim is the unpinned page with the largest backward K-distance i.e. the oldest K-th most recent reference.
+// Pages referenced fewer than K times have an infinite K-distance; among them the least recently used one (by lastRef) is chosen.
+// Pages still inside their correlated reference period are only replaced if there is no other choice.
+extern int LRU_K(BM_BufferPool *const bm)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	long long now = bufferManager->refClock + 1; // Time of the reference being served
+	long long *history;
+	int i, victim = -1, victimCorrelated = 1, correlated, K = bufferManager->lruK;
+
+	for(i = 0; i < bufferManager->bufferSize; i++)
+	{
+		if(pageFrame[i].fixCount != 0)
+			continue;
+
+		history = bufferManager->frameHistory + (long long) i * K;
+		correlated = (now - pageFrame[i].lastRef <= bufferManager->correlatedPeriod);
+
+		// Preferring uncorrelated pages, then the oldest K-th reference (0 = fewer than K references), then the oldest last reference
+		if(victim == -1 || correlated < victimCorrelated
+			|| (correlated == victimCorrelated && (history[K - 1] < bufferManager->frameHistory[(long long) victim * K + K - 1]
+				|| (history[K - 1] == bufferManager->frameHistory[(long long) victim * K + K - 1] && pageFrame[i].lastRef < pageFrame[victim].lastRef))))
 		{
-			leastFreqIndex = (leastFreqIndex + i) % bufferSize;
-			leastFreqRef = pageFrame[leastFreqIndex].refNum;
-			break;
+			victim = i;
+			victimCorrelated = correlated;
 		}
 	}
+	return victim;
+}
+
+// Defining ARC (Adaptive Replacement Cache) function. It returns the index of the victim page frame or -1 if all frames are pinned.
+// T1 holds pages referenced once recently and T2 pages referenced at least twice. The page is replaced from T1 if T1 is
+// longer than its adaptive target arcTarget, otherwise from T2 (REPLACE in the ARC paper). The target is adapted in pinPage(...).
+extern int ARC(BM_BufferPool *const bm)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	int victim, t1Size, listId;
+
+	pthread_mutex_lock(&bufferManager->listLatch);
+	t1Size = bufferManager->replacementLists[RECENT_LIST].size;
+	listId = (t1Size >= 1 && (t1Size > bufferManager->arcTarget || (bufferManager->missGhostList == FREQUENT_LIST && t1Size == bufferManager->arcTarget)))
+		? RECENT_LIST : FREQUENT_LIST;
+
+	// Falling back to the other list if all the pages of the chosen one are pinned
+	if((victim = findUnpinnedFrame(bufferManager, listId)) == -1)
+		victim = findUnpinnedFrame(bufferManager, 1 - listId);
+	pthread_mutex_unlock(&bufferManager->listLatch);
+	return victim;
+}
+
+// Defining 2Q function. It returns the index of the victim page frame or -1 if all frames are pinned.
+// A1in holds pages referenced once, in FIFO order, and Am pages referenced again after they left A1in, in LRU order.
+// The page is replaced from A1in while it is longer than a quarter of the pool, otherwise from Am.
+extern int TWO_Q(BM_BufferPool *const bm)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	int victim, listId, kIn = (bufferManager->bufferSize / 4 > 0) ? bufferManager->bufferSize / 4 : 1;
+
+	pthread_mutex_lock(&bufferManager->listLatch);
+	listId = (bufferManager->replacementLists[RECENT_LIST].size > kIn) ? RECENT_LIST : FREQUENT_LIST;
+
+	// Falling back to the other list if all the pages of the chosen one are pinned
+	if((victim = findUnpinnedFrame(bufferManager, listId)) == -1)
+		victim = findUnpinnedFrame(bufferManager, 1 - listId);
+	pthread_mutex_unlock(&bufferManager->listLatch);
+	return victim;
+}
+
+// This function updates the ghost lists of ARC and 2Q algorithms for page frame frameIndex whose page is being replaced.
+// ARC remembers pages replaced from T1 in B1 and pages replaced from T2 in B2.
+// 2Q only remembers pages replaced from A1in (in A1out, which holds at most half the pool size).
+// The caller must hold the replacementLatch and the frame latch.
+static void replaceFromLists(BM_BufferPool *const bm, int frameIndex)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+	int listId = frame->listId, kOut = (bufferManager->bufferSize / 2 > 0) ? bufferManager->bufferSize / 2 : 1;
+
+	moveFrameToList(bufferManager, frameIndex, NO_LIST);
+
+	// A frame given up after a failed read holds no page to remember
+	if(frame->pageNum == NO_PAGE)
+		return;
+	if(bm->strategy == RS_ARC && listId != NO_LIST)
+		addGhost(bufferManager, frame->pageNum, listId);
+	else if(bm->strategy == RS_2Q && listId == RECENT_LIST)
+	{
+		addGhost(bufferManager, frame->pageNum, RECENT_LIST);
+		while(bufferManager->ghostLists[RECENT_LIST].size > kOut)
+			removeGhost(bufferManager, bufferManager->ghostLists[RECENT_LIST].head);
+	}
+}
+
+// This function puts page frame frameIndex, which has just been filled by a miss, into a list of ARC or 2Q algorithms.
+// Pages which are ghosts go to the frequent list (T2 / Am), other pages to the recent list (T1 / A1in).
+// ARC then trims its ghost lists so that |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c (c = pool size).
+// The caller must hold the replacementLatch and the frame latch.
+static void fillFromLists(BM_BufferPool *const bm, int frameIndex)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	ReplacementList *lists = bufferManager->replacementLists, *ghostLists = bufferManager->ghostLists;
+	int c = bufferManager->bufferSize;
+
+	if(bufferManager->missGhostList != NO_LIST)
+	{
+		// The ghost entry may already have been forgotten while replacing a page for this miss
+		if(bufferManager->missGhost != -1)
+			removeGhost(bufferManager, bufferManager->missGhost);
+		bufferManager->missGhostList = NO_LIST;
+		moveFrameToList(bufferManager, frameIndex, FREQUENT_LIST);
+	}
+	else
+		moveFrameToList(bufferManager, frameIndex, RECENT_LIST);
+
+	// The sizes of T1 and T2 are read under the listLatch because hits move pages from T1 to T2 meanwhile
+	if(bm->strategy == RS_ARC)
+	{
+		pthread_mutex_lock(&bufferManager->listLatch);
+		while(lists[RECENT_LIST].size + ghostLists[RECENT_LIST].size > c && ghostLists[RECENT_LIST].size > 0)
+			removeGhost(bufferManager, ghostLists[RECENT_LIST].head);
+		while(lists[RECENT_LIST].size + lists[FREQUENT_LIST].size + ghostLists[RECENT_LIST].size + ghostLists[FREQUENT_LIST].size > 2 * c
+				&& ghostLists[FREQUENT_LIST].size > 0)
+			removeGhost(bufferManager, ghostLists[FREQUENT_LIST].head);
+		pthread_mutex_unlock(&bufferManager->listLatch);
+	}
+}
+
+// This function looks up page pageNum in the ghost lists of ARC and 2Q algorithms before a miss is served.
+// On a ghost hit ARC adapts its target size of T1: a hit in B1 means T1 was too short, a hit in B2 that T2 was.
+// The caller must hold the replacementLatch.
+static void lookupGhost(BM_BufferPool *const bm, PageNumber pageNum)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	int b1Size = bufferManager->ghostLists[RECENT_LIST].size, b2Size = bufferManager->ghostLists[FREQUENT_LIST].size, delta;
 
-	i = (leastFreqIndex + 1) % bufferSize;
+	bufferManager->missGhost = findGhost(bufferManager, pageNum);
+	bufferManager->missGhostList = (bufferManager->missGhost != -1) ? bufferManager->ghosts[bufferManager->missGhost].listId : NO_LIST;
+	if(bm->strategy != RS_ARC || bufferManager->missGhost == -1)
+		return;
 
-	// Finding the page frame having minimum refNum (i.e. it is used the least frequent) page frame
-	for(j = 0; j < bufferSize; j++)
+	if(bufferManager->missGhostList == RECENT_LIST)
 	{
-		if(pageFrame[i].refNum < leastFreqRef)
+		delta = (b2Size > b1Size) ? b2Size / b1Size : 1;
+		bufferManager->arcTarget = (bufferManager->arcTarget + delta < bufferManager->bufferSize) ? bufferManager->arcTarget + delta : bufferManager->bufferSize;
+	}
+	else
+	{
+		delta = (b1Size > b2Size) ? b1Size / b2Size : 1;
+		bufferManager->arcTarget = (bufferManager->arcTarget - delta > 0) ? bufferManager->arcTarget - delta : 0;
+	}
+}
+
+// This function takes a page frame for page pageNum, evicting a page with the replacement strategy if the pool is full.
+// It returns the index of the frame, or -1 and the reason in result if all page frames are pinned or a dirty victim
+// could not be written back. The caller must hold the replacementLatch.
+// The returned frame is not in the page table and its old content (if dirty) has been written back to disk.
+static int takeFrame(BM_BufferPool *const bm, RC *result)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	pthread_mutex_t *partitionLatch;
+	PageNumber victimPage;
+	int victim;
+
+	*result = RC_NO_FREE_BUFFER_FRAME;
+
+	// Filling the next empty page frame if there is one
+	if(bufferManager->usedFrames < bufferManager->bufferSize)
+	{
+		victim = bufferManager->usedFrames++;
+		return victim;
+	}
+
+	while(1)
+	{
+		// Call appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
+		switch(bm->strategy)
 		{
-			leastFreqIndex = i;
-			leastFreqRef = pageFrame[i].refNum;
+			case RS_FIFO: // Using FIFO algorithm
+				victim = FIFO(bm);
+				break;
+
+			case RS_LRU: // Using LRU algorithm
+				victim = LRU(bm);
+				break;
+
+			case RS_CLOCK: // Using CLOCK algorithm
+				victim = CLOCK(bm);
+				break;
+
+			case RS_LFU: // Using LFU algorithm
+				victim = LFU(bm);
+				break;
+
+			case RS_LRU_K: // Using LRU-K algorithm
+				victim = LRU_K(bm);
+				break;
+
+			case RS_ARC: // Using ARC algorithm
+				victim = ARC(bm);
+				break;
+
+			case RS_2Q: // Using 2Q algorithm
+				victim = TWO_Q(bm);
+				break;
+
+			default:
+				printf("\nAlgorithm Not Implemented\n");
+				return -1;
 		}
-		i = (i + 1) % bufferSize;
-	}
-		
-	// If page in memory has been modified (dirtyBit = 1), then write page to disk	
-	if(pageFrame[leastFreqIndex].dirtyBit == 1)
-	{
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		writeBlock(pageFrame[leastFreqIndex].pageNum, &fh, pageFrame[leastFreqIndex].data);
-		
-		// Increase the writeCount which records the number of writes done by the buffer manager.
-		writeCount++;
-	}
-	
-	// Setting page frame's content to new page's content		
-	pageFrame[leastFreqIndex].data = page->data;
-	pageFrame[leastFreqIndex].pageNum = page->pageNum;
-	pageFrame[leastFreqIndex].dirtyBit = page->dirtyBit;
-	pageFrame[leastFreqIndex].fixCount = page->fixCount;
-	lfuPointer = leastFreqIndex + 1;
-}
-
-// Defining LRU (Least Recently Used) function
-extern void LRU(BM_BufferPool *const bm, PageFrame *page)
-{	
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	int i, leastHitIndex, leastHitNum;
-
-	// Interating through all the page frames in the buffer pool.
-	for(i = 0; i < bufferSize; i++)
-	{
-		// Finding page frame whose fixCount = 0 i.e. no client is using that page frame.
-		if(pageFrame[i].fixCount == 0)
+
+		if(victim == -1)
+			return -1;
+
+		// Re-checking the victim under its latches because a hit may have pinned it after the strategy looked at it
+		victimPage = pageFrame[victim].pageNum;
+		partitionLatch = getPartitionLatch(bufferManager, victimPage);
+		pthread_mutex_lock(partitionLatch);
+		pthread_mutex_lock(&pageFrame[victim].latch);
+
+		// Waiting for the background flusher if it is writing the victim, so that our write cannot overtake its write
+		while(pageFrame[victim].isFlushing)
+			pthread_cond_wait(&pageFrame[victim].ioDone, &pageFrame[victim].latch);
+
+		// If page in memory has been modified (dirtyBit = 1), then write page to disk before replacing it.
+		// The page stays in the page table during the write, so a client missing on victimPage cannot read the old content.
+		// Like the background flusher, a copy of the page is written, dirtyBit is cleared and isFlushing set. A client which
+		// pins and modifies the page meanwhile sets dirtyBit again, so the page is re-checked below.
+		if(pageFrame[victim].fixCount == 0 && pageFrame[victim].pageNum == victimPage && pageFrame[victim].dirtyBit == 1)
 		{
-			leastHitIndex = i;
-			leastHitNum = pageFrame[i].hitNum;
-			break;
+			memcpy(bufferManager->victimBuffer, pageFrame[victim].data, PAGE_SIZE);
+			pageFrame[victim].dirtyBit = 0;
+			pageFrame[victim].isFlushing = TRUE;
+			pthread_mutex_unlock(&pageFrame[victim].latch);
+			pthread_mutex_unlock(partitionLatch);
+
+			*result = writePageToDisk(bm, victimPage, bufferManager->victimBuffer);
+
+			pthread_mutex_lock(partitionLatch);
+			pthread_mutex_lock(&pageFrame[victim].latch);
+			pageFrame[victim].isFlushing = FALSE;
+			pthread_cond_broadcast(&pageFrame[victim].ioDone);
+
+			// The page could not be written back, so it stays in the pool (dirty) and the miss fails
+			if(*result != RC_OK)
+			{
+				pageFrame[victim].dirtyBit = 1;
+				pthread_mutex_unlock(&pageFrame[victim].latch);
+				pthread_mutex_unlock(partitionLatch);
+				return -1;
+			}
+		}
+
+		if(pageFrame[victim].fixCount == 0 && pageFrame[victim].pageNum == victimPage && pageFrame[victim].dirtyBit == 0)
+		{
+			// Removing the replaced page from the page table so that no new client can pin it
+			removeFromPageTable(bufferManager, victim);
+			if(bm->strategy == RS_LRU)
+				moveFrameToList(bufferManager, victim, NO_LIST);
+			else if(bm->strategy == RS_LRU_K)
+				lruKRetainHistory(bufferManager, victim);
+			else if(bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+				replaceFromLists(bm, victim);
+			pageFrame[victim].pageNum = NO_PAGE;
+			pthread_mutex_unlock(&pageFrame[victim].latch);
+			pthread_mutex_unlock(partitionLatch);
+			*result = RC_OK;
+			return victim;
 		}
-	}	
 
-	// Finding the page frame having minimum hitNum (i.e. it is the least recently used) page frame
-	for(i = leastHitIndex + 1; i < bufferSize; i++)
+		pthread_mutex_unlock(&pageFrame[victim].latch);
+		pthread_mutex_unlock(partitionLatch);
+	}
+}
+
+// This function releases one pin of page frame frameIndex. The caller must hold the frame latch.
+static void releaseFrame(BM_BufferPool *const bm, int frameIndex)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+
+	// Decrease fixCount (which means client has completed work on that page)
+	if(bufferManager->pageFrames[frameIndex].fixCount > 0 && --bufferManager->pageFrames[frameIndex].fixCount == 0 && bm->strategy == RS_LRU)
+		// The last client released the page, so it becomes the most recently used evictable page
+		moveFrameToList(bufferManager, frameIndex, RECENT_LIST);
+}
+
+// This function requests the next read-ahead window when a client pins page pageNum, which was read ahead,
+// and the pages requested so far end less than half a window after it.
+static void continueReadAhead(BM_BufferPool *const bm, PageNumber pageNum)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageNumber nextPage;
+
+	if(bufferManager->readAheadPages == 0)
+		return;
+
+	pthread_mutex_lock(&bufferManager->prefetchLatch);
+	nextPage = bufferManager->readAheadEnd;
+	pthread_mutex_unlock(&bufferManager->prefetchLatch);
+
+	if(nextPage > pageNum && nextPage - pageNum <= bufferManager->readAheadPages / 2)
+		prefetchPages(bm, nextPage, bufferManager->readAheadPages);
+}
+
+// This function requests the read-ahead window after page pageNum, which missed during sequential access.
+// Nothing is requested while pageNum lies in the window requested last, so that a reader which outruns the prefetcher
+// does not fill its queue with overlapping requests (and the later windows are not dropped).
+static void startReadAhead(BM_BufferPool *const bm, PageNumber pageNum)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageNumber nextPage;
+
+	pthread_mutex_lock(&bufferManager->prefetchLatch);
+	nextPage = bufferManager->readAheadEnd;
+	pthread_mutex_unlock(&bufferManager->prefetchLatch);
+
+	if(nextPage > pageNum + 1 && nextPage <= pageNum + 1 + bufferManager->readAheadPages)
+		return;
+	prefetchPages(bm, pageNum + 1, bufferManager->readAheadPages);
+}
+
+// This function finishes pinning the page in page frame frameIndex for a client.
+// It is called with the frame's partition latch held and releases it. It returns the read's error if the page
+// was being read from disk and the read failed.
+static RC pinFrame(BM_BufferPool *const bm, int frameIndex, BM_PageHandle *const page, pthread_mutex_t *partitionLatch)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+
+	pthread_mutex_lock(&frame->latch);
+	pthread_mutex_unlock(partitionLatch);
+
+	// Increasing fixCount i.e. now there is one more client accessing this page.
+	// LRU algorithm takes the page out of the LRU list while it is pinned.
+	if(frame->fixCount++ == 0 && bm->strategy == RS_LRU)
+		moveFrameToList(bufferManager, frameIndex, NO_LIST);
+
+	// Waiting for the client which is reading the page from disk
+	while(frame->isLoading)
+		pthread_cond_wait(&frame->ioDone, &frame->latch);
+
+	// The read failed and the reader gave the frame up. Our pin kept it from being reused, so pageNum is still NO_PAGE.
+	if(frame->pageNum == NO_PAGE)
 	{
-		if(pageFrame[i].hitNum < leastHitNum)
+		RC result = frame->ioResult;
+		releaseFrame(bm, frameIndex);
+		pthread_mutex_unlock(&frame->latch);
+		return result;
+	}
+
+	// The first pin of a page which was read ahead is its first reference, not a re-reference
+	bool firstReference = frame->isPrefetched;
+	frame->isPrefetched = FALSE;
+
+	if(bm->strategy == RS_CLOCK)
+		// hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
+		frame->hitNum = 1;
+	else if(bm->strategy == RS_LFU && !firstReference)
+		// Incrementing refNum to add one more to the count of number of times the page is used (referenced)
+		frame->refNum++;
+	else if(bm->strategy == RS_LRU_K)
+		lruKReference(bufferManager, frameIndex, __sync_add_and_fetch(&bufferManager->refClock, 1));
+	else if(!firstReference && bm->strategy == RS_ARC)
+		// ARC promotes every re-referenced page to T2
+		moveFrameToList(bufferManager, frameIndex, FREQUENT_LIST);
+	else if(!firstReference && bm->strategy == RS_2Q)
+	{
+		// 2Q moves pages of Am to its most recently used end and leaves A1in alone. listId is checked under the listLatch.
+		pthread_mutex_lock(&bufferManager->listLatch);
+		if(frame->listId == FREQUENT_LIST)
 		{
-			leastHitIndex = i;
-			leastHitNum = pageFrame[i].hitNum;
+			listRemove(bufferManager->frameLinks, &bufferManager->replacementLists[FREQUENT_LIST], frameIndex);
+			listAppend(bufferManager->frameLinks, &bufferManager->replacementLists[FREQUENT_LIST], frameIndex);
 		}
+		pthread_mutex_unlock(&bufferManager->listLatch);
 	}
 
-	// If page in memory has been modified (dirtyBit = 1), then write page to disk
-	if(pageFrame[leastHitIndex].dirtyBit == 1)
+	page->pageNum = frame->pageNum;
+	page->data = frame->data;
+	pthread_mutex_unlock(&frame->latch);
+
+	// A sequential reader is consuming the pages read ahead, so the next window is requested before it is needed
+	if(firstReference)
+		continueReadAhead(bm, page->pageNum);
+	return RC_OK;
+}
+
+// This function publishes page pageNum in page frame frameIndex (taken by takeFrame(...)) before it is read from disk.
+// The frame is pinned once and marked isLoading. Pages which are read ahead (isPrefetch) are not counted as a reference.
+// The caller must hold the replacementLatch.
+static void installFrame(BM_BufferPool *const bm, int frameIndex, PageNumber pageNum, bool isPrefetch)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+	pthread_mutex_t *partitionLatch = getPartitionLatch(bufferManager, pageNum);
+
+	// Initializing page frame's content and publishing it in the page table before reading it from disk
+	pthread_mutex_lock(partitionLatch);
+	pthread_mutex_lock(&frame->latch);
+	frame->pageNum = pageNum;
+	frame->dirtyBit = 0;
+	frame->fixCount = 1;
+	frame->refNum = 0;
+	frame->isLoading = TRUE;
+	frame->isPrefetched = isPrefetch;
+	if(bm->strategy == RS_CLOCK)
+		// hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
+		frame->hitNum = 1;
+	else if(bm->strategy == RS_LRU_K)
 	{
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		writeBlock(pageFrame[leastHitIndex].pageNum, &fh, pageFrame[leastHitIndex].data);
-		
-		// Increase the writeCount which records the number of writes done by the buffer manager.
-		writeCount++;
+		// LRU-K algorithm continues the retained history of the page if it was replaced recently
+		lruKRestoreHistory(bufferManager, frameIndex, pageNum, bufferManager->refClock + 1);
+		if(!isPrefetch)
+			lruKReference(bufferManager, frameIndex, __sync_add_and_fetch(&bufferManager->refClock, 1));
+		else if(bufferManager->frameHistory[(long long) frameIndex * bufferManager->lruK] == 0)
+			// A page read ahead without history counts as loaded now, so that it is not the first victim before it is used
+			frame->lastRef = bufferManager->refClock;
 	}
-	
-	// Setting page frame's content to new page's content
-	pageFrame[leastHitIndex].data = page->data;
-	pageFrame[leastHitIndex].pageNum = page->pageNum;
-	pageFrame[leastHitIndex].dirtyBit = page->dirtyBit;
-	pageFrame[leastHitIndex].fixCount = page->fixCount;
-	pageFrame[leastHitIndex].hitNum = page->hitNum;
+	else if(bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+		fillFromLists(bm, frameIndex);
+	addToPageTable(bufferManager, frameIndex);
+	pthread_mutex_unlock(&frame->latch);
+	pthread_mutex_unlock(partitionLatch);
+
+	bufferManager->rearIndex++;
 }
 
-// Defining CLOCK function
-extern void CLOCK(BM_BufferPool *const bm, PageFrame *page)
-{	
-	//printf("CLOCK Started");
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	while(1)
+// This function marks page frame frameIndex as loaded and wakes up the clients which pinned the page while it was being read.
+static void finishLoading(BufferManager *bufferManager, int frameIndex)
+{
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+
+	pthread_mutex_lock(&frame->latch);
+	frame->isLoading = FALSE;
+	pthread_cond_broadcast(&frame->ioDone);
+	pthread_mutex_unlock(&frame->latch);
+}
+
+// This function gives up page frame frameIndex (installed by installFrame(...)) whose page could not be read from disk.
+// The page is removed from the page table, the frame is emptied and the loader's pin released, so the frame can be replaced
+// once the clients waiting for the page have dropped their pins. The waiting clients return result.
+static void abandonLoading(BM_BufferPool *const bm, int frameIndex, RC result)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *frame = &bufferManager->pageFrames[frameIndex];
+	pthread_mutex_t *partitionLatch = getPartitionLatch(bufferManager, frame->pageNum);
+
+	pthread_mutex_lock(partitionLatch);
+	pthread_mutex_lock(&frame->latch);
+	removeFromPageTable(bufferManager, frameIndex);
+	frame->pageNum = NO_PAGE;
+	frame->dirtyBit = 0;
+	frame->isPrefetched = FALSE;
+	frame->ioResult = result;
+
+	// Waking up the waiting clients, which find pageNum = NO_PAGE
+	frame->isLoading = FALSE;
+	pthread_cond_broadcast(&frame->ioDone);
+	releaseFrame(bm, frameIndex);
+	pthread_mutex_unlock(&frame->latch);
+	pthread_mutex_unlock(partitionLatch);
+}
+
+// This function loads up to numPages pages starting at firstPage which are not in the buffer pool yet, without pinning them.
+// Pages beyond the end of the page file are not read. Pages present in the pool are skipped. The pages of one call are
+// read with one vectored read (see preadBlocks(...)), so the loaded pages must be consecutive: loading stops at the first
+// page present in the pool after the first loaded one.
+static void readAhead(BM_BufferPool *const bm, PageNumber firstPage, int numPages)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	int frames[MAX_PREFETCH_PAGES];
+	SM_PageHandle pages[MAX_PREFETCH_PAGES];
+	RC results[MAX_PREFETCH_PAGES], result;
+	PageNumber pageNum, runStart = firstPage;
+	int i, loaded = 0;
+
+	if(numPages > MAX_PREFETCH_PAGES)
+		numPages = MAX_PREFETCH_PAGES;
+
+	pthread_mutex_lock(&bufferManager->replacementLatch);
+	for(pageNum = firstPage; pageNum < firstPage + numPages && pageNum < bufferManager->fileHandle.totalNumPages; pageNum++)
 	{
-		clockPointer = (clockPointer % bufferSize == 0) ? 0 : clockPointer;
+		if((i = lookupFrame(bufferManager, pageNum)) != -1)
+		{
+			pthread_mutex_unlock(getPartitionLatch(bufferManager, pageNum));
+			if(loaded > 0)
+				break;
+			runStart = pageNum + 1;
+			continue;
+		}
+
+		// ARC and 2Q algorithms treat pages which were replaced recently (ghosts) differently
+		if(bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+			lookupGhost(bm, pageNum);
 
-		if(pageFrame[clockPointer].hitNum == 0)
+		// Only page frames whose pages can be replaced are used. Read-ahead never fails a client's pin.
+		if((i = takeFrame(bm, &result)) == -1)
+			break;
+		installFrame(bm, i, pageNum, TRUE);
+		frames[loaded] = i;
+		pages[loaded] = pageFrame[i].data;
+		loaded++;
+	}
+	pthread_mutex_unlock(&bufferManager->replacementLatch);
+
+	if(loaded == 0)
+		return;
+
+	// Reading the whole run at once. If the vectored read fails, the pages are read one by one.
+	if(preadBlocks(runStart, loaded, &bufferManager->fileHandle, pages) == RC_OK)
+		for(i = 0; i < loaded; i++)
+			results[i] = RC_OK;
+	else
+		for(i = 0; i < loaded; i++)
+			results[i] = preadBlock(runStart + i, &bufferManager->fileHandle, pages[i]);
+
+	// Waking up the clients waiting for the pages and releasing the read-ahead's pins. Pages which could not be read are unpublished.
+	for(i = 0; i < loaded; i++)
+	{
+		if(results[i] != RC_OK)
 		{
-			// If page in memory has been modified (dirtyBit = 1), then write page to disk
-			if(pageFrame[clockPointer].dirtyBit == 1)
-			{
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pageFrame[clockPointer].pageNum, &fh, pageFrame[clockPointer].data);
-				
-				// Increase the writeCount which records the number of writes done by the buffer manager.
-				writeCount++;
-			}
-			
-			// Setting page frame's content to new page's content
-			pageFrame[clockPointer].data = page->data;
-			pageFrame[clockPointer].pageNum = page->pageNum;
-			pageFrame[clockPointer].dirtyBit = page->dirtyBit;
-			pageFrame[clockPointer].fixCount = page->fixCount;
-			pageFrame[clockPointer].hitNum = page->hitNum;
-			clockPointer++;
-			break;	
+			abandonLoading(bm, frames[i], results[i]);
+			continue;
 		}
-		else
+		finishLoading(bufferManager, frames[i]);
+		pthread_mutex_lock(&pageFrame[frames[i]].latch);
+		releaseFrame(bm, frames[i]);
+		pthread_mutex_unlock(&pageFrame[frames[i]].latch);
+	}
+}
+
+// This is the main loop of the prefetcher thread of a buffer pool. It serves the read-ahead requests in order.
+static void *prefetcher(void *pool)
+{
+	BM_BufferPool *const bm = (BM_BufferPool *) pool;
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PrefetchRequest request;
+
+	pthread_mutex_lock(&bufferManager->prefetchLatch);
+	while(bufferManager->prefetcherRunning)
+	{
+		if(bufferManager->prefetchCount == 0)
 		{
-			// Incrementing clockPointer so that we can check the next page frame location.
-			// We set hitNum = 0 so that this loop doesn't go into an infinite loop.
-			pageFrame[clockPointer++].hitNum = 0;		
+			pthread_cond_wait(&bufferManager->prefetchWakeup, &bufferManager->prefetchLatch);
+			continue;
 		}
+
+		request = bufferManager->prefetchQueue[bufferManager->prefetchHead];
+		bufferManager->prefetchHead = (bufferManager->prefetchHead + 1) % PREFETCH_QUEUE_SIZE;
+		bufferManager->prefetchCount--;
+
+		pthread_mutex_unlock(&bufferManager->prefetchLatch);
+		readAhead(bm, request.firstPage, request.numPages);
+		pthread_mutex_lock(&bufferManager->prefetchLatch);
 	}
+	pthread_mutex_unlock(&bufferManager->prefetchLatch);
+	return NULL;
+}
+
+// This function stops the prefetcher thread of the buffer pool (if any). Pending read-ahead requests are dropped.
+static void stopPrefetcher(BufferManager *bufferManager)
+{
+	pthread_mutex_lock(&bufferManager->prefetchLatch);
+	if(!bufferManager->prefetcherRunning)
+	{
+		pthread_mutex_unlock(&bufferManager->prefetchLatch);
+		return;
+	}
+	bufferManager->prefetcherRunning = FALSE;
+	pthread_cond_signal(&bufferManager->prefetchWakeup);
+	pthread_mutex_unlock(&bufferManager->prefetchLatch);
+	pthread_join(bufferManager->prefetchThread, NULL);
 }
 
 // ***** BUFFER POOL FUNCTIONS ***** //
 
-/* 
+/*
    This function creates and initializes a buffer pool with numPages page frames.
    pageFileName stores the name of the page file whose pages are being cached in memory.
    strategy represents the page replacement strategy (FIFO, LRU, LFU, CLOCK) that will be used by this buffer pool
    stratData is used to pass parameters if any to the page replacement strategy
 */
-extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
-		  const int numPages, ReplacementStrategy strategy, 
+extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
+		  const int numPages, ReplacementStrategy strategy,
 		  void *stratData)
 {
+	BufferManager *bufferManager = (BufferManager *) malloc(sizeof(BufferManager));
+	RC result;
+
+	// Opening the page file once. The file handle is used for all the reads and writes of this buffer pool.
+	if((result = openPageFile((char *)pageFileName, &bufferManager->fileHandle)) != RC_OK)
+	{
+		free(bufferManager);
+		return result;
+	}
+
+	// Allocating the memory of all the page frames at once. Misses read straight into the victim's slot of the arena,
+	// so pinning pages never allocates memory. Aligning it to the OS page size allows direct (unbuffered) I/O.
+	// The extra page at the end is the copy of a dirty victim being written back (see takeFrame(...)).
+	long alignment = sysconf(_SC_PAGESIZE);
+	if(alignment < PAGE_SIZE)
+		alignment = PAGE_SIZE;
+	if(posix_memalign((void **) &bufferManager->pageArena, alignment, (size_t) (numPages + 1) * PAGE_SIZE) != 0)
+	{
+		closePageFile(&bufferManager->fileHandle);
+		free(bufferManager);
+		return RC_ERROR;
+	}
+
+	bufferManager->victimBuffer = bufferManager->pageArena + (size_t) numPages * PAGE_SIZE;
+
 	bm->pageFile = (char *)pageFileName;
 	bm->numPages = numPages;
 	bm->strategy = strategy;
 
 	// Reserver memory space = number of pages x space required for one page
 	PageFrame *page = malloc(sizeof(PageFrame) * numPages);
-	
+
 	// Buffersize is the total number of pages in memory or the buffer pool.
-	bufferSize = numPages;	
+	bufferManager->bufferSize = numPages;
 	int i;
 
 	// Intilalizing all pages in buffer pool. The values of fields (variables) in the page is either NULL or 0
-	for(i = 0; i < bufferSize; i++)
+	for(i = 0; i < bufferManager->bufferSize; i++)
 	{
-		page[i].data = NULL;
+		page[i].data = bufferManager->pageArena + (size_t) i * PAGE_SIZE;
 		page[i].pageNum = -1;
 		page[i].dirtyBit = 0;
 		page[i].fixCount = 0;
-		page[i].hitNum = 0;	
+		page[i].hitNum = 0;
 		page[i].refNum = 0;
+		page[i].lastRef = 0;
+		page[i].hashNext = -1;
+		page[i].listId = NO_LIST;
+		page[i].isLoading = FALSE;
+		page[i].isFlushing = FALSE;
+		page[i].isPrefetched = FALSE;
+		page[i].ioResult = RC_OK;
+		pthread_mutex_init(&page[i].latch, NULL);
+		pthread_cond_init(&page[i].ioDone, NULL);
 	}
 
-	bm->mgmtData = page;
-	writeCount = clockPointer = lfuPointer = 0;
+	// Sizing the page table to the next power of two >= 2 x numPages so that the chains stay short
+	int pageTableSize = 1;
+	while(pageTableSize < 2 * numPages)
+		pageTableSize <<= 1;
+
+	bufferManager->pageTable = malloc(sizeof(int) * pageTableSize);
+	for(i = 0; i < pageTableSize; i++)
+		bufferManager->pageTable[i] = -1;
+	bufferManager->pageTableMask = pageTableSize - 1;
+	bufferManager->usedFrames = 0;
+
+	for(i = 0; i < PAGE_TABLE_PARTITIONS; i++)
+		pthread_mutex_init(&bufferManager->partitionLatches[i], NULL);
+	pthread_mutex_init(&bufferManager->replacementLatch, NULL);
+	pthread_mutex_init(&bufferManager->listLatch, NULL);
+
+	// Replacement lists and ghost lists start empty. All pool sizes get ghost entries for one pool's worth of pages (+ 1 while ARC trims)
+	bufferManager->frameLinks = malloc(sizeof(ListLink) * numPages);
+	bufferManager->ghosts = malloc(sizeof(GhostEntry) * (numPages + 1));
+	bufferManager->ghostLinks = malloc(sizeof(ListLink) * (numPages + 1));
+	bufferManager->ghostTable = malloc(sizeof(int) * pageTableSize);
+	for(i = 0; i < 2; i++)
+	{
+		bufferManager->replacementLists[i].head = bufferManager->replacementLists[i].tail = -1;
+		bufferManager->replacementLists[i].size = 0;
+		bufferManager->ghostLists[i] = bufferManager->replacementLists[i];
+	}
+	bufferManager->freeGhosts = bufferManager->replacementLists[0];
+	for(i = 0; i <= numPages; i++)
+	{
+		bufferManager->ghosts[i].pageNum = NO_PAGE;
+		listAppend(bufferManager->ghostLinks, &bufferManager->freeGhosts, i);
+	}
+	for(i = 0; i < pageTableSize; i++)
+		bufferManager->ghostTable[i] = -1;
+	bufferManager->missGhost = -1;
+	bufferManager->missGhostList = NO_LIST;
+	bufferManager->arcTarget = 0;
+
+	// The background flusher is only started by startBackgroundFlusher(...)
+	bufferManager->flusherRunning = FALSE;
+	bufferManager->flushBuffer = NULL;
+	pthread_mutex_init(&bufferManager->flusherLatch, NULL);
+	pthread_cond_init(&bufferManager->flusherWakeup, NULL);
+
+	// The prefetcher thread is started by the first read-ahead request. Sequential access detection is off until setReadAhead(...)
+	bufferManager->prefetcherRunning = FALSE;
+	bufferManager->prefetchHead = bufferManager->prefetchCount = 0;
+	bufferManager->readAheadEnd = 0;
+	bufferManager->readAheadPages = 0;
+	bufferManager->lastMissPage = NO_PAGE;
+	bufferManager->sequentialMisses = 0;
+	pthread_mutex_init(&bufferManager->prefetchLatch, NULL);
+	pthread_cond_init(&bufferManager->prefetchWakeup, NULL);
+
+	bufferManager->pageFrames = page;
+	bm->mgmtData = bufferManager;
+	bufferManager->rearIndex = bufferManager->writeCount = 0;
+	bufferManager->clockPointer = bufferManager->lfuPointer = 0;
+
+	// LRU-K algorithm keeps K reference times per page frame and the history of recently replaced pages
+	bufferManager->refClock = 0;
+	bufferManager->frameHistory = NULL;
+	bufferManager->retainedHistory = NULL;
+	if(strategy == RS_LRU_K)
+	{
+		bufferManager->lruK = (stratData != NULL && *(int *) stratData > 0) ? *(int *) stratData : LRU_K_DEFAULT_K;
+		bufferManager->correlatedPeriod = (numPages / 4 < LRU_K_CORRELATED_PERIOD) ? numPages / 4 : LRU_K_CORRELATED_PERIOD;
+		bufferManager->frameHistory = calloc((size_t) numPages * bufferManager->lruK, sizeof(long long));
+		bufferManager->retainedHistory = malloc(sizeof(RetainedHistory) * pageTableSize);
+		for(i = 0; i < pageTableSize; i++)
+		{
+			bufferManager->retainedHistory[i].pageNum = NO_PAGE;
+			bufferManager->retainedHistory[i].history = malloc(sizeof(long long) * bufferManager->lruK);
+		}
+		bufferManager->retainedHistoryMask = pageTableSize - 1;
+	}
 	return RC_OK;
-		
+
 }
 
 // Shutdown i.e. close the buffer pool, thereby removing all the pages from the memory and freeing up all resources and releasing some memory space.
+// No other client may use the buffer pool while it is being shut down.
 extern RC shutdownBufferPool(BM_BufferPool *const bm)
 {
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	// Write all dirty pages (modified pages) back to disk
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+
+	// Stopping the prefetcher and the background flusher (if any) and writing all dirty pages (modified pages) back to disk
+	stopPrefetcher(bufferManager);
+	stopBackgroundFlusher(bm);
 	forceFlushPool(bm);
 
-	int i;	
-	for(i = 0; i < bufferSize; i++)
+	int i;
+	for(i = 0; i < bufferManager->bufferSize; i++)
 	{
 		// If fixCount != 0, it means that the contents of the page was modified by some client and has not been written back to disk.
 		if(pageFrame[i].fixCount != 0)
@@ -272,8 +1293,37 @@ extern RC shutdownBufferPool(BM_BufferPool *const bm)
 		}
 	}
 
-	// Releasing space occupied by the page
+	// Releasing space occupied by the pages, their latches and the page table and closing the page file
+	for(i = 0; i < bufferManager->bufferSize; i++)
+	{
+		pthread_mutex_destroy(&pageFrame[i].latch);
+		pthread_cond_destroy(&pageFrame[i].ioDone);
+	}
+	for(i = 0; i < PAGE_TABLE_PARTITIONS; i++)
+		pthread_mutex_destroy(&bufferManager->partitionLatches[i]);
+	pthread_mutex_destroy(&bufferManager->replacementLatch);
+	pthread_mutex_destroy(&bufferManager->listLatch);
+	pthread_mutex_destroy(&bufferManager->flusherLatch);
+	pthread_cond_destroy(&bufferManager->flusherWakeup);
+	pthread_mutex_destroy(&bufferManager->prefetchLatch);
+	pthread_cond_destroy(&bufferManager->prefetchWakeup);
+	free(bufferManager->frameLinks);
+	free(bufferManager->ghosts);
+	free(bufferManager->ghostLinks);
+	free(bufferManager->ghostTable);
+
 	free(pageFrame);
+	free(bufferManager->pageArena);
+	free(bufferManager->pageTable);
+	if(bufferManager->retainedHistory != NULL)
+	{
+		for(i = 0; i <= bufferManager->retainedHistoryMask; i++)
+			free(bufferManager->retainedHistory[i].history);
+		free(bufferManager->retainedHistory);
+	}
+	free(bufferManager->frameHistory);
+	closePageFile(&bufferManager->fileHandle);
+	free(bufferManager);
 	bm->mgmtData = NULL;
 	return RC_OK;
 }
@@ -281,239 +1331,400 @@ extern RC shutdownBufferPool(BM_BufferPool *const bm)
 // This function writes all the dirty pages (having fixCount = 0) to disk
 extern RC forceFlushPool(BM_BufferPool *const bm)
 {
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	RC result = RC_OK, writeResult;
+
 	int i;
-	// Store all dirty pages (modified pages) in memory to page file on disk	
-	for(i = 0; i < bufferSize; i++)
+	// Store all dirty pages (modified pages) in memory to page file on disk.
+	// A page which cannot be written stays dirty. The other pages are still written and the first error is returned.
+	for(i = 0; i < bufferManager->bufferSize; i++)
 	{
+		pthread_mutex_lock(&pageFrame[i].latch);
+		while(pageFrame[i].isFlushing)
+			pthread_cond_wait(&pageFrame[i].ioDone, &pageFrame[i].latch);
 		if(pageFrame[i].fixCount == 0 && pageFrame[i].dirtyBit == 1)
 		{
-			SM_FileHandle fh;
-			// Opening page file available on disk
-			openPageFile(bm->pageFile, &fh);
-			// Writing block of data to the page file on disk
-			writeBlock(pageFrame[i].pageNum, &fh, pageFrame[i].data);
-			// Mark the page not dirty.
-			pageFrame[i].dirtyBit = 0;
-			// Increase the writeCount which records the number of writes done by the buffer manager.
-			writeCount++;
+			// Writing block of data to the page file on disk and marking the page not dirty if that worked
+			if((writeResult = writePageToDisk(bm, pageFrame[i].pageNum, pageFrame[i].data)) == RC_OK)
+				pageFrame[i].dirtyBit = 0;
+			else if(result == RC_OK)
+				result = writeResult;
+		}
+		pthread_mutex_unlock(&pageFrame[i].latch);
+	}
+	return result;
+}
+
+// This function orders flush candidates by page number (used with qsort)
+static int compareFlushCandidates(const void *a, const void *b)
+{
+	return ((const FlushCandidate *) a)->pageNum - ((const FlushCandidate *) b)->pageNum;
+}
+
+// This function runs one round of the background flusher. It returns the number of pages written.
+// If fewer than cleanLowWaterMark page frames are empty or clean and unpinned, it copies up to FLUSHER_BATCH_PAGES
+// dirty unpinned pages into flushBuffer, clears their dirtyBit and writes them in page number order. Runs of
+// consecutive page numbers are written with one vectored write (see pwriteBlocks(...)).
+static int flushDirtyPages(BM_BufferPool *const bm)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	FlushCandidate *candidate = bufferManager->flushCandidates;
+	SM_PageHandle runPages[FLUSHER_BATCH_PAGES];
+	int i, j, candidates = 0, copied = 0, runStart, written = 0;
+	int cleanFrames = bufferManager->bufferSize - bufferManager->usedFrames;
+	bool failed;
+
+	// Finding the dirty unpinned pages. The frames are read without their latches and re-checked below.
+	for(i = 0; i < bufferManager->usedFrames; i++)
+	{
+		if(pageFrame[i].fixCount != 0 || pageFrame[i].isLoading || pageFrame[i].isFlushing)
+			continue;
+		if(pageFrame[i].dirtyBit == 0)
+			cleanFrames++;
+		else
+		{
+			candidate[candidates].pageNum = pageFrame[i].pageNum;
+			candidate[candidates].frameIndex = i;
+			candidates++;
+		}
+	}
+	if(cleanFrames >= bufferManager->cleanLowWaterMark || candidates == 0)
+		return 0;
+
+	// Sorting the candidates by page number so that adjacent pages end up in one run
+	qsort(candidate, candidates, sizeof(FlushCandidate), compareFlushCandidates);
+
+	// Copying the pages which are still dirty and unpinned. Clients may pin and modify them again as soon as the copy is taken.
+	for(i = 0; i < candidates && copied < FLUSHER_BATCH_PAGES; i++)
+	{
+		PageFrame *frame = &pageFrame[candidate[i].frameIndex];
+
+		pthread_mutex_lock(&frame->latch);
+		if(frame->fixCount == 0 && frame->dirtyBit == 1 && !frame->isLoading && !frame->isFlushing && frame->pageNum == candidate[i].pageNum)
+		{
+			memcpy(bufferManager->flushBuffer + (size_t) copied * PAGE_SIZE, frame->data, PAGE_SIZE);
+			frame->dirtyBit = 0;
+			frame->isFlushing = TRUE;
+			candidate[copied++] = candidate[i];
 		}
-	}	
+		pthread_mutex_unlock(&frame->latch);
+	}
+
+	// Writing the copies, one vectored write per run of consecutive page numbers
+	for(runStart = 0; runStart < copied; runStart = i)
+	{
+		for(i = runStart; i < copied && (i == runStart || candidate[i].pageNum == candidate[i - 1].pageNum + 1); i++)
+			runPages[i - runStart] = bufferManager->flushBuffer + (size_t) i * PAGE_SIZE;
+
+		failed = pwriteBlocks(candidate[runStart].pageNum, i - runStart, &bufferManager->fileHandle, runPages) != RC_OK;
+		if(!failed)
+		{
+			__sync_fetch_and_add(&bufferManager->writeCount, i - runStart);
+			written += i - runStart;
+		}
+
+		// Waking up the writers waiting for these pages. Pages whose write failed are marked dirty again.
+		for(j = runStart; j < i; j++)
+		{
+			PageFrame *frame = &pageFrame[candidate[j].frameIndex];
+
+			pthread_mutex_lock(&frame->latch);
+			if(failed)
+				frame->dirtyBit = 1;
+			frame->isFlushing = FALSE;
+			pthread_cond_broadcast(&frame->ioDone);
+			pthread_mutex_unlock(&frame->latch);
+		}
+	}
+	return written;
+}
+
+// This is the main loop of the background flusher thread of a buffer pool.
+// It runs a flush round whenever a miss wakes it up or FLUSHER_INTERVAL_MS have passed, until stopBackgroundFlusher(...) is called.
+static void *backgroundFlusher(void *pool)
+{
+	BM_BufferPool *const bm = (BM_BufferPool *) pool;
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&bufferManager->flusherLatch);
+	while(bufferManager->flusherRunning)
+	{
+		pthread_mutex_unlock(&bufferManager->flusherLatch);
+
+		// Running rounds until enough page frames are clean again
+		while(flushDirtyPages(bm) > 0)
+			;
+
+		pthread_mutex_lock(&bufferManager->flusherLatch);
+		if(!bufferManager->flusherRunning)
+			break;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += FLUSHER_INTERVAL_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		pthread_cond_timedwait(&bufferManager->flusherWakeup, &bufferManager->flusherLatch, &deadline);
+	}
+	pthread_mutex_unlock(&bufferManager->flusherLatch);
+	return NULL;
+}
+
+// This function starts a background flusher thread for the buffer pool. The flusher writes dirty unpinned pages
+// to disk whenever fewer than cleanLowWaterMark page frames are clean (or empty) and unpinned, so that replacements
+// rarely have to write a dirty victim on the pinning client's thread.
+extern RC startBackgroundFlusher(BM_BufferPool *const bm, int cleanLowWaterMark)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+
+	if(bufferManager->flusherRunning)
+		return RC_ERROR;
+
+	// The buffers of the flusher are allocated once and reused by every round
+	if(posix_memalign((void **) &bufferManager->flushBuffer, PAGE_SIZE, (size_t) FLUSHER_BATCH_PAGES * PAGE_SIZE) != 0)
+		return RC_ERROR;
+	bufferManager->flushCandidates = malloc(sizeof(FlushCandidate) * bufferManager->bufferSize);
+
+	bufferManager->cleanLowWaterMark = (cleanLowWaterMark < bufferManager->bufferSize) ? cleanLowWaterMark : bufferManager->bufferSize;
+	bufferManager->flusherRunning = TRUE;
+	if(pthread_create(&bufferManager->flusherThread, NULL, backgroundFlusher, bm) != 0)
+	{
+		bufferManager->flusherRunning = FALSE;
+		free(bufferManager->flushBuffer);
+		free(bufferManager->flushCandidates);
+		bufferManager->flushBuffer = NULL;
+		return RC_ERROR;
+	}
 	return RC_OK;
 }
 
+// This function stops the background flusher thread of the buffer pool (if any) and waits for its current round to finish.
+extern RC stopBackgroundFlusher(BM_BufferPool *const bm)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
 
-// ***** PAGE MANAGEMENT FUNCTIONS ***** //
+	if(!bufferManager->flusherRunning)
+		return RC_OK;
 
-// This function marks the page as dirty indicating that the data of the page has been modified by the client
-extern RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
+	pthread_mutex_lock(&bufferManager->flusherLatch);
+	bufferManager->flusherRunning = FALSE;
+	pthread_cond_signal(&bufferManager->flusherWakeup);
+	pthread_mutex_unlock(&bufferManager->flusherLatch);
+	pthread_join(bufferManager->flusherThread, NULL);
+
+	free(bufferManager->flushBuffer);
+	free(bufferManager->flushCandidates);
+	bufferManager->flushBuffer = NULL;
+	return RC_OK;
+}
+
+// This function asks the buffer pool to load pages firstPage ... firstPage + numPages - 1 in the background.
+// It returns immediately. The pages are read by the pool's prefetcher thread into replaceable page frames and are not pinned.
+// Read-ahead is only a hint: requests are dropped if too many are waiting and pages beyond the end of the page file are ignored.
+extern RC prefetchPages(BM_BufferPool *const bm, PageNumber firstPage, int numPages)
 {
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
 	int i;
-	// Iterating through all the pages in the buffer pool
-	for(i = 0; i < bufferSize; i++)
+
+	if(firstPage < 0 || numPages < 1)
+		return RC_ERROR;
+
+	// Skipping the pages at the start which are in the pool already. If all of them are, the prefetcher is not woken up at all.
+	for(i = 0; i < numPages && lookupFrame(bufferManager, firstPage + i) != -1; i++)
+		pthread_mutex_unlock(getPartitionLatch(bufferManager, firstPage + i));
+	if(i == numPages)
+		return RC_OK;
+	firstPage += i;
+	numPages -= i;
+
+	// Letting the operating system start reading the pages at once. The reads of several requests then overlap on the disk,
+	// and the prefetcher thread mostly copies the pages from the operating system's cache.
+	prefetchBlocks(firstPage, numPages, &bufferManager->fileHandle);
+
+	pthread_mutex_lock(&bufferManager->prefetchLatch);
+
+	// Starting the prefetcher thread on the first request
+	if(!bufferManager->prefetcherRunning)
 	{
-		// If the current page is the page to be marked dirty, then set dirtyBit = 1 (page has been modified) for that page
-		if(pageFrame[i].pageNum == page->pageNum)
+		bufferManager->prefetcherRunning = TRUE;
+		if(pthread_create(&bufferManager->prefetchThread, NULL, prefetcher, bm) != 0)
 		{
-			pageFrame[i].dirtyBit = 1;
-			return RC_OK;		
-		}			
-	}		
-	return RC_ERROR;
+			bufferManager->prefetcherRunning = FALSE;
+			pthread_mutex_unlock(&bufferManager->prefetchLatch);
+			return RC_ERROR;
+		}
+	}
+
+	if(bufferManager->prefetchCount < PREFETCH_QUEUE_SIZE)
+	{
+		bufferManager->prefetchQueue[(bufferManager->prefetchHead + bufferManager->prefetchCount) % PREFETCH_QUEUE_SIZE].firstPage = firstPage;
+		bufferManager->prefetchQueue[(bufferManager->prefetchHead + bufferManager->prefetchCount) % PREFETCH_QUEUE_SIZE].numPages = numPages;
+		bufferManager->prefetchCount++;
+		if(firstPage + numPages > bufferManager->readAheadEnd)
+			bufferManager->readAheadEnd = firstPage + numPages;
+		pthread_cond_signal(&bufferManager->prefetchWakeup);
+	}
+	pthread_mutex_unlock(&bufferManager->prefetchLatch);
+	return RC_OK;
+}
+
+// This function turns on the sequential access detection of the buffer pool with a read-ahead window of numPages pages
+// (0 turns it off). Once a few consecutive pages have missed, the following pages are read ahead, and every time
+// the reader gets close to the end of the pages read so far the next window is requested.
+extern RC setReadAhead(BM_BufferPool *const bm, int numPages)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+
+	if(numPages < 0)
+		return RC_ERROR;
+
+	// The window is kept below a quarter of the pool so that read-ahead cannot flush the whole pool
+	if(numPages > bufferManager->bufferSize / 4)
+		numPages = bufferManager->bufferSize / 4;
+	if(numPages > MAX_PREFETCH_PAGES)
+		numPages = MAX_PREFETCH_PAGES;
+	bufferManager->readAheadPages = numPages;
+	return RC_OK;
+}
+
+
+// ***** PAGE MANAGEMENT FUNCTIONS ***** //
+
+// This function marks the page as dirty indicating that the data of the page has been modified by the client
+extern RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+
+	// Looking up the page frame holding the page in the page table
+	int i = lookupFrame(bufferManager, page->pageNum);
+	if(i == -1)
+		return RC_ERROR;
+
+	// Set dirtyBit = 1 (page has been modified) for that page
+	pthread_mutex_lock(&bufferManager->pageFrames[i].latch);
+	pthread_mutex_unlock(getPartitionLatch(bufferManager, page->pageNum));
+	bufferManager->pageFrames[i].dirtyBit = 1;
+	pthread_mutex_unlock(&bufferManager->pageFrames[i].latch);
+	return RC_OK;
 }
 
 // This function unpins a page from the memory i.e. removes a page from the memory
 extern RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page)
-{	
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	int i;
-	// Iterating through all the pages in the buffer pool
-	for(i = 0; i < bufferSize; i++)
-	{
-		// If the current page is the page to be unpinned, then decrease fixCount (which means client has completed work on that page) and exit loop
-		if(pageFrame[i].pageNum == page->pageNum)
-		{
-			pageFrame[i].fixCount--;
-			break;		
-		}		
-	}
+{
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+
+	// Looking up the page frame holding the page in the page table
+	int i = lookupFrame(bufferManager, page->pageNum);
+	if(i == -1)
+		return RC_OK;
+
+	// Decrease fixCount (which means client has completed work on that page)
+	pthread_mutex_lock(&bufferManager->pageFrames[i].latch);
+	pthread_mutex_unlock(getPartitionLatch(bufferManager, page->pageNum));
+	releaseFrame(bm, i);
+	pthread_mutex_unlock(&bufferManager->pageFrames[i].latch);
 	return RC_OK;
 }
 
 // This function writes the contents of the modified pages back to the page file on disk
 extern RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page)
 {
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	int i;
-	// Iterating through all the pages in the buffer pool
-	for(i = 0; i < bufferSize; i++)
-	{
-		// If the current page = page to be written to disk, then right the page to the disk using the storage manager functions
-		if(pageFrame[i].pageNum == page->pageNum)
-		{		
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pageFrame[i].pageNum, &fh, pageFrame[i].data);
-		
-			// Mark page as undirty because the modified page has been written to disk
-			pageFrame[i].dirtyBit = 0;
-			
-			// Increase the writeCount which records the number of writes done by the buffer manager.
-			writeCount++;
-		}
-	}	
-	return RC_OK;
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	RC result;
+
+	// Looking up the page frame holding the page in the page table
+	int i = lookupFrame(bufferManager, page->pageNum);
+	if(i == -1)
+		return RC_OK;
+
+	// Writing the page to the disk using the storage manager functions.
+	// The frame latch is held during the write so that the page cannot be replaced meanwhile.
+	pthread_mutex_lock(&pageFrame[i].latch);
+	pthread_mutex_unlock(getPartitionLatch(bufferManager, page->pageNum));
+	while(pageFrame[i].isFlushing)
+		pthread_cond_wait(&pageFrame[i].ioDone, &pageFrame[i].latch);
+	result = writePageToDisk(bm, pageFrame[i].pageNum, pageFrame[i].data);
+
+	// Mark page as undirty because the modified page has been written to disk. If the write failed, the page stays dirty.
+	if(result == RC_OK)
+		pageFrame[i].dirtyBit = 0;
+	pthread_mutex_unlock(&pageFrame[i].latch);
+	return result;
 }
 
 // This function pins a page with page number pageNum i.e. adds the page with page number pageNum to the buffer pool.
-// If the buffer pool is full, then it uses appropriate page replacement strategy to replace a page in memory with the new page being pinned. 
-extern RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
+// If the buffer pool is full, then it uses appropriate page replacement strategy to replace a page in memory with the new page being pinned.
+extern RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 	    const PageNumber pageNum)
 {
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	// Checking if buffer pool is empty and this is the first page to be pinned
-	if(pageFrame[0].pageNum == -1)
-	{
-		// Reading page from disk and initializing page frame's content in the buffer pool
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		pageFrame[0].data = (SM_PageHandle) malloc(PAGE_SIZE);
-		ensureCapacity(pageNum,&fh);
-		readBlock(pageNum, &fh, pageFrame[0].data);
-		pageFrame[0].pageNum = pageNum;
-		pageFrame[0].fixCount++;
-		rearIndex = hit = 0;
-		pageFrame[0].hitNum = hit;	
-		pageFrame[0].refNum = 0;
-		page->pageNum = pageNum;
-		page->data = pageFrame[0].data;
-		
-		return RC_OK;		
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	pthread_mutex_t *partitionLatch = getPartitionLatch(bufferManager, pageNum);
+	RC result;
+	int i;
+
+	// Looking up the page in the page table. A hit does not take the replacementLatch.
+	if((i = lookupFrame(bufferManager, pageNum)) != -1)
+		return pinFrame(bm, i, page, partitionLatch);
+
+	pthread_mutex_lock(&bufferManager->replacementLatch);
+
+	// Checking again because another client may have brought the page in while we waited for the replacementLatch
+	if((i = lookupFrame(bufferManager, pageNum)) != -1)
+	{
+		pthread_mutex_unlock(&bufferManager->replacementLatch);
+		return pinFrame(bm, i, page, partitionLatch);
 	}
-	else
-	{	
-		int i;
-		bool isBufferFull = true;
-		
-		for(i = 0; i < bufferSize; i++)
-		{
-			if(pageFrame[i].pageNum != -1)
-			{	
-				// Checking if page is in memory
-				if(pageFrame[i].pageNum == pageNum)
-				{
-					// Increasing fixCount i.e. now there is one more client accessing this page
-					pageFrame[i].fixCount++;
-					isBufferFull = false;
-					hit++; // Incrementing hit (hit is used by LRU algorithm to determine the least recently used page)
-
-					if(bm->strategy == RS_LRU)
-						// LRU algorithm uses the value of hit to determine the least recently used page	
-						pageFrame[i].hitNum = hit;
-					else if(bm->strategy == RS_CLOCK)
-						// hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
-						pageFrame[i].hitNum = 1;
-					else if(bm->strategy == RS_LFU)
-						// Incrementing refNum to add one more to the count of number of times the page is used (referenced)
-						pageFrame[i].refNum++;
-					
-					page->pageNum = pageNum;
-					page->data = pageFrame[i].data;
-
-					clockPointer++;
-					break;
-				}				
-			} else {
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				pageFrame[i].data = (SM_PageHandle) malloc(PAGE_SIZE);
-				readBlock(pageNum, &fh, pageFrame[i].data);
-				pageFrame[i].pageNum = pageNum;
-				pageFrame[i].fixCount = 1;
-				pageFrame[i].refNum = 0;
-				rearIndex++;	
-				hit++; // Incrementing hit (hit is used by LRU algorithm to determine the least recently used page)
-
-				if(bm->strategy == RS_LRU)
-					// LRU algorithm uses the value of hit to determine the least recently used page
-					pageFrame[i].hitNum = hit;				
-				else if(bm->strategy == RS_CLOCK)
-					// hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
-					pageFrame[i].hitNum = 1;
-						
-				page->pageNum = pageNum;
-				page->data = pageFrame[i].data;
-				
-				isBufferFull = false;
-				break;
-			}
-		}
-		
-		// If isBufferFull = true, then it means that the buffer is full and we must replace an existing page using page replacement strategy
-		if(isBufferFull == true)
-		{
-			// Create a new page to store data read from the file.
-			PageFrame *newPage = (PageFrame *) malloc(sizeof(PageFrame));		
-			
-			// Reading page from disk and initializing page frame's content in the buffer pool
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			newPage->data = (SM_PageHandle) malloc(PAGE_SIZE);
-			readBlock(pageNum, &fh, newPage->data);
-			newPage->pageNum = pageNum;
-			newPage->dirtyBit = 0;		
-			newPage->fixCount = 1;
-			newPage->refNum = 0;
-			rearIndex++;
-			hit++;
 
-			if(bm->strategy == RS_LRU)
-				// LRU algorithm uses the value of hit to determine the least recently used page
-				newPage->hitNum = hit;				
-			else if(bm->strategy == RS_CLOCK)
-				// hitNum = 1 to indicate that this was the last page frame examined (added to the buffer pool)
-				newPage->hitNum = 1;
-
-			page->pageNum = pageNum;
-			page->data = newPage->data;			
-
-			// Call appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
-			switch(bm->strategy)
-			{			
-				case RS_FIFO: // Using FIFO algorithm
-					FIFO(bm, newPage);
-					break;
-				
-				case RS_LRU: // Using LRU algorithm
-					LRU(bm, newPage);
-					break;
-				
-				case RS_CLOCK: // Using CLOCK algorithm
-					CLOCK(bm, newPage);
-					break;
-  				
-				case RS_LFU: // Using LFU algorithm
-					LFU(bm, newPage);
-					break;
-  				
-				case RS_LRU_K:
-					printf("\n LRU-k algorithm not implemented");
-					break;
-				
-				default:
-					printf("\nAlgorithm Not Implemented\n");
-					break;
-			}
-						
-		}		
-		return RC_OK;
-	}	
+	// Growing the page file if pageNum lies beyond its end
+	if((result = ensureCapacity(pageNum + 1, &bufferManager->fileHandle)) != RC_OK)
+	{
+		pthread_mutex_unlock(&bufferManager->replacementLatch);
+		return result;
+	}
+
+	// ARC and 2Q algorithms treat pages which were replaced recently (ghosts) differently
+	if(bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+		lookupGhost(bm, pageNum);
+
+	// Taking an empty page frame or replacing an existing page using page replacement strategy
+	if((i = takeFrame(bm, &result)) == -1)
+	{
+		pthread_mutex_unlock(&bufferManager->replacementLatch);
+		return result;
+	}
+
+	installFrame(bm, i, pageNum, FALSE);
+
+	// Detecting sequential access: after SEQUENTIAL_MISSES misses on consecutive pages the following pages are read ahead
+	bufferManager->sequentialMisses = (pageNum == bufferManager->lastMissPage + 1) ? bufferManager->sequentialMisses + 1 : 1;
+	bufferManager->lastMissPage = pageNum;
+	bool sequential = bufferManager->readAheadPages > 0 && bufferManager->sequentialMisses >= SEQUENTIAL_MISSES;
+	pthread_mutex_unlock(&bufferManager->replacementLatch);
+
+	if(sequential)
+		startReadAhead(bm, pageNum);
+
+	// Letting the background flusher check whether enough clean page frames are left
+	if(bufferManager->flusherRunning)
+		pthread_cond_signal(&bufferManager->flusherWakeup);
+
+	// Reading page from disk outside the replacementLatch so that misses on different pages overlap
+	if((result = preadBlock(pageNum, &bufferManager->fileHandle, pageFrame[i].data)) != RC_OK)
+	{
+		// Unpublishing the page so that no client uses the frame's stale data, and failing the clients waiting for it
+		abandonLoading(bm, i, result);
+		return result;
+	}
+
+	// Waking up the clients which pinned the page while it was being read
+	finishLoading(bufferManager, i);
+
+	page->pageNum = pageNum;
+	page->data = pageFrame[i].data;
+	return result;
 }
 
 
@@ -522,12 +1733,13 @@ extern RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
 // This function returns an array of page numbers.
 extern PageNumber *getFrameContents (BM_BufferPool *const bm)
 {
-	PageNumber *frameContents = malloc(sizeof(PageNumber) * bufferSize);
-	PageFrame *pageFrame = (PageFrame *) bm->mgmtData;
-	
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	PageNumber *frameContents = malloc(sizeof(PageNumber) * bufferManager->bufferSize);
+
 	int i = 0;
 	// Iterating through all the pages in the buffer pool and setting frameContents' value to pageNum of the page
-	while(i < bufferSize) {
+	while(i < bufferManager->bufferSize) {
 		frameContents[i] = (pageFrame[i].pageNum != -1) ? pageFrame[i].pageNum : NO_PAGE;
 		i++;
 	}
@@ -537,43 +1749,44 @@ extern PageNumber *getFrameContents (BM_BufferPool *const bm)
 // This function returns an array of bools, each element represents the dirtyBit of the respective page.
 extern bool *getDirtyFlags (BM_BufferPool *const bm)
 {
-	bool *dirtyFlags = malloc(sizeof(bool) * bufferSize);
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	bool *dirtyFlags = malloc(sizeof(bool) * bufferManager->bufferSize);
+
 	int i;
 	// Iterating through all the pages in the buffer pool and setting dirtyFlags' value to TRUE if page is dirty else FALSE
-	for(i = 0; i < bufferSize; i++)
+	for(i = 0; i < bufferManager->bufferSize; i++)
 	{
 		dirtyFlags[i] = (pageFrame[i].dirtyBit == 1) ? true : false ;
-	}	
+	}
 	return dirtyFlags;
 }
 
 // This function returns an array of ints (of size numPages) where the ith element is the fix count of the page stored in the ith page frame.
 extern int *getFixCounts (BM_BufferPool *const bm)
 {
-	int *fixCounts = malloc(sizeof(int) * bufferSize);
-	PageFrame *pageFrame= (PageFrame *)bm->mgmtData;
-	
+	BufferManager *bufferManager = (BufferManager *) bm->mgmtData;
+	PageFrame *pageFrame = bufferManager->pageFrames;
+	int *fixCounts = malloc(sizeof(int) * bufferManager->bufferSize);
+
 	int i = 0;
 	// Iterating through all the pages in the buffer pool and setting fixCounts' value to page's fixCount
-	while(i < bufferSize)
+	while(i < bufferManager->bufferSize)
 	{
 		fixCounts[i] = (pageFrame[i].fixCount != -1) ? pageFrame[i].fixCount : 0;
 		i++;
-	}	
+	}
 	return fixCounts;
 }
 
 // This function returns the number of pages that have been read from disk since a buffer pool has been initialized.
 extern int getNumReadIO (BM_BufferPool *const bm)
 {
-	// Adding one because with start rearIndex with 0.
-	return (rearIndex + 1);
+	return ((BufferManager *) bm->mgmtData)->rearIndex;
 }
 
 // This function returns the number of pages written to the page file since the buffer pool has been initialized.
 extern int getNumWriteIO (BM_BufferPool *const bm)
 {
-	return writeCount;
+	return ((BufferManager *) bm->mgmtData)->writeCount;
 }
@@ -13,7 +13,9 @@ typedef enum ReplacementStrategy {
   RS_LRU = 1,
   RS_CLOCK = 2,
   RS_LFU = 3,
-  RS_LRU_K = 4
+  RS_LRU_K = 4,
+  RS_ARC = 5,
+  RS_2Q = 6
 } ReplacementStrategy;
 
 // Data Types and Structures
@@ -46,6 +48,8 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 		  void *stratData);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC startBackgroundFlusher(BM_BufferPool *const bm, int cleanLowWaterMark);
+RC stopBackgroundFlusher(BM_BufferPool *const bm);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,6 +57,8 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 	    const PageNumber pageNum);
+RC prefetchPages (BM_BufferPool *const bm, PageNumber firstPage, int numPages);
+RC setReadAhead (BM_BufferPool *const bm, int numPages);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
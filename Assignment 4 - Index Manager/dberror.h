@@ -16,6 +16,7 @@ typedef int RC;
 #define RC_READ_NON_EXISTING_PAGE 4
 #define RC_ERROR 400 // Added a new definiton for ERROR
 #define RC_PINNED_PAGES_IN_BUFFER 500 // Added a new definition for Buffer Manager
+#define RC_NO_FREE_BUFFER_FRAME 501 // Added a new definition for Buffer Manager (all page frames are pinned)
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
@@ -32,11 +33,15 @@ typedef int RC;
 // Added new definitions for Record Manager
 #define RC_RM_NO_TUPLE_WITH_GIVEN_RID 600
 #define RC_SCAN_CONDITION_NOT_FOUND 601
+#define RC_RM_RECORD_TOO_LARGE 602
 
 // Added new definition for B-Tree
 #define RC_ORDER_TOO_HIGH_FOR_PAGE 701
 #define RC_INSERT_ERROR 702
 #define RC_NO_RECORDS_TO_SCAN 703
+#define RC_IM_KEY_TOO_LONG 704
+#define RC_IM_TREE_NOT_EMPTY 705
+#define RC_IM_INDEX_OPEN 706
 
 /* holder for error messages */
 extern char *RC_message;
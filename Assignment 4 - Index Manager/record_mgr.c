@@ -10,6 +10,8 @@ typedef struct RecordManager
 {
 	// Buffer Manager's PageHandle for using Buffer Manager to access Page files
 	BM_PageHandle pageHandle;	// Buffer Manager PageHandle 
+	// Buffer Manager's PageHandle of the table's first page, which stays pinned while the table is open
+	BM_PageHandle headerHandle;
 	// Buffer Manager's Buffer Pool for using Buffer Manager	
 	BM_BufferPool bufferPool;
 	// Record ID	
@@ -20,28 +22,857 @@ typedef struct RecordManager
 	int tuplesCount;
 	// This variable stores the location of first free page which has empty slots in table
 	int freePage;
+	// This variable stores the first page which may have no records, where overflow pages are looked for
+	int emptyPage;
+	// This variable stores the number of pages of the table, i.e. the page after the last page which was ever used
+	int numPages;
 	// This variable stores the count of the number of records scanned
 	int scanCount;
+	// This variable marks the attributes which the scan condition references
+	bool *attributes;
 } RecordManager;
 
+#define MAX_SLOTS_PER_PAGE 1024 // Number of slot directory entries the header of a data page has bits for
+
+// Every data page starts with this header, followed by the slot directory (one RecordSlot per slot).
+// The records are stored at the end of the page, from heapStart on, in the format of encodeRecord(...).
+typedef struct RecordPageHeader
+{
+	// Number of entries of the slot directory
+	int numSlots;
+	// Number of slots in use
+	int numRecords;
+	// Offset of the first byte of record data. 0 if the page has not been used yet
+	int heapStart;
+	// Free bytes of the page, including the bytes of removed records which compactPage(...) joins again
+	int freeBytes;
+	// Occupancy bitmap. Bit i of the bitmap (bit i % 64 of word i / 64) is set while slot i is in use
+	unsigned long long slots[MAX_SLOTS_PER_PAGE / 64];
+} RecordPageHeader;
+
+// Entry of the slot directory
+typedef struct RecordSlot
+{
+	// Offset of the record within the page
+	unsigned short offset;
+	// Length of the record (SLOT_LENGTH bits) and the SLOT_FORWARD / SLOT_MOVED flags
+	unsigned short length;
+} RecordSlot;
+
+#define SLOT_LENGTH 0x3FFF // Bits of RecordSlot.length holding the length
+#define SLOT_FORWARD 0x8000 // The slot holds the RID of its record, which moved to another page because it grew
+#define SLOT_MOVED 0x4000 // The slot holds a record which moved here from another page. It is only found through its forward slot
+
+// Every overflow page starts with this header, followed by "length" characters of a string stored out of its record (see encodeRecord(...))
+typedef struct OverflowPageHeader
+{
+	// Always 0, so that the page looks like a data page without slots
+	int numSlots;
+	// Next overflow page of the string. NO_PAGE on its last page
+	int nextPage;
+	// Number of characters of the string on this page
+	int length;
+} OverflowPageHeader;
+
 const int MAX_NUMBER_OF_PAGES = 100;
 const int ATTRIBUTE_SIZE = 15; // Size of the name of the attribute
+const int SCAN_PREFETCH_PAGES = 8; // Number of pages a scan asks the buffer manager to read ahead
+
+// Free space map: page 1 is a free space map page with two bitmaps of one bit for each of the FREE_SPACE_MAP_BITS pages after it.
+// The bit of a page in the FULL_PAGES bitmap is set when a record of the largest length of the table does not fit any more,
+// and in the OVERFLOW_PAGES bitmap while it is an overflow page. The page after them is the next free space map page, and so on.
+// Pages which were never used have zero bits, so an insert finds room without pinning full pages.
+const int FREE_SPACE_MAP_BITS = PAGE_SIZE * 4; // Number of data pages covered by one free space map page
+const int FIRST_DATA_PAGE = 2; // First page holding records
+const int MIN_RECORD_LENGTH = sizeof(RID); // Every record takes at least the bytes of a RID, so its slot can become a forward slot
+const int OVERFLOW_STRING_LENGTH = PAGE_SIZE / 4; // Strings longer than this are stored in overflow pages
 
-RecordManager *recordManager;
+#define FULL_PAGES 0 // Free space map bitmap of the pages without room for a record
+#define OVERFLOW_PAGES 1 // Free space map bitmap of the overflow pages
 
 // ******** CUSTOM FUNCTIONS ******** //
 
-// This function returns a free slot within a page
-int findFreeSlot(char *data, int recordSize)
+// This function returns the largest record which fits on an empty page
+int getPageCapacity()
+{
+	return PAGE_SIZE - sizeof(RecordPageHeader) - sizeof(RecordSlot);
+}
+
+// This function returns the size of an attribute of type INTEGER, FLOAT or BOOLEAN
+int getFixedSize(DataType dataType)
+{
+	switch(dataType)
+	{
+		case DT_INT:
+			return sizeof(int);
+		case DT_FLOAT:
+			return sizeof(float);
+		case DT_BOOL:
+			return sizeof(bool);
+		default:
+			return 0;
+	}
+}
+
+// This function returns the slot directory of a data page
+RecordSlot *getSlots(char *data)
+{
+	return (RecordSlot *) (data + sizeof(RecordPageHeader));
+}
+
+// This function tells whether slot "slot" of a data page is in use
+bool isSlotInUse(char *data, int slot)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+
+	if (slot < 0 || slot >= header->numSlots)
+		return FALSE;
+	return (header->slots[slot / 64] >> (slot % 64)) & 1;
+}
+
+// This function tells whether slot "slot" of a data page holds the record with this slot's RID (here or moved to another page)
+bool isRecordSlot(char *data, int slot)
+{
+	return isSlotInUse(data, slot) && !(getSlots(data)[slot].length & SLOT_MOVED);
+}
+
+// This function prepares a page which was never used, or an overflow page which is given back, as a data page without records
+void initDataPage(char *data)
 {
-	int i, totalSlots = PAGE_SIZE / recordSize; 
+	RecordPageHeader *header = (RecordPageHeader *) data;
 
-	for (i = 0; i < totalSlots; i++)
-		if (data[i * recordSize] != '+')
-			return i;
+	memset(header, 0, sizeof(RecordPageHeader));
+	header->heapStart = PAGE_SIZE;
+	header->freeBytes = PAGE_SIZE - sizeof(RecordPageHeader);
+}
+
+// This function returns a free slot within a page, or -1 if the slot directory is full.
+// The slot after the slot directory is returned if no slot of the directory is free. A page which was never used is prepared here.
+int findFreeSlot(char *data)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	int i;
+
+	if (header->heapStart == 0)
+		initDataPage(data);
+	if (header->numRecords == header->numSlots)
+		return header->numSlots < MAX_SLOTS_PER_PAGE ? header->numSlots : -1;
+
+	// The first zero bit of the occupancy bitmap is the first free slot
+	for (i = 0; i < MAX_SLOTS_PER_PAGE / 64; i++)
+		if (~header->slots[i] != 0)
+			return i * 64 + __builtin_ctzll(~header->slots[i]);
 	return -1;
 }
 
+// This function tells whether a record of "length" bytes fits on a page
+bool hasRoom(char *data, int length)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	int slot = findFreeSlot(data);
+
+	if (slot == -1)
+		return FALSE;
+
+	// A new slot at the end of the slot directory takes space, too
+	return header->freeBytes >= length + (slot == header->numSlots ? (int) sizeof(RecordSlot) : 0);
+}
+
+// This function tells whether a page is full for the free space map, i.e. a record of the largest length "maxLength" does not fit
+bool isPageFull(char *data, int maxLength)
+{
+	return !hasRoom(data, maxLength < getPageCapacity() ? maxLength : getPageCapacity());
+}
+
+// This function moves the records of a page next to each other at the end of the page, so that its free bytes are in one piece
+void compactPage(char *data)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	RecordSlot *slots = getSlots(data);
+	char copy[PAGE_SIZE];
+	int i, length;
+
+	memcpy(copy, data, PAGE_SIZE);
+	header->heapStart = PAGE_SIZE;
+	for (i = 0; i < header->numSlots; i++)
+		if (isSlotInUse(data, i))
+		{
+			length = slots[i].length & SLOT_LENGTH;
+			header->heapStart = header->heapStart - length;
+			memcpy(data + header->heapStart, copy + slots[i].offset, length);
+			slots[i].offset = header->heapStart;
+		}
+}
+
+// This function takes "length" bytes of a page for slot "slot", which is a free slot, the slot after the slot directory
+// or a slot in use whose record has been given up. hasRoom(...) has checked that they fit. Returns their location.
+char *allocateRecord(char *data, int slot, int length)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	RecordSlot *slots = getSlots(data);
+
+	bool newSlot = slot == header->numSlots;
+
+	// Compacting the page if the free bytes between the slot directory (with the new slot) and the records are too few
+	if (header->heapStart - length < (int) (sizeof(RecordPageHeader) + (header->numSlots + newSlot) * sizeof(RecordSlot)))
+		compactPage(data);
+
+	// Adding a slot to the slot directory
+	if (newSlot)
+	{
+		header->numSlots++;
+		header->freeBytes = header->freeBytes - sizeof(RecordSlot);
+	}
+
+	header->heapStart = header->heapStart - length;
+	header->freeBytes = header->freeBytes - length;
+	slots[slot].offset = header->heapStart;
+	slots[slot].length = length;
+
+	if (!isSlotInUse(data, slot))
+	{
+		header->slots[slot / 64] |= 1ULL << (slot % 64);
+		header->numRecords++;
+	}
+	return data + header->heapStart;
+}
+
+// This function frees slot "slot" of a page and the bytes of its record. Free slots at the end of the slot directory are removed.
+void removeSlot(char *data, int slot)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	RecordSlot *slots = getSlots(data);
+	int length = slots[slot].length & SLOT_LENGTH;
+
+	header->freeBytes = header->freeBytes + length;
+	if (slots[slot].offset == header->heapStart)
+		header->heapStart = header->heapStart + length;
+
+	header->slots[slot / 64] &= ~(1ULL << (slot % 64));
+	header->numRecords--;
+
+	while (header->numSlots > 0 && !isSlotInUse(data, header->numSlots - 1))
+	{
+		header->numSlots--;
+		header->freeBytes = header->freeBytes + sizeof(RecordSlot);
+	}
+}
+
+// This function returns the first slot from slot "slot" on which is in use, or -1 if there is none
+int findNextRecord(char *data, int slot)
+{
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	int i = slot / 64;
+
+	if (header->numRecords == 0 || slot >= header->numSlots)
+		return -1;
+
+	// Ignoring the bits of the slots before "slot" in its word
+	unsigned long long records = header->slots[i] & (~0ULL << (slot % 64));
+
+	while (records == 0 && ++i < MAX_SLOTS_PER_PAGE / 64)
+		records = header->slots[i];
+
+	return records != 0 ? i * 64 + __builtin_ctzll(records) : -1;
+}
+
+// This function writes the number of tuples, the first free page and the number of pages to the table's first page, which is kept pinned.
+// Marking it dirty lets the buffer manager write it back with the other changes of the table.
+void updateTableHeader(RecordManager *recordManager)
+{
+	int *header = (int *) recordManager->headerHandle.data;
+
+	header[0] = recordManager->tuplesCount;
+	header[1] = recordManager->freePage;
+	header[2] = recordManager->numPages;
+	markDirty(&recordManager->bufferPool, &recordManager->headerHandle);
+}
+
+// This function counts page "page" to the table's pages
+void usePage(RecordManager *recordManager, int page)
+{
+	if (page >= recordManager->numPages)
+		recordManager->numPages = page + 1;
+}
+
+// This function returns the free space map page which has the bit of data page "page"
+int getFreeSpaceMapPage(int page)
+{
+	return page - (page - 1) % (FREE_SPACE_MAP_BITS + 1);
+}
+
+// This function returns the data page following data page "page", skipping the free space map pages
+int getNextDataPage(int page)
+{
+	page++;
+	if ((page - 1) % (FREE_SPACE_MAP_BITS + 1) == 0)
+		page++;
+	return page;
+}
+
+// This function sets or clears the bit of data page "page" in bitmap "map" (FULL_PAGES or OVERFLOW_PAGES) of its free space map page
+RC setMapBit(RecordManager *recordManager, int page, int map, bool value)
+{
+	BM_PageHandle mapHandle;
+	int mapPage = getFreeSpaceMapPage(page), bit = map * FREE_SPACE_MAP_BITS + page - mapPage - 1;
+	unsigned long long mask = 1ULL << (bit % 64);
+	RC result;
+
+	// Pinning the free space map page. A new one is added to the file filled with zeros
+	if ((result = pinPage(&recordManager->bufferPool, &mapHandle, mapPage)) != RC_OK)
+		return result;
+
+	unsigned long long *word = (unsigned long long *) mapHandle.data + bit / 64;
+
+	// Only a changed bit makes the page dirty
+	if (((*word & mask) != 0) != value)
+	{
+		*word ^= mask;
+		markDirty(&recordManager->bufferPool, &mapHandle);
+	}
+	return unpinPage(&recordManager->bufferPool, &mapHandle);
+}
+
+// This function sets or clears the free space map bit of data page "page" which tells that it is full
+RC setPageFull(RecordManager *recordManager, int page, bool full)
+{
+	return setMapBit(recordManager, page, FULL_PAGES, full);
+}
+
+// This function tells whether data page "page" is an overflow page
+bool isOverflowPage(RecordManager *recordManager, int page)
+{
+	BM_PageHandle mapHandle;
+	int mapPage = getFreeSpaceMapPage(page), bit = FREE_SPACE_MAP_BITS + page - mapPage - 1;
+	bool overflow;
+
+	// The table's first pages and the free space map pages have no bits
+	if (page < FIRST_DATA_PAGE || mapPage == page)
+		return FALSE;
+
+	if (pinPage(&recordManager->bufferPool, &mapHandle, mapPage) != RC_OK)
+		return FALSE;
+	overflow = (((unsigned long long *) mapHandle.data)[bit / 64] >> (bit % 64)) & 1;
+	unpinPage(&recordManager->bufferPool, &mapHandle);
+	return overflow;
+}
+
+// This function returns the first data page from data page "page" on whose free space map bit is clear,
+// looking at 64 pages at a time. Returns -1 if a free space map page cannot be pinned.
+int findFreePage(RecordManager *recordManager, int page)
+{
+	BM_PageHandle mapHandle;
+	int mapPage, bit, i;
+
+	if (page < FIRST_DATA_PAGE)
+		page = FIRST_DATA_PAGE;
+
+	while (TRUE)
+	{
+		mapPage = getFreeSpaceMapPage(page);
+		bit = page - mapPage - 1;
+
+		if (pinPage(&recordManager->bufferPool, &mapHandle, mapPage) != RC_OK)
+			return -1;
+
+		unsigned long long *words = (unsigned long long *) mapHandle.data;
+
+		// Ignoring the bits of the pages before "page" in its word
+		unsigned long long freePages = ~words[bit / 64] & (~0ULL << (bit % 64));
+
+		for (i = bit / 64; freePages == 0 && ++i < FREE_SPACE_MAP_BITS / 64; )
+			freePages = ~words[i];
+
+		unpinPage(&recordManager->bufferPool, &mapHandle);
+
+		if (freePages != 0)
+			return mapPage + 1 + i * 64 + __builtin_ctzll(freePages);
+
+		// All pages of this free space map page are full. Continuing with the first data page of the next one
+		page = mapPage + FREE_SPACE_MAP_BITS + 2;
+	}
+}
+
+
+// This function marks page "page" full or not full in the free space map if a change of the page made it so
+void updateFreeSpaceMap(RecordManager *recordManager, int page, bool wasFull, bool full)
+{
+	if (wasFull != full)
+		setPageFull(recordManager, page, full);
+
+	// Inserts look for room from the first page which may have some
+	if (!full && page < recordManager->freePage)
+		recordManager->freePage = page;
+}
+
+// This function stores the "length" bytes of "stored" on the first page with room for a record of the largest length "maxLength"
+// and sets "id" to their RID. "flags" are kept with the length of the record (SLOT_MOVED for a record moved from another page).
+RC placeRecord(RecordManager *recordManager, char *stored, int length, int maxLength, unsigned short flags, RID *id)
+{
+	BM_PageHandle pageHandle;
+	RC result;
+
+	// Looking up the first page with room in the free space map, starting at the first page which may have some
+	if ((id->page = findFreePage(recordManager, recordManager->freePage)) < 0)
+		return RC_WRITE_FAILED;
+	recordManager->freePage = id->page;
+
+	if ((result = pinPage(&recordManager->bufferPool, &pageHandle, id->page)) != RC_OK)
+		return result;
+
+	while (!hasRoom(pageHandle.data, length))
+	{
+		// If the pinned page has no room then unpin that page and mark it full in the free space map
+		unpinPage(&recordManager->bufferPool, &pageHandle);
+		setPageFull(recordManager, id->page, TRUE);
+
+		// Looking up the next page with room
+		if ((id->page = findFreePage(recordManager, id->page)) < 0)
+			return RC_WRITE_FAILED;
+		recordManager->freePage = id->page;
+
+		if ((result = pinPage(&recordManager->bufferPool, &pageHandle, id->page)) != RC_OK)
+			return result;
+	}
+
+	// Copying the record into the page
+	usePage(recordManager, id->page);
+	id->slot = findFreeSlot(pageHandle.data);
+	memcpy(allocateRecord(pageHandle.data, id->slot, length), stored, length);
+	getSlots(pageHandle.data)[id->slot].length |= flags;
+	markDirty(&recordManager->bufferPool, &pageHandle);
+
+	// Marking the page full in the free space map if a record of the largest length does not fit any more
+	bool full = isPageFull(pageHandle.data, maxLength);
+	unpinPage(&recordManager->bufferPool, &pageHandle);
+	if (full)
+		setPageFull(recordManager, id->page, TRUE);
+	return RC_OK;
+}
+
+// This function frees the slot of RID "id" and the bytes of its record
+RC freeSlot(RecordManager *recordManager, RID id, int maxLength)
+{
+	BM_PageHandle pageHandle;
+	RC result;
+
+	if ((result = pinPage(&recordManager->bufferPool, &pageHandle, id.page)) != RC_OK)
+		return result;
+
+	bool wasFull = isPageFull(pageHandle.data, maxLength);
+	removeSlot(pageHandle.data, id.slot);
+	markDirty(&recordManager->bufferPool, &pageHandle);
+	bool full = isPageFull(pageHandle.data, maxLength);
+	bool empty = ((RecordPageHeader *) pageHandle.data)->numSlots == 0;
+
+	unpinPage(&recordManager->bufferPool, &pageHandle);
+	updateFreeSpaceMap(recordManager, id.page, wasFull, full);
+
+	// Overflow pages are looked for from the first page which may have no records
+	if (empty && id.page < recordManager->emptyPage)
+		recordManager->emptyPage = id.page;
+	return RC_OK;
+}
+
+// This function takes the first data page without records for an overflow page and returns it in "page"
+RC allocateOverflowPage(RecordManager *recordManager, int *page)
+{
+	BM_PageHandle pageHandle;
+	RC result;
+
+	*page = recordManager->emptyPage;
+	while (TRUE)
+	{
+		// Looking up the next page with room in the free space map, starting at the first page which may have no records
+		if ((*page = findFreePage(recordManager, *page)) < 0)
+			return RC_WRITE_FAILED;
+
+		if ((result = pinPage(&recordManager->bufferPool, &pageHandle, *page)) != RC_OK)
+			return result;
+
+		// A page which was never used has no slots either
+		if (((RecordPageHeader *) pageHandle.data)->numSlots == 0)
+			break;
+
+		unpinPage(&recordManager->bufferPool, &pageHandle);
+		*page = getNextDataPage(*page);
+	}
+	recordManager->emptyPage = getNextDataPage(*page);
+	usePage(recordManager, *page);
+
+	OverflowPageHeader *header = (OverflowPageHeader *) pageHandle.data;
+	header->numSlots = 0;
+	header->nextPage = NO_PAGE;
+	header->length = 0;
+	markDirty(&recordManager->bufferPool, &pageHandle);
+	unpinPage(&recordManager->bufferPool, &pageHandle);
+
+	// Inserts do not look for room on the page and scans leave it out
+	if ((result = setPageFull(recordManager, *page, TRUE)) != RC_OK)
+		return result;
+	return setMapBit(recordManager, *page, OVERFLOW_PAGES, TRUE);
+}
+
+// This function gives back the chain of overflow pages starting at page "page". They become data pages without records
+RC freeOverflowPages(RecordManager *recordManager, int page)
+{
+	BM_PageHandle pageHandle;
+	int nextPage;
+	RC result;
+
+	while (page != NO_PAGE)
+	{
+		if ((result = pinPage(&recordManager->bufferPool, &pageHandle, page)) != RC_OK)
+			return result;
+
+		nextPage = ((OverflowPageHeader *) pageHandle.data)->nextPage;
+		initDataPage(pageHandle.data);
+		markDirty(&recordManager->bufferPool, &pageHandle);
+		unpinPage(&recordManager->bufferPool, &pageHandle);
+
+		setMapBit(recordManager, page, OVERFLOW_PAGES, FALSE);
+		updateFreeSpaceMap(recordManager, page, TRUE, FALSE);
+		if (page < recordManager->emptyPage)
+			recordManager->emptyPage = page;
+		page = nextPage;
+	}
+	return RC_OK;
+}
+
+// This function stores the "length" characters of "string" in a chain of overflow pages and returns its first page in "firstPage".
+// If it fails, the pages of the chain written so far are given back
+RC writeOverflowPages(RecordManager *recordManager, char *string, int length, int *firstPage)
+{
+	BM_PageHandle pageHandle;
+	int page, nextPage, capacity = PAGE_SIZE - sizeof(OverflowPageHeader);
+	RC result;
+
+	if ((result = allocateOverflowPage(recordManager, firstPage)) != RC_OK)
+		return result;
+
+	for (page = *firstPage; page != NO_PAGE; page = nextPage)
+	{
+		if ((result = pinPage(&recordManager->bufferPool, &pageHandle, page)) != RC_OK)
+		{
+			freeOverflowPages(recordManager, *firstPage);
+			return result;
+		}
+
+		OverflowPageHeader *header = (OverflowPageHeader *) pageHandle.data;
+
+		// Copying as many characters as fit on the page
+		header->length = length < capacity ? length : capacity;
+		memcpy(pageHandle.data + sizeof(OverflowPageHeader), string, header->length);
+		string = string + header->length;
+		length = length - header->length;
+
+		// Adding a page to the chain for the rest of the string
+		nextPage = NO_PAGE;
+		if (length > 0 && (result = allocateOverflowPage(recordManager, &nextPage)) != RC_OK)
+		{
+			unpinPage(&recordManager->bufferPool, &pageHandle);
+			freeOverflowPages(recordManager, *firstPage);
+			return result;
+		}
+		header->nextPage = nextPage;
+		markDirty(&recordManager->bufferPool, &pageHandle);
+		unpinPage(&recordManager->bufferPool, &pageHandle);
+	}
+	return RC_OK;
+}
+
+// This function reads the string stored in the chain of overflow pages starting at page "page" into "string"
+RC readOverflowPages(RecordManager *recordManager, int page, char *string)
+{
+	BM_PageHandle pageHandle;
+	RC result;
+
+	while (page != NO_PAGE)
+	{
+		if ((result = pinPage(&recordManager->bufferPool, &pageHandle, page)) != RC_OK)
+			return result;
+
+		OverflowPageHeader *header = (OverflowPageHeader *) pageHandle.data;
+		memcpy(string, pageHandle.data + sizeof(OverflowPageHeader), header->length);
+		string = string + header->length;
+		page = header->nextPage;
+		unpinPage(&recordManager->bufferPool, &pageHandle);
+	}
+	return RC_OK;
+}
+
+// This function returns the number of bytes which store the length of a string attribute.
+// Their highest bit is set for a string stored in overflow pages (see encodeRecord(...))
+int getLengthSize(int typeLength)
+{
+	return typeLength < 0x80 ? 1 : (typeLength < 0x8000 ? 2 : sizeof(int));
+}
+
+// This function stores "length" in the "size" bytes at "stored" (little endian), setting their highest bit if "overflow" is TRUE
+void writeLength(char *stored, int size, int length, bool overflow)
+{
+	unsigned int value = length | (overflow ? 1U << (size * 8 - 1) : 0);
+	int i;
+
+	for (i = 0; i < size; i++)
+		stored[i] = value >> (i * 8);
+}
+
+// This function returns the length stored by writeLength(...) and sets "overflow" to its highest bit
+int readLength(char *stored, int size, bool *overflow)
+{
+	unsigned int value = 0, flag = 1U << (size * 8 - 1);
+	int i;
+
+	for (i = 0; i < size; i++)
+		value = value | (unsigned int) (unsigned char) stored[i] << (i * 8);
+	*overflow = (value & flag) != 0;
+	return value & ~flag;
+}
+
+// This function returns the largest number of bytes a record of the schema takes on a page (see encodeRecord(...))
+int getMaxRecordLength(Schema *schema)
+{
+	int length = 0, i, size;
+
+	for(i = 0; i < schema->numAttr; i++)
+	{
+		if(schema->dataTypes[i] == DT_STRING)
+		{
+			// Strings are stored with their length. Long strings only take the number of their first overflow page
+			size = schema->typeLength[i] < OVERFLOW_STRING_LENGTH ? schema->typeLength[i] : OVERFLOW_STRING_LENGTH;
+			length = length + getLengthSize(schema->typeLength[i]) + (size > (int) sizeof(int) ? size : (int) sizeof(int));
+		}
+		else
+			length = length + getFixedSize(schema->dataTypes[i]);
+	}
+	return length > MIN_RECORD_LENGTH ? length : MIN_RECORD_LENGTH;
+}
+
+// This function stores the attributes of the record data "recordData" (without its tombstone byte) in "stored" and sets "length" to their length.
+// A string takes its length and its characters instead of typeLength bytes. Strings longer than OVERFLOW_STRING_LENGTH, and the longest strings
+// of a record which would not fit on a page otherwise, are written to overflow pages and only the number of their first page is stored.
+// If it fails, no overflow pages are kept
+RC encodeRecord(RecordManager *recordManager, Schema *schema, char *recordData, char *stored, int *length)
+{
+	char *attribute = recordData + 1, *end = stored;
+	int *lengths = (int *) malloc(sizeof(int) * schema->numAttr);
+	int *pages = (int *) malloc(sizeof(int) * schema->numAttr);
+	bool *overflow = (bool *) malloc(sizeof(bool) * schema->numAttr);
+	int i, j, size = 0, longest;
+	RC result = RC_OK;
+
+	// Getting the length of each attribute and the strings which go to overflow pages
+	for(i = 0; i < schema->numAttr; i++)
+	{
+		if(schema->dataTypes[i] == DT_STRING)
+		{
+			lengths[i] = strnlen(attribute, schema->typeLength[i]);
+			overflow[i] = lengths[i] > OVERFLOW_STRING_LENGTH;
+			size = size + getLengthSize(schema->typeLength[i]) + (overflow[i] ? (int) sizeof(int) : lengths[i]);
+			attribute = attribute + schema->typeLength[i];
+		}
+		else
+		{
+			lengths[i] = getFixedSize(schema->dataTypes[i]);
+			overflow[i] = FALSE;
+			size = size + lengths[i];
+			attribute = attribute + lengths[i];
+		}
+	}
+
+	// Moving the longest strings to overflow pages until the record fits on a page
+	while(size > getPageCapacity())
+	{
+		longest = -1;
+		for(i = 0; i < schema->numAttr; i++)
+			if(schema->dataTypes[i] == DT_STRING && !overflow[i] && lengths[i] > (int) sizeof(int) && (longest == -1 || lengths[i] > lengths[longest]))
+				longest = i;
+
+		if(longest == -1)
+		{
+			free(lengths);
+			free(pages);
+			free(overflow);
+			return RC_RM_RECORD_TOO_LARGE;
+		}
+		overflow[longest] = TRUE;
+		size = size - lengths[longest] + sizeof(int);
+	}
+
+	attribute = recordData + 1;
+	for(i = 0; i < schema->numAttr && result == RC_OK; i++)
+	{
+		if(schema->dataTypes[i] == DT_STRING)
+		{
+			int lengthSize = getLengthSize(schema->typeLength[i]);
+
+			writeLength(end, lengthSize, lengths[i], overflow[i]);
+			end = end + lengthSize;
+
+			if(overflow[i])
+			{
+				// Storing the string in overflow pages and their first page in the record
+				if((result = writeOverflowPages(recordManager, attribute, lengths[i], &pages[i])) != RC_OK)
+					break;
+				memcpy(end, &pages[i], sizeof(int));
+				end = end + sizeof(int);
+			}
+			else
+			{
+				memcpy(end, attribute, lengths[i]);
+				end = end + lengths[i];
+			}
+			attribute = attribute + schema->typeLength[i];
+		}
+		else
+		{
+			memcpy(end, attribute, lengths[i]);
+			end = end + lengths[i];
+			attribute = attribute + lengths[i];
+		}
+	}
+
+	// Giving back the overflow pages of the strings written before a failure
+	if(result != RC_OK)
+		for(j = 0; j < i; j++)
+			if(overflow[j])
+				freeOverflowPages(recordManager, pages[j]);
+
+	// Padding short records to MIN_RECORD_LENGTH
+	while(end - stored < MIN_RECORD_LENGTH)
+		*end++ = 0;
+	*length = end - stored;
+
+	free(lengths);
+	free(pages);
+	free(overflow);
+	return result;
+}
+
+// This function restores the record data "recordData" (after its tombstone byte) from the attributes stored by encodeRecord(...).
+// Strings in overflow pages are only read if "attributes" is NULL or marks them, the others are left empty. "complete" (if not NULL) tells whether no string was left empty
+RC decodeRecord(RecordManager *recordManager, Schema *schema, char *stored, char *recordData, bool *attributes, bool *complete)
+{
+	char *attribute = recordData + 1;
+	int i, size, page;
+	bool overflow;
+	RC result;
+
+	if(complete != NULL)
+		*complete = TRUE;
+
+	for(i = 0; i < schema->numAttr; i++)
+	{
+		if(schema->dataTypes[i] == DT_STRING)
+		{
+			int lengthSize = getLengthSize(schema->typeLength[i]);
+			int length = readLength(stored, lengthSize, &overflow);
+			stored = stored + lengthSize;
+
+			if(overflow)
+			{
+				// Reading the string from its overflow pages only if it is needed
+				memcpy(&page, stored, sizeof(int));
+				stored = stored + sizeof(int);
+				if(attributes == NULL || attributes[i])
+				{
+					if((result = readOverflowPages(recordManager, page, attribute)) != RC_OK)
+						return result;
+				}
+				else
+				{
+					length = 0;
+					if(complete != NULL)
+						*complete = FALSE;
+				}
+			}
+			else
+			{
+				memcpy(attribute, stored, length);
+				stored = stored + length;
+			}
+
+			// Filling the rest of the attribute with '\0' like setAttr(...) does
+			memset(attribute + length, 0, schema->typeLength[i] - length);
+			attribute = attribute + schema->typeLength[i];
+		}
+		else
+		{
+			size = getFixedSize(schema->dataTypes[i]);
+			memcpy(attribute, stored, size);
+			stored = stored + size;
+			attribute = attribute + size;
+		}
+	}
+	return RC_OK;
+}
+
+// This function gives back the overflow pages of the strings of a record stored by encodeRecord(...)
+void freeOverflowStrings(RecordManager *recordManager, Schema *schema, char *stored)
+{
+	int i, page, length;
+	bool overflow;
+
+	for(i = 0; i < schema->numAttr; i++)
+	{
+		if(schema->dataTypes[i] == DT_STRING)
+		{
+			int lengthSize = getLengthSize(schema->typeLength[i]);
+			length = readLength(stored, lengthSize, &overflow);
+			stored = stored + lengthSize;
+
+			if(overflow)
+			{
+				memcpy(&page, stored, sizeof(int));
+				freeOverflowPages(recordManager, page);
+				length = sizeof(int);
+			}
+			stored = stored + length;
+		}
+		else
+			stored = stored + getFixedSize(schema->dataTypes[i]);
+	}
+}
+
+// This function marks the attributes which the expression "expr" references in "attributes"
+void findAttributes(Expr *expr, bool *attributes)
+{
+	switch(expr->type)
+	{
+		case EXPR_ATTRREF:
+			attributes[expr->expr.attrRef] = TRUE;
+			break;
+		case EXPR_OP:
+			findAttributes(expr->expr.op->args[0], attributes);
+			if(expr->expr.op->type != OP_BOOL_NOT)
+				findAttributes(expr->expr.op->args[1], attributes);
+			break;
+		default:
+			break;
+	}
+}
+
+// This function asks the buffer manager to read the "count" pages from page "page" on in the background, leaving out overflow pages
+void prefetchDataPages(RecordManager *recordManager, int page, int count)
+{
+	int first = page, last = page + count;
+
+	// Pages after the table's last page are not read
+	if(last > recordManager->numPages)
+		last = recordManager->numPages;
+
+	for(; page < last; page++)
+		if(isOverflowPage(recordManager, page))
+		{
+			// Reading the pages before the overflow page
+			if(page > first)
+				prefetchPages(&recordManager->bufferPool, first, page - first);
+			first = page + 1;
+		}
+	if(last > first)
+		prefetchPages(&recordManager->bufferPool, first, last - first);
+}
 
 // ******** TABLE AND RECORD MANAGER FUNCTIONS ******** //
 
@@ -56,20 +887,13 @@ extern RC initRecordManager (void *mgmtData)
 // This functions shuts down the Record Manager
 extern RC shutdownRecordManager ()
 {
-	recordManager = NULL;
-	free(recordManager);
+	// Every table frees its meta data when it is closed
 	return RC_OK;
 }
 
 // This function creates a TABLE with table name "name" having schema specified by "schema"
 extern RC createTable (char *name, Schema *schema)
 {
-	// Allocating memory space to the record manager custom data structure
-	recordManager = (RecordManager*) malloc(sizeof(RecordManager));
-
-	// Initalizing the Buffer Pool using LFU page replacement policy
-	initBufferPool(&recordManager->bufferPool, name, MAX_NUMBER_OF_PAGES, RS_LRU, NULL);
-
 	char data[PAGE_SIZE];
 	char *pageHandle = data;
 	 
@@ -81,12 +905,18 @@ extern RC createTable (char *name, Schema *schema)
 	// Incrementing pointer by sizeof(int) because 0 is an integer
 	pageHandle = pageHandle + sizeof(int);
 	
-	// Setting first page to 1 since 0th page if for schema and other meta data
-	*(int*)pageHandle = 1;
+	// Setting first free page to the first data page since 0th page is for schema and other meta data and 1st page is the free space map
+	*(int*)pageHandle = FIRST_DATA_PAGE;
 
 	// Incrementing pointer by sizeof(int) because 1 is an integer
 	pageHandle = pageHandle + sizeof(int);
 
+	// Setting the number of pages. No data page has been used yet
+	*(int*)pageHandle = FIRST_DATA_PAGE;
+
+	// Incrementing pointer by sizeof(int) because number of pages is an integer
+	pageHandle = pageHandle + sizeof(int);
+
 	// Setting the number of attributes
 	*(int*)pageHandle = schema->numAttr;
 
@@ -145,17 +975,33 @@ extern RC openTable (RM_TableData *rel, char *name)
 	SM_PageHandle pageHandle;    
 	
 	int attributeCount, k;
+	RC result;
+
+	// Allocating memory space to the record manager custom data structure
+	RecordManager *recordManager = (RecordManager*) malloc(sizeof(RecordManager));
+
+	// Initalizing the Buffer Pool of the table using LRU page replacement policy
+	if((result = initBufferPool(&recordManager->bufferPool, name, MAX_NUMBER_OF_PAGES, RS_LRU, NULL)) != RC_OK)
+	{
+		free(recordManager);
+		return result;
+	}
 	
+	// Pinning the first page, which keeps the table's meta data. It stays pinned until the table is closed
+	if((result = pinPage(&recordManager->bufferPool, &recordManager->headerHandle, 0)) != RC_OK)
+	{
+		shutdownBufferPool(&recordManager->bufferPool);
+		free(recordManager);
+		return result;
+	}
+
 	// Setting table's meta data to our custom record manager meta data structure
 	rel->mgmtData = recordManager;
 	// Setting the table's name
 	rel->name = name;
-    
-	// Pinning a page i.e. putting a page in Buffer Pool using Buffer Manager
-	pinPage(&recordManager->bufferPool, &recordManager->pageHandle, 0);
 	
 	// Setting the initial pointer (0th location) if the record manager's page data
-	pageHandle = (char*) recordManager->pageHandle.data;
+	pageHandle = (char*) recordManager->headerHandle.data;
 	
 	// Retrieving total number of tuples from the page file
 	recordManager->tuplesCount= *(int*)pageHandle;
@@ -164,10 +1010,21 @@ extern RC openTable (RM_TableData *rel, char *name)
 	// Getting free page from the page file
 	recordManager->freePage= *(int*) pageHandle;
     	pageHandle = pageHandle + sizeof(int);
+
+	// The pages before the first page with room all have records
+	recordManager->emptyPage = recordManager->freePage;
+
+	// Getting the number of pages from the page file
+	recordManager->numPages = *(int*) pageHandle;
+	pageHandle = pageHandle + sizeof(int);
 	
 	// Getting the number of attributes from the page file
     	attributeCount = *(int*)pageHandle;
 	pageHandle = pageHandle + sizeof(int);
+
+	// Getting the key size from the page file. The key attributes are not stored
+	int keySize = *(int*)pageHandle;
+	pageHandle = pageHandle + sizeof(int);
  	
 	Schema *schema;
 
@@ -179,6 +1036,8 @@ extern RC openTable (RM_TableData *rel, char *name)
 	schema->attrNames = (char**) malloc(sizeof(char*) *attributeCount);
 	schema->dataTypes = (DataType*) malloc(sizeof(DataType) *attributeCount);
 	schema->typeLength = (int*) malloc(sizeof(int) *attributeCount);
+	schema->keySize = keySize;
+	schema->keyAttrs = NULL;
 
 	// Allocate memory space for storing attribute name for each attribute
 	for(k = 0; k < attributeCount; k++)
@@ -202,12 +1061,6 @@ extern RC openTable (RM_TableData *rel, char *name)
 	// Setting newly created schema to the table's schema
 	rel->schema = schema;	
 
-	// Unpinning the page i.e. removing it from Buffer Pool using BUffer Manager
-	unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
-
-	// Write the page back to disk using BUffer Manger
-	forcePage(&recordManager->bufferPool, &recordManager->pageHandle);
-
 	return RC_OK;
 }   
   
@@ -216,11 +1069,18 @@ extern RC closeTable (RM_TableData *rel)
 {
 	// Storing the Table's meta data
 	RecordManager *recordManager = rel->mgmtData;
+	RC result;
+
+	// Unpinning the first page after its meta data is up to date
+	updateTableHeader(recordManager);
+	unpinPage(&recordManager->bufferPool, &recordManager->headerHandle);
 	
-	// Shutting down Buffer Pool	
-	shutdownBufferPool(&recordManager->bufferPool);
-	//rel->mgmtData = NULL;
-	return RC_OK;
+	// Shutting down Buffer Pool, which writes the dirty pages back to disk
+	result = shutdownBufferPool(&recordManager->bufferPool);
+
+	free(recordManager);
+	rel->mgmtData = NULL;
+	return result;
 }
 
 // This function deletes the table having table name "name"
@@ -248,66 +1108,32 @@ extern RC insertRecord (RM_TableData *rel, Record *record)
 	// Retrieving our meta data stored in the table
 	RecordManager *recordManager = rel->mgmtData;	
 	
-	// Setting the Record ID for this record
-	RID *recordID = &record->id; 
-	
-	char *data, *slotPointer;
-	
-	// Getting the size in bytes needed to store on record for the given schema
-	int recordSize = getRecordSize(rel->schema);
-	
-	// Setting first free page to the current page
-	recordID->page = recordManager->freePage;
-
-	// Pinning page i.e. telling Buffer Manager that we are using this page
-	pinPage(&recordManager->bufferPool, &recordManager->pageHandle, recordID->page);
-	
-	// Setting the data to initial position of record's data
-	data = recordManager->pageHandle.data;
-	
-	// Getting a free slot using our custom function
-	recordID->slot = findFreeSlot(data, recordSize);
-
-	while(recordID->slot == -1)
+	// Getting the largest number of bytes a record of the schema takes on a page
+	int maxLength = getMaxRecordLength(rel->schema);
+	char *stored = (char *) malloc(maxLength);
+	RC result;
+
+	// Converting the record to the format stored in the pages. Strings only take their actual length, long strings go to overflow pages
+	int length;
+	if((result = encodeRecord(recordManager, rel->schema, record->data, stored, &length)) != RC_OK)
 	{
-		// If the pinned page doesn't have a free slot then unpin that page
-		unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);	
-		
-		// Incrementing page
-		recordID->page++;
-		
-		// Bring the new page into the BUffer Pool using Buffer Manager
-		pinPage(&recordManager->bufferPool, &recordManager->pageHandle, recordID->page);
-		
-		// Setting the data to initial position of record's data		
-		data = recordManager->pageHandle.data;
-
-		// Again checking for a free slot using our custom function
-		recordID->slot = findFreeSlot(data, recordSize);
+		free(stored);
+		return result;
 	}
-	
-	slotPointer = data;
-	
-	// Mark page dirty to notify that this page was modified
-	markDirty(&recordManager->bufferPool, &recordManager->pageHandle);
-	
-	// Calculation slot starting position
-	slotPointer = slotPointer + (recordID->slot * recordSize);
-
-	// Appending '+' as tombstone to indicate this is a new record and should be removed if space is lesss
-	*slotPointer = '+';
 
-	// Copy the record's data to the memory location pointed by slotPointer
-	memcpy(++slotPointer, record->data + 1, recordSize - 1);
+	// Storing the record on the first page with room and setting the Record ID for this record
+	result = placeRecord(recordManager, stored, length, maxLength, 0, &record->id);
 
-	// Unpinning a page i.e. removing a page from the BUffer Pool
-	unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+	// Giving back the overflow pages of a record which could not be stored
+	if(result != RC_OK)
+		freeOverflowStrings(recordManager, rel->schema, stored);
+	free(stored);
+	if(result != RC_OK)
+		return result;
 	
 	// Incrementing count of tuples
 	recordManager->tuplesCount++;
-	
-	// Pinback the page	
-	pinPage(&recordManager->bufferPool, &recordManager->pageHandle, 0);
+	updateTableHeader(recordManager);
 
 	return RC_OK;
 }
@@ -318,29 +1144,51 @@ extern RC deleteRecord (RM_TableData *rel, RID id)
 	// Retrieving our meta data stored in the table
 	RecordManager *recordManager = rel->mgmtData;
 	
-	// Pinning the page which has the record which we want to update
-	pinPage(&recordManager->bufferPool, &recordManager->pageHandle, id.page);
+	RC result;
 
-	// Update free page because this page 
-	recordManager->freePage = id.page;
+	// Pinning the page which has the record which we want to delete
+	if((result = pinPage(&recordManager->bufferPool, &recordManager->pageHandle, id.page)) != RC_OK)
+		return result;
 	
 	char *data = recordManager->pageHandle.data;
 
-	// Getting the size of the record
-	int recordSize = getRecordSize(rel->schema);
+	if(!isRecordSlot(data, id.slot))
+	{
+		// Return error if no matching record for Record ID 'id' is found in the table
+		unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+		return RC_RM_NO_TUPLE_WITH_GIVEN_RID;
+	}
 
-	// Setting data pointer to the specific slot of the record
-	data = data + (id.slot * recordSize);
-	
-	// '-' is used for Tombstone mechanism. It denotes that the record is deleted
-	*data = '-';
-		
-	// Mark the page dirty because it has been modified
-	markDirty(&recordManager->bufferPool, &recordManager->pageHandle);
+	// Getting the RID of the record if it moved to another page
+	RecordSlot slot = getSlots(data)[id.slot];
+	RID moved;
+	if(slot.length & SLOT_FORWARD)
+		memcpy(&moved, data + slot.offset, sizeof(RID));
+	else
+		// Giving back the overflow pages of the record's long strings
+		freeOverflowStrings(recordManager, rel->schema, data + slot.offset);
 
-	// Unpin the page after the record is retrieved since the page is no longer required to be in memory
+	// Unpin the page since the slot is freed by freeSlot(...)
 	unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
 
+	// Freeing the slot of the record, and the slot it moved to
+	int maxLength = getMaxRecordLength(rel->schema);
+	if(slot.length & SLOT_FORWARD)
+	{
+		if((result = pinPage(&recordManager->bufferPool, &recordManager->pageHandle, moved.page)) != RC_OK)
+			return result;
+		data = recordManager->pageHandle.data;
+		freeOverflowStrings(recordManager, rel->schema, data + getSlots(data)[moved.slot].offset);
+		unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+		if((result = freeSlot(recordManager, moved, maxLength)) != RC_OK)
+			return result;
+	}
+	if((result = freeSlot(recordManager, id, maxLength)) != RC_OK)
+		return result;
+
+	// Decrementing count of tuples
+	recordManager->tuplesCount--;
+	updateTableHeader(recordManager);
 	return RC_OK;
 }
 
@@ -350,34 +1198,119 @@ extern RC updateRecord (RM_TableData *rel, Record *record)
 	// Retrieving our meta data stored in the table
 	RecordManager *recordManager = rel->mgmtData;
 	
-	// Pinning the page which has the record which we want to update
-	pinPage(&recordManager->bufferPool, &recordManager->pageHandle, record->id.page);
-
 	char *data;
+	RC result = RC_OK;
 
-	// Getting the size of the record
-	int recordSize = getRecordSize(rel->schema);
+	// Pinning the page which has the record which we want to update
+	if((result = pinPage(&recordManager->bufferPool, &recordManager->pageHandle, record->id.page)) != RC_OK)
+		return result;
 
 	// Set the Record's ID
 	RID id = record->id;
 
-	// Getting record data's memory location and calculating the start position of the new data
+	// Getting record data's memory location
 	data = recordManager->pageHandle.data;
-	data = data + (id.slot * recordSize);
-	
-	// '+' is used for Tombstone mechanism. It denotes that the record is not empty
-	*data = '+';
-	
-	// Copy the new record data to the exisitng record
-	memcpy(++data, record->data + 1, recordSize - 1 );
+
+	if(!isRecordSlot(data, id.slot))
+	{
+		// Return error if no matching record for Record ID 'id' is found in the table
+		unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+		return RC_RM_NO_TUPLE_WITH_GIVEN_RID;
+	}
+
+	int maxLength = getMaxRecordLength(rel->schema);
+	RecordPageHeader *header = (RecordPageHeader *) data;
+	RecordSlot *slot = &getSlots(data)[id.slot];
+	bool forwarded = (slot->length & SLOT_FORWARD) != 0;
+	char *oldStored = (char *) malloc(maxLength);
+	RID oldMoved;
+
+	// Keeping a copy of the old record, which may have moved to another page. It is only given up once the new record is stored
+	if(forwarded)
+	{
+		BM_PageHandle movedHandle;
+		memcpy(&oldMoved, data + slot->offset, sizeof(RID));
+		if((result = pinPage(&recordManager->bufferPool, &movedHandle, oldMoved.page)) != RC_OK)
+		{
+			unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+			free(oldStored);
+			return result;
+		}
+		RecordSlot movedSlot = getSlots(movedHandle.data)[oldMoved.slot];
+		memcpy(oldStored, movedHandle.data + movedSlot.offset, movedSlot.length & SLOT_LENGTH);
+		unpinPage(&recordManager->bufferPool, &movedHandle);
+	}
+	else
+		memcpy(oldStored, data + slot->offset, slot->length & SLOT_LENGTH);
+
+	// Converting the new record data to the format stored in the pages
+	char *stored = (char *) malloc(maxLength);
+	int length;
+
+	if((result = encodeRecord(recordManager, rel->schema, record->data, stored, &length)) != RC_OK)
+	{
+		unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+		free(stored);
+		free(oldStored);
+		return result;
+	}
+
+	bool wasFull = isPageFull(data, maxLength);
+	int oldLength = slot->length & SLOT_LENGTH;
+
+	if(length <= oldLength)
+	{
+		// The new record fits in place of the old one. The bytes it does not need are free
+		memcpy(data + slot->offset, stored, length);
+		header->freeBytes = header->freeBytes + oldLength - length;
+		slot->length = length;
+	}
+	else if(header->freeBytes + oldLength >= length)
+	{
+		// The new record fits on the page once the bytes of the old one are free. The page is compacted if needed
+		header->freeBytes = header->freeBytes + oldLength;
+		if(slot->offset == header->heapStart)
+			header->heapStart = header->heapStart + oldLength;
+		slot->length = 0;
+		memcpy(allocateRecord(data, id.slot, length), stored, length);
+	}
+	else
+	{
+		// The new record moves to another page. Its slot keeps the RID of the new place, so the Record ID stays the same
+		RID moved;
+		if((result = placeRecord(recordManager, stored, length, maxLength, SLOT_MOVED, &moved)) == RC_OK)
+		{
+			memcpy(data + slot->offset, &moved, sizeof(RID));
+			header->freeBytes = header->freeBytes + oldLength - sizeof(RID);
+			slot->length = sizeof(RID) | SLOT_FORWARD;
+		}
+	}
+
+	if(result == RC_OK)
+	{
+		// Giving up the old record: the place it had moved to and the overflow pages of its long strings
+		if(forwarded)
+			freeSlot(recordManager, oldMoved, maxLength);
+		freeOverflowStrings(recordManager, rel->schema, oldStored);
+	}
+	else
+		// The old record stays. The overflow pages written for the new one are given back
+		freeOverflowStrings(recordManager, rel->schema, stored);
+	free(oldStored);
+	free(stored);
 	
 	// Mark the page dirty because it has been modified
 	markDirty(&recordManager->bufferPool, &recordManager->pageHandle);
+	bool full = isPageFull(data, maxLength);
 
-	// Unpin the page after the record is retrieved since the page is no longer required to be in memory
+	// Unpin the page after the record is updated since the page is no longer required to be in memory
 	unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+	updateFreeSpaceMap(recordManager, id.page, wasFull, full);
+
+	// Moving the record may have used new pages
+	updateTableHeader(recordManager);
 	
-	return RC_OK;	
+	return result;	
 }
 
 // This function retrieves a record having Record ID "id" in the table referenced by "rel".
@@ -387,35 +1320,47 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record)
 	// Retrieving our meta data stored in the table
 	RecordManager *recordManager = rel->mgmtData;
 	
+	RC result;
+
 	// Pinning the page which has the record we want to retreive
-	pinPage(&recordManager->bufferPool, &recordManager->pageHandle, id.page);
+	if((result = pinPage(&recordManager->bufferPool, &recordManager->pageHandle, id.page)) != RC_OK)
+		return result;
 
-	// Getting the size of the record
-	int recordSize = getRecordSize(rel->schema);
 	char *dataPointer = recordManager->pageHandle.data;
-	dataPointer = dataPointer + (id.slot * recordSize);
 	
-	if(*dataPointer != '+')
+	if(!isRecordSlot(dataPointer, id.slot))
 	{
 		// Return error if no matching record for Record ID 'id' is found in the table
+		unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
 		return RC_RM_NO_TUPLE_WITH_GIVEN_RID;
 	}
 	else
 	{
+		RecordSlot slot = getSlots(dataPointer)[id.slot];
+
+		// Following the slot to the page the record moved to
+		if(slot.length & SLOT_FORWARD)
+		{
+			RID moved;
+			memcpy(&moved, dataPointer + slot.offset, sizeof(RID));
+			unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
+			if((result = pinPage(&recordManager->bufferPool, &recordManager->pageHandle, moved.page)) != RC_OK)
+				return result;
+			dataPointer = recordManager->pageHandle.data;
+			slot = getSlots(dataPointer)[moved.slot];
+		}
+
 		// Setting the Record ID
 		record->id = id;
 
-		// Setting the pointer to data field of 'record' so that we can copy the data of the record
-		char *data = record->data;
-
-		// Copy data using C's function memcpy(...)
-		memcpy(++data, dataPointer + 1, recordSize - 1);
+		// Copy the attributes of the record to the data field of 'record'
+		result = decodeRecord(recordManager, rel->schema, dataPointer + slot.offset, record->data, NULL, NULL);
 	}
 
 	// Unpin the page after the record is retrieved since the page is no longer required to be in memory
 	unpinPage(&recordManager->bufferPool, &recordManager->pageHandle);
 
-	return RC_OK;
+	return result;
 }
 
 
@@ -430,11 +1375,7 @@ extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 		return RC_SCAN_CONDITION_NOT_FOUND;
 	}
 
-	// Open the table in memory
-	openTable(rel, "ScanTable");
-
     	RecordManager *scanManager;
-	RecordManager *tableManager;
 
 	// Allocating some memory to the scanManager
     	scanManager = (RecordManager*) malloc(sizeof(RecordManager));
@@ -442,8 +1383,8 @@ extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 	// Setting the scan's meta data to our meta data
     	scan->mgmtData = scanManager;
     	
-	// 1 to start scan from the first page
-    	scanManager->recordID.page = 1;
+	// Start scan from the first data page
+    	scanManager->recordID.page = FIRST_DATA_PAGE;
     	
 	// 0 to start scan from the first slot	
 	scanManager->recordID.slot = 0;
@@ -453,13 +1394,11 @@ extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 
 	// Setting the scan condition
     	scanManager->condition = cond;
-    	
-	// Setting the our meta data to the table's meta data
-    	tableManager = rel->mgmtData;
-
-	// Setting the tuple count
-    	tableManager->tuplesCount = ATTRIBUTE_SIZE;
 
+	// Marking the attributes the condition needs. Strings in overflow pages are only read for them, or for a record which is returned
+	scanManager->attributes = (bool *) calloc(rel->schema->numAttr, sizeof(bool));
+	findAttributes(cond, scanManager->attributes);
+    	
 	// Setting the scan's table i.e. the table which has to be scanned using the specified condition
     	scan->rel= rel;
 
@@ -481,18 +1420,9 @@ extern RC next (RM_ScanHandle *scan, Record *record)
 		return RC_SCAN_CONDITION_NOT_FOUND;
 	}
 
-	Value *result = (Value *) malloc(sizeof(Value));
+	Value *result;
    
 	char *data;
-   	
-	// Getting record size of the schema
-	int recordSize = getRecordSize(schema);
-
-	// Calculating Total number of slots
-	int totalSlots = PAGE_SIZE / recordSize;
-
-	// Getting Scan Count
-	int scanCount = scanManager->scanCount;
 
 	// Getting tuples count of the table
 	int tuplesCount = tableManager->tuplesCount;
@@ -501,73 +1431,114 @@ extern RC next (RM_ScanHandle *scan, Record *record)
 	if (tuplesCount == 0)
 		return RC_RM_NO_MORE_TUPLES;
 
-	// Iterate through the tuples
-	while(scanCount <= tuplesCount)
-	{  
-		// If all the tuples have been scanned, execute this block
-		if (scanCount <= 0)
-		{
-			// printf("INSIDE If scanCount <= 0 \n");
-			// Set PAGE and SLOT to first position
-			scanManager->recordID.page = 1;
-			scanManager->recordID.slot = 0;
-		}
-		else
+	// Iterate through the pages of the table
+	while(scanManager->recordID.page < tableManager->numPages)
+	{
+		if(scanManager->recordID.slot == 0)
 		{
-			// printf("INSIDE Else scanCount <= 0 \n");
-			scanManager->recordID.slot++;
-
-			// If all the slots have been scanned execute this block
-			if(scanManager->recordID.slot >= totalSlots)
+			// Overflow pages only hold strings of records on other pages
+			if(isOverflowPage(tableManager, scanManager->recordID.page))
 			{
-				scanManager->recordID.slot = 0;
-				scanManager->recordID.page++;
+				scanManager->recordID.page = getNextDataPage(scanManager->recordID.page);
+				continue;
 			}
+
+			// Asking the buffer manager to read the next data pages in the background whenever the scan enters a new page
+			prefetchDataPages(tableManager, scanManager->recordID.page + 1, SCAN_PREFETCH_PAGES);
 		}
 
 		// Pinning the page i.e. putting the page in buffer pool
-		pinPage(&tableManager->bufferPool, &scanManager->pageHandle, scanManager->recordID.page);
+		RC pinResult = pinPage(&tableManager->bufferPool, &scanManager->pageHandle, scanManager->recordID.page);
+		if(pinResult != RC_OK)
+			return pinResult;
 			
 		// Retrieving the data of the page			
 		data = scanManager->pageHandle.data;
 
-		// Calulate the data location from record's slot and record size
-		data = data + (scanManager->recordID.slot * recordSize);
-		
-		// Set the record's slot and page to scan manager's slot and page
-		record->id.page = scanManager->recordID.page;
-		record->id.slot = scanManager->recordID.slot;
+		// Iterate through the records of the page, skipping empty slots (and empty pages) with the occupancy bitmap
+		int slot;
+		while((slot = findNextRecord(data, scanManager->recordID.slot)) != -1)
+		{
+			RecordSlot recordSlot = getSlots(data)[slot];
+			scanManager->recordID.slot = slot + 1;
 
-		// Intialize the record data's first location
-		char *dataPointer = record->data;
+			// Records which moved here from another page are returned through their forward slot
+			if(recordSlot.length & SLOT_MOVED)
+				continue;
 
-		// '-' is used for Tombstone mechanism.
-		*dataPointer = '-';
-		
-		memcpy(++dataPointer, data + 1, recordSize - 1);
+			// Set the record's slot and page to scan manager's slot and page
+			record->id.page = scanManager->recordID.page;
+			record->id.slot = slot;
 
-		// Increment scan count because we have scanned one record
-		scanManager->scanCount++;
-		scanCount++;
+			// Intialize the record data's first location
+			char *dataPointer = record->data;
 
-		// Test the record for the specified condition (test expression)
-		evalExpr(record, schema, scanManager->condition, &result); 
+			// '-' is used for Tombstone mechanism.
+			*dataPointer = '-';
 
-		// v.boolV is TRUE if the record satisfies the condition
-		if(result->v.boolV == TRUE)
-		{
-			// Unpin the page i.e. remove it from the buffer pool.
-			unpinPage(&tableManager->bufferPool, &scanManager->pageHandle);
-			// Return SUCCESS			
-			return RC_OK;
+			BM_PageHandle movedHandle;
+			char *stored = data + recordSlot.offset;
+
+			if(recordSlot.length & SLOT_FORWARD)
+			{
+				// Reading the record from the page it moved to
+				RID moved;
+				memcpy(&moved, stored, sizeof(RID));
+				if((pinResult = pinPage(&tableManager->bufferPool, &movedHandle, moved.page)) != RC_OK)
+				{
+					unpinPage(&tableManager->bufferPool, &scanManager->pageHandle);
+					return pinResult;
+				}
+				stored = movedHandle.data + getSlots(movedHandle.data)[moved.slot].offset;
+			}
+
+			// Only the long strings the condition needs are read from their overflow pages
+			bool complete, found = FALSE;
+			RC decodeResult = decodeRecord(tableManager, schema, stored, record->data, scanManager->attributes, &complete);
+
+			if(decodeResult == RC_OK)
+			{
+				// Increment scan count because we have scanned one record
+				scanManager->scanCount++;
+
+				// Test the record for the specified condition (test expression)
+				evalExpr(record, schema, scanManager->condition, &result); 
+
+				// v.boolV is TRUE if the record satisfies the condition
+				found = result->v.boolV == TRUE;
+				freeVal(result);
+
+				// Reading the other long strings of a record which is returned
+				if(found && !complete)
+					decodeResult = decodeRecord(tableManager, schema, stored, record->data, NULL, NULL);
+			}
+			if(recordSlot.length & SLOT_FORWARD)
+				unpinPage(&tableManager->bufferPool, &movedHandle);
+
+			// Returning the error if a string could not be read from its overflow pages
+			if(decodeResult != RC_OK)
+			{
+				unpinPage(&tableManager->bufferPool, &scanManager->pageHandle);
+				return decodeResult;
+			}
+
+			if(found)
+			{
+				// Unpin the page i.e. remove it from the buffer pool.
+				unpinPage(&tableManager->bufferPool, &scanManager->pageHandle);
+				// Return SUCCESS			
+				return RC_OK;
+			}
 		}
+
+		// Unpin the page and continue with the first slot of the next page
+		unpinPage(&tableManager->bufferPool, &scanManager->pageHandle);
+		scanManager->recordID.page = getNextDataPage(scanManager->recordID.page);
+		scanManager->recordID.slot = 0;
 	}
 	
-	// Unpin the page i.e. remove it from the buffer pool.
-	unpinPage(&tableManager->bufferPool, &scanManager->pageHandle);
-	
 	// Reset the Scan Manager's values
-	scanManager->recordID.page = 1;
+	scanManager->recordID.page = FIRST_DATA_PAGE;
 	scanManager->recordID.slot = 0;
 	scanManager->scanCount = 0;
 	
@@ -579,23 +1550,20 @@ extern RC next (RM_ScanHandle *scan, Record *record)
 extern RC closeScan (RM_ScanHandle *scan)
 {
 	RecordManager *scanManager = scan->mgmtData;
-	RecordManager *recordManager = scan->rel->mgmtData;
 
-	// Check if scan was incomplete
+	// Check if scan was incomplete. No page stays pinned between calls of next(...)
 	if(scanManager->scanCount > 0)
 	{
-		// Unpin the page i.e. remove it from the buffer pool.
-		unpinPage(&recordManager->bufferPool, &scanManager->pageHandle);
-		
 		// Reset the Scan Manager's values
 		scanManager->scanCount = 0;
-		scanManager->recordID.page = 1;
+		scanManager->recordID.page = FIRST_DATA_PAGE;
 		scanManager->recordID.slot = 0;
 	}
 	
 	// De-allocate all the memory space allocated to the scans's meta data (our custom structure)
+	free(scanManager->attributes);
+    	free(scanManager);
     	scan->mgmtData = NULL;
-    	free(scan->mgmtData);  
 	
 	return RC_OK;
 }
@@ -756,9 +1724,6 @@ extern RC getAttr (Record *record, Schema *schema, int attrNum, Value **value)
 	// Adding offset to the starting position
 	dataPointer = dataPointer + offset;
 
-	// If attrNum = 1
-	schema->dataTypes[attrNum] = (attrNum == 1) ? 1 : schema->dataTypes[attrNum];
-	
 	// Retrieve attribute's value depending on attribute's data type
 	switch(schema->dataTypes[attrNum])
 	{
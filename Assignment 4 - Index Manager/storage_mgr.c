@@ -2,416 +2,297 @@
 #include<stdlib.h>
 #include<sys/stat.h>
 #include<sys/types.h>
+#include<sys/uio.h>
+#include<fcntl.h>
 #include<unistd.h>
 #include<string.h>
 #include<math.h>
 
 #include "storage_mgr.h"
 
-FILE *pageFile;
+// This structure is stored in SM_FileHandle's mgmtInfo and owns the file descriptor of an open page file.
+// The descriptor is opened once in openPageFile(...) and released in closePageFile(...) so that every
+// block read/write is a single positioned system call (pread/pwrite) instead of an fopen/fclose cycle.
+typedef struct FileManager
+{
+	int fd; // File descriptor of the open page file
+} FileManager;
+
+// This function returns the file descriptor of an open file handle or -1 if the handle was not initialized.
+static int getFileDescriptor(SM_FileHandle *fHandle)
+{
+	if(fHandle == NULL || fHandle->mgmtInfo == NULL)
+		return -1;
+	return ((FileManager *) fHandle->mgmtInfo)->fd;
+}
 
 extern void initStorageManager (void) {
-	// Initialising file pointer i.e. storage manager.
-	pageFile = NULL;
+	// Nothing to initialise. Each file handle owns its own file descriptor (see FileManager).
 }
 
 extern RC createPageFile (char *fileName) {
-	// Opening file stream in read & write mode. 'w+' mode creates an empty file for both reading and writing.
-	pageFile = fopen(fileName, "w+");
+	// Opening file in read & write mode. O_CREAT | O_TRUNC creates an empty file (or empties an existing one).
+	int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
 
 	// Checking if file was successfully opened.
-	if(pageFile == NULL) {
+	if(fd < 0)
 		return RC_FILE_NOT_FOUND;
-	} else {
-		// Creating an empty page in memory.
-		SM_PageHandle emptyPage = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-		
-		// Writing empty page to file.
-		if(fwrite(emptyPage, sizeof(char), PAGE_SIZE,pageFile) < PAGE_SIZE)
-			printf("write failed \n");
-		else
-			printf("write succeeded \n");
-		
-		// Closing file stream so that all the buffers are flushed. 
-		fclose(pageFile);
-		
-		// De-allocating the memory previously allocated to 'emptyPage'.
-		// This is optional but always better to do for proper memory management.
-		free(emptyPage);
-		
-		return RC_OK;
-	}
+
+	// Creating an empty page in memory.
+	SM_PageHandle emptyPage = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
+
+	// Writing empty page to file.
+	ssize_t written = pwrite(fd, emptyPage, PAGE_SIZE, 0);
+
+	// De-allocating the memory previously allocated to 'emptyPage' and closing the file.
+	free(emptyPage);
+	close(fd);
+
+	if(written < PAGE_SIZE)
+		return RC_WRITE_FAILED;
+	return RC_OK;
 }
 
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
-	// Opening file stream in read mode. 'r' mode creates an empty file for reading only.
-	pageFile = fopen(fileName, "r");
+	// Opening file in read & write mode. The descriptor stays open until closePageFile(...) is called.
+	int fd = open(fileName, O_RDWR);
 
 	// Checking if file was successfully opened.
-	if(pageFile == NULL) {
+	if(fd < 0)
 		return RC_FILE_NOT_FOUND;
-	} else { 
-		// Updating file handle's filename and set the current position to the start of the page.
-		fHandle->fileName = fileName;
-		fHandle->curPagePos = 0;
-
-		/* In order to calculate the total size, we perform following steps -
-		   1. Move the position of the file stream to the end of file
-		   2. Check the file end position
-		   3. Move the position of the file stream to the beginning of file  
-		
-		fseek(pageFile, 0L, SEEK_END);
-		int totalSize = ftell(pageFile);
-		fseek(pageFile, 0L, SEEK_SET);
-		fHandle->totalNumPages = totalSize/ PAGE_SIZE;  */
-		
-		/* Using fstat() to get the file total size.
-		   fstat() is a system call that is used to determine information about a file based on its file descriptor.
-		   'st_size' member variable of the 'stat' structure gives the total size of the file in bytes.
-		*/
-
-		struct stat fileInfo;
-		if(fstat(fileno(pageFile), &fileInfo) < 0)    
-			return RC_ERROR;
-		fHandle->totalNumPages = fileInfo.st_size/ PAGE_SIZE;
-
-		// Closing file stream so that all the buffers are flushed. 
-		fclose(pageFile);
-		return RC_OK;
+
+	/* Using fstat() to get the file total size.
+	   fstat() is a system call that is used to determine information about a file based on its file descriptor.
+	   'st_size' member variable of the 'stat' structure gives the total size of the file in bytes.
+	*/
+	struct stat fileInfo;
+	if(fstat(fd, &fileInfo) < 0) {
+		close(fd);
+		return RC_ERROR;
 	}
+
+	FileManager *fileManager = (FileManager *) malloc(sizeof(FileManager));
+	fileManager->fd = fd;
+
+	// Updating file handle's filename and set the current position to the start of the page.
+	fHandle->fileName = fileName;
+	fHandle->curPagePos = 0;
+	fHandle->totalNumPages = fileInfo.st_size / PAGE_SIZE;
+	fHandle->mgmtInfo = fileManager;
+	return RC_OK;
 }
 
 extern RC closePageFile (SM_FileHandle *fHandle) {
-	// Checking if file pointer or the storage manager is intialised. If initialised, then close.
-	if(pageFile != NULL)
-		pageFile = NULL;	
-	return RC_OK; 
+	// Checking if the file handle is intialised. If initialised, then close the file descriptor.
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	close(fd);
+	free(fHandle->mgmtInfo);
+	fHandle->mgmtInfo = NULL;
+	return RC_OK;
 }
 
 
 extern RC destroyPageFile (char *fileName) {
-	// Opening file stream in read mode. 'r' mode creates an empty file for reading only.	
-	pageFile = fopen(fileName, "r");
-	
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND; 
-	
-	// Deleting the given filename so that it is no longer accessible.	
-	remove(fileName);
+	// Deleting the given filename so that it is no longer accessible.
+	if(remove(fileName) != 0)
+		return RC_FILE_NOT_FOUND;
 	return RC_OK;
 }
 
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+extern RC preadBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+
 	// Checking if the pageNumber parameter is less than Total number of pages and less than 0, then return respective error code
-	if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        	return RC_READ_NON_EXISTING_PAGE;
+	if (pageNum >= fHandle->totalNumPages || pageNum < 0)
+		return RC_READ_NON_EXISTING_PAGE;
 
-	// Opening file stream in read mode. 'r' mode opens file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
+	// Reading the block at position Page Number x Page Size into the location pointed out by memPage.
+	// The current page position is left alone, so several threads may read through the same handle.
+	if(pread(fd, memPage, PAGE_SIZE, (off_t) pageNum * PAGE_SIZE) < PAGE_SIZE)
+		return RC_ERROR;
+	return RC_OK;
+}
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	// Setting the cursor(pointer) position of the file stream. Position is calculated by Page Number x Page Size
-	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(pageFile, (pageNum * PAGE_SIZE), SEEK_SET);
-	if(isSeekSuccess == 0) {
-		// We're reading the content and storing it in the location pointed out by memPage.
-		if(fread(memPage, sizeof(char), PAGE_SIZE, pageFile) < PAGE_SIZE)
-			return RC_ERROR;
-	} else {
-		return RC_READ_NON_EXISTING_PAGE; 
-	}
-    	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
-	
-	// Closing file stream so that all the buffers are flushed.     	
-	fclose(pageFile);
-	
-    	return RC_OK;
+extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	RC result = preadBlock(pageNum, fHandle, memPage);
+
+	// Setting the current page position to the page which was just read
+	if(result == RC_OK)
+		fHandle->curPagePos = pageNum;
+	return result;
 }
 
 extern int getBlockPos (SM_FileHandle *fHandle) {
-	// Returning the current page position retrieved from the file handle	
+	// Returning the current page position retrieved from the file handle
 	return fHandle->curPagePos;
 }
 
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
-	
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-
-	int i;
-	for(i = 0; i < PAGE_SIZE; i++) {
-		// Reading a single character from the file
-		char c = fgetc(pageFile);
-	
-		// Checking if we have reached the end of file
-		if(feof(pageFile))
-			break;
-		else
-			memPage[i] = c;
-	}
-
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
-
-	// Closing file stream so that all the buffers are flushed.
-	fclose(pageFile);
-	return RC_OK;
+	// Re-directing (passing) to readBlock(...) function with pageNumber = 0 i.e. first block
+	return readBlock(0, fHandle, memPage);
 }
 
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	//printf("CURRENT PAGE POSITION = %d \n", fHandle->curPagePos);
-	//printf("TOTAL PAGES = %d \n", fHandle->totalNumPages)
-
-	// Checking if we are on the first block because there's no other previous block to read
-	if(fHandle->curPagePos <= PAGE_SIZE) {
-		printf("\n First block: Previous block not present.");
-		return RC_READ_NON_EXISTING_PAGE;	
-	} else {
-		// Calculating current page number by dividing page size by current page position	
-		int currentPageNumber = fHandle->curPagePos / PAGE_SIZE;
-		int startPosition = (PAGE_SIZE * (currentPageNumber - 2));
-
-		// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-		pageFile = fopen(fHandle->fileName, "r");
-		
-		// Checking if file was successfully opened.
-		if(pageFile == NULL)
-			return RC_FILE_NOT_FOUND;
-
-		// Initializing file pointer position.
-		fseek(pageFile, startPosition, SEEK_SET);
-		
-		int i;
-		// Reading block character by character and storing it in memPage
-		for(i = 0; i < PAGE_SIZE; i++) {
-			memPage[i] = fgetc(pageFile);
-		}
-
-		// Setting the current page position to the cursor(pointer) position of the file stream
-		fHandle->curPagePos = ftell(pageFile); 
-
-		// Closing file stream so that all the buffers are flushed.
-		fclose(pageFile);
-		return RC_OK;
-	}
+	// Re-directing (passing) to readBlock(...) function with the page before the current page.
+	// readBlock(...) returns RC_READ_NON_EXISTING_PAGE if we are on the first block.
+	return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
 }
 
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Calculating current page number by dividing page size by current page position	
-	int currentPageNumber = fHandle->curPagePos / PAGE_SIZE;
-	int startPosition = (PAGE_SIZE * (currentPageNumber - 2));
-	
-	// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
-
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-
-	// Initializing file pointer position.
-	fseek(pageFile, startPosition, SEEK_SET);
-	
-	int i;
-	// Reading block character by character and storing it in memPage.
-	// Also checking if we have reahed end of file.
-	for(i = 0; i < PAGE_SIZE; i++) {
-		char c = fgetc(pageFile);		
-		if(feof(pageFile))
-			break;
-		memPage[i] = c;
-	}
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
-
-	// Closing file stream so that all the buffers are flushed.
-	fclose(pageFile);
-	return RC_OK;		
+	// Re-directing (passing) to readBlock(...) function with the current page.
+	return readBlock(fHandle->curPagePos, fHandle, memPage);
 }
 
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage){
-	// Checking if we are on the last block because there's no next block to read
-	if(fHandle->curPagePos == PAGE_SIZE) {
-		printf("\n Last block: Next block not present.");
-		return RC_READ_NON_EXISTING_PAGE;	
-	} else {
-		// Calculating current page number by dividing page size by current page position	
-		int currentPageNumber = fHandle->curPagePos / PAGE_SIZE;
-		int startPosition = (PAGE_SIZE * (currentPageNumber - 2));
-
-		// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-		pageFile = fopen(fHandle->fileName, "r");
-		
-		// Checking if file was successfully opened.
-		if(pageFile == NULL)
-			return RC_FILE_NOT_FOUND;
-		
-		// Initializing file pointer position.
-		fseek(pageFile, startPosition, SEEK_SET);
-		
-		int i;
-		// Reading block character by character and storing it in memPage.
-		// Also checking if we have reahed end of file.
-		for(i = 0; i < PAGE_SIZE; i++) {
-			char c = fgetc(pageFile);		
-			if(feof(pageFile))
-				break;
-			memPage[i] = c;
-		}
-
-		// Setting the current page position to the cursor(pointer) position of the file stream
-		fHandle->curPagePos = ftell(pageFile); 
-
-		// Closing file stream so that all the buffers are flushed.
-		fclose(pageFile);
-		return RC_OK;
-	}
+	// Re-directing (passing) to readBlock(...) function with the page after the current page.
+	// readBlock(...) returns RC_READ_NON_EXISTING_PAGE if we are on the last block.
+	return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
 }
 
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage){
-	// Opening file stream in read mode. 'r' mode opens the file for reading only.	
-	pageFile = fopen(fHandle->fileName, "r");
+	// Re-directing (passing) to readBlock(...) function with the last page of the file.
+	return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+}
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	int startPosition = (fHandle->totalNumPages - 1) * PAGE_SIZE;
+extern RC preadBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	// Checking that the whole run of pages exists, as in readBlock(...)
+	if (pageNum < 0 || numPages < 1 || numPages > sysconf(_SC_IOV_MAX) || pageNum + numPages > fHandle->totalNumPages)
+		return RC_READ_NON_EXISTING_PAGE;
 
-	// Initializing file pointer position.
-	fseek(pageFile, startPosition, SEEK_SET);
-	
+	// Reading the run of consecutive pages pageNum ... pageNum + numPages - 1 with one vectored system call.
+	// Page pageNum + i is read into memPages[i], so the pages need not be adjacent in memory.
+	struct iovec blocks[numPages];
 	int i;
-	// Reading block character by character and storing it in memPage.
-	// Also checking if we have reahed end of file.
-	for(i = 0; i < PAGE_SIZE; i++) {
-		char c = fgetc(pageFile);		
-		if(feof(pageFile))
-			break;
-		memPage[i] = c;
+	for(i = 0; i < numPages; i++) {
+		blocks[i].iov_base = memPages[i];
+		blocks[i].iov_len = PAGE_SIZE;
 	}
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile); 
+	if(preadv(fd, blocks, numPages, (off_t) pageNum * PAGE_SIZE) < (ssize_t) numPages * PAGE_SIZE)
+		return RC_ERROR;
+	return RC_OK;
+}
+
+extern RC readBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	RC result = preadBlocks(pageNum, numPages, fHandle, memPages);
 
-	// Closing file stream so that all the buffers are flushed.
-	fclose(pageFile);
-	return RC_OK;	
+	// Setting the current page position to the last page which was just read
+	if(result == RC_OK)
+		fHandle->curPagePos = pageNum + numPages - 1;
+	return result;
 }
 
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+extern RC prefetchBlocks (int pageNum, int numPages, SM_FileHandle *fHandle) {
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+
+	if (pageNum < 0 || numPages < 1)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	// Asking the operating system to start reading the pages into its cache without waiting for them.
+	// Several such requests are served by the disk at the same time. It is only a hint, so a failure is not an error.
+	posix_fadvise(fd, (off_t) pageNum * PAGE_SIZE, (off_t) numPages * PAGE_SIZE, POSIX_FADV_WILLNEED);
+	return RC_OK;
+}
+
+extern RC pwriteBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+
 	// Checking if the pageNumber parameter is less than Total number of pages and less than 0, then return respective error code
+	// Writing page number totalNumPages is allowed and appends a new block to the file.
 	if (pageNum > fHandle->totalNumPages || pageNum < 0)
-        	return RC_WRITE_FAILED;
-	
-	// Opening file stream in read & write mode. 'r+' mode opens the file for both reading and writing.	
-	pageFile = fopen(fHandle->fileName, "r+");
-	
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
+		return RC_WRITE_FAILED;
 
-	int startPosition = pageNum * PAGE_SIZE;
-
-	if(pageNum == 0) { 
-		//Writing data to non-first page
-		fseek(pageFile, startPosition, SEEK_SET);	
-		int i;
-		for(i = 0; i < PAGE_SIZE; i++) 
-		{
-			// Checking if it is end of file. If yes then append an enpty block.
-			if(feof(pageFile)) // check file is ending in between writing
-				 appendEmptyBlock(fHandle);
-			// Writing a character from memPage to page file			
-			fputc(memPage[i], pageFile);
-		}
-
-		// Setting the current page position to the cursor(pointer) position of the file stream
-		fHandle->curPagePos = ftell(pageFile); 
-
-		// Closing file stream so that all the buffers are flushed.
-		fclose(pageFile);	
-	} else {	
-		// Writing data to the first page.
-		fHandle->curPagePos = startPosition;
-		fclose(pageFile);
-		writeCurrentBlock(fHandle, memPage);
-	}
+	// Writing the whole block at position Page Number x Page Size.
+	if(pwrite(fd, memPage, PAGE_SIZE, (off_t) pageNum * PAGE_SIZE) < PAGE_SIZE)
+		return RC_WRITE_FAILED;
+
+	// Incrementing the total number of pages if the write appended a block.
+	// The current page position is left alone, as in preadBlock(...).
+	if(pageNum == fHandle->totalNumPages)
+		fHandle->totalNumPages++;
 	return RC_OK;
 }
 
-extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-	// Opening file stream in read & write mode. 'r+' mode opens the file for both reading and writing.	
-	pageFile = fopen(fHandle->fileName, "r+");
+extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	RC result = pwriteBlock(pageNum, fHandle, memPage);
 
-	// Checking if file was successfully opened.
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-	
-	// Appending an empty block to make some space for the new content.
-	appendEmptyBlock(fHandle);
-
-	// Initiliazing file pointer
-	fseek(pageFile, fHandle->curPagePos, SEEK_SET);
-	
-	// Writing memPage contents to the file.
-	fwrite(memPage, sizeof(char), strlen(memPage), pageFile);
-	
-	// Setting the current page position to the cursor(pointer) position of the file stream
-	fHandle->curPagePos = ftell(pageFile);
-
-	// Closing file stream so that all the buffers are flushed.     	
-	fclose(pageFile);
-	return RC_OK;
+	// Setting the current page position to the page which was just written
+	if(result == RC_OK)
+		fHandle->curPagePos = pageNum;
+	return result;
+}
+
+extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
+	// Re-directing (passing) to writeBlock(...) function with the current page.
+	return writeBlock(fHandle->curPagePos, fHandle, memPage);
 }
 
+extern RC pwriteBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
 
-extern RC appendEmptyBlock (SM_FileHandle *fHandle) {
-	// Creating an empty page of size PAGE_SIZE bytes
-	SM_PageHandle emptyBlock = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-	
-	// Moving the cursor (pointer) position to the begining of the file stream.
-	// And the seek is success if fseek() return 0
-	int isSeekSuccess = fseek(pageFile, 0, SEEK_END);
-	
-	if( isSeekSuccess == 0 ) {
-		// Writing an empty page to the file
-		fwrite(emptyBlock, sizeof(char), PAGE_SIZE, pageFile);
-	} else {
-		free(emptyBlock);
+	// Checking that the run of pages lies within the file (or appends right at its end), as in writeBlock(...)
+	if (pageNum < 0 || numPages < 1 || numPages > sysconf(_SC_IOV_MAX) || pageNum > fHandle->totalNumPages)
 		return RC_WRITE_FAILED;
+
+	// Writing the run of consecutive pages pageNum ... pageNum + numPages - 1 with one vectored system call.
+	// memPages[i] holds page pageNum + i, so the pages need not be adjacent in memory.
+	struct iovec blocks[numPages];
+	int i;
+	for(i = 0; i < numPages; i++) {
+		blocks[i].iov_base = memPages[i];
+		blocks[i].iov_len = PAGE_SIZE;
 	}
-	
-	// De-allocating the memory previously allocated to 'emptyPage'.
-	// This is optional but always better to do for proper memory management.
-	free(emptyBlock);
-	
-	// Incrementing the total number of pages since we added an empty black.
-	fHandle->totalNumPages++;
+	if(pwritev(fd, blocks, numPages, (off_t) pageNum * PAGE_SIZE) < (ssize_t) numPages * PAGE_SIZE)
+		return RC_WRITE_FAILED;
+
+	// Incrementing the total number of pages if the write appended blocks.
+	if(pageNum + numPages > fHandle->totalNumPages)
+		fHandle->totalNumPages = pageNum + numPages;
 	return RC_OK;
 }
 
+extern RC writeBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+	RC result = pwriteBlocks(pageNum, numPages, fHandle, memPages);
+
+	// Setting the current page position to the last page which was just written
+	if(result == RC_OK)
+		fHandle->curPagePos = pageNum + numPages - 1;
+	return result;
+}
+
+
+extern RC appendEmptyBlock (SM_FileHandle *fHandle) {
+	// Growing the file by exactly one empty block.
+	return ensureCapacity(fHandle->totalNumPages + 1, fHandle);
+}
+
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
-	// Opening file stream in append mode. 'a' mode opens the file to append the data at the end of file.
-	pageFile = fopen(fHandle->fileName, "a");
-	
-	if(pageFile == NULL)
-		return RC_FILE_NOT_FOUND;
-	
+	int fd = getFileDescriptor(fHandle);
+	if(fd < 0)
+		return RC_FILE_HANDLE_NOT_INIT;
+
 	// Checking if numberOfPages is greater than totalNumPages.
-	// If that is the case, then add empty pages till numberofPages = totalNumPages
-	while(numberOfPages > fHandle->totalNumPages)
-		appendEmptyBlock(fHandle);
-	
-	// Closing file stream so that all the buffers are flushed. 
-	fclose(pageFile);
+	if(numberOfPages <= fHandle->totalNumPages)
+		return RC_OK;
+
+	// Extending the file in one call. The new pages are zero filled by the file system.
+	if(ftruncate(fd, (off_t) numberOfPages * PAGE_SIZE) != 0)
+		return RC_WRITE_FAILED;
+
+	fHandle->totalNumPages = numberOfPages;
 	return RC_OK;
 }
@@ -33,10 +33,20 @@ extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC prefetchBlocks (int pageNum, int numPages, SM_FileHandle *fHandle);
+
+/* positioned reads and writes: like readBlock(s)/writeBlock(s) but they do not move curPagePos,
+   so that several threads can use one file handle (the buffer manager does) */
+extern RC preadBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC preadBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC pwriteBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC pwriteBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int pageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
 
@@ -1,8 +1,13 @@
 #include <stdlib.h>
+#include <pthread.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
 
 #include "dberror.h"
 #include "expr.h"
 #include "btree_mgr.h"
+#include "btree_implement.h"
 #include "tables.h"
 #include "test_helper.h"
 
@@ -15,6 +20,11 @@
 static void testInsertAndFind (void);
 static void testDelete (void);
 static void testIndexScan (void);
+static void testBulkLoad (void);
+static void testRangeScan (void);
+static void testFindKeys (void);
+static void testConcurrentInsert (void);
+static void testKeySearch (void);
 
 // helper methods
 static Value **createValues (char **stringVals, int size);
@@ -33,6 +43,11 @@ main (void)
   testInsertAndFind();
   testDelete();
   testIndexScan();
+  testBulkLoad();
+  testRangeScan();
+  testFindKeys();
+  testConcurrentInsert();
+  testKeySearch();
 
   return 0;
 }
@@ -265,6 +280,317 @@ testIndexScan (void)
   TEST_DONE();
 }
 
+// ************************************************************ 
+void
+testBulkLoad (void)
+{
+  int numKeys = 500;
+  float fillFactors[] = { 1.0, 0.5 };
+  Value **keys;
+  char **stringKeys;
+  RID *rids;
+  int *permute;
+  
+  testName = "bulk loading unsorted keys, search, scan and insert";
+  int i, k, testint, iter, rc;
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  RID rid;
+
+  // keys i0, i2, ... i998 in random order, RID (i, i)
+  permute = createPermutation(numKeys);
+  stringKeys = (char **) malloc(sizeof(char *) * numKeys);
+  rids = (RID *) malloc(sizeof(RID) * numKeys);
+  for(i = 0; i < numKeys; i++)
+    {
+      stringKeys[i] = (char *) malloc(10);
+      sprintf(stringKeys[i], "i%d", permute[i] * 2);
+      rids[i].page = permute[i];
+      rids[i].slot = permute[i];
+    }
+  keys = createValues(stringKeys, numKeys);
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+
+  for(iter = 0; iter < 2; iter++)
+    {
+      // create B-tree and load all keys at once
+      TEST_CHECK(createBtree("testidx", DT_INT, 2));
+      TEST_CHECK(openBtree(&tree, "testidx"));
+      TEST_CHECK(bulkLoadBtree(tree, keys, rids, numKeys, fillFactors[iter]));
+
+      // check index stats
+      TEST_CHECK(getNumEntries(tree, &testint));
+      ASSERT_EQUALS_INT(numKeys, testint, "number of entries in btree");
+      rc = bulkLoadBtree(tree, keys, rids, numKeys, fillFactors[iter]);
+      ASSERT_EQUALS_INT(RC_IM_TREE_NOT_EMPTY, rc, "can only bulk load an empty btree");
+
+      // search for keys
+      for(i = 0; i < 1000; i++)
+	{
+	  int pos = rand() % numKeys;
+
+	  TEST_CHECK(findKey(tree, keys[pos], &rid));
+	  ASSERT_EQUALS_RID(rids[pos], rid, "did we find the correct RID?");
+	}
+
+      // insert keys between the loaded ones, then scan. We should see tuples in sort order.
+      for(i = 0; i < numKeys; i += 5)
+	{
+	  Value key;
+	  RID newRid = { i, numKeys };
+
+	  key.dt = DT_INT;
+	  key.v.intV = i * 2 + 1;
+	  TEST_CHECK(insertKey(tree, &key, newRid));
+	}
+      // key 2 * p has RID (p, p), key 2 * p + 1 has RID (p, numKeys) and exists for every fifth p
+      TEST_CHECK(openTreeScan(tree, &sc));
+      i = 0;
+      k = 0;
+      while((rc = nextEntry(sc, &rid)) == RC_OK)
+	{
+	  ASSERT_TRUE(rid.page == k / 2 && rid.slot == (k % 2 == 0 ? k / 2 : numKeys), "did we find the correct RID?");
+	  k += (k % 2 == 0 && (k / 2) % 5 != 0) ? 2 : 1;
+	  i++;
+	}
+      ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "no error returned by scan");
+      ASSERT_EQUALS_INT(numKeys + numKeys / 5, i, "have seen all entries");
+      TEST_CHECK(closeTreeScan(sc));
+
+      // cleanup
+      TEST_CHECK(closeBtree(tree));
+      TEST_CHECK(deleteBtree("testidx"));
+    }
+
+  TEST_CHECK(shutdownIndexManager());
+  freeValues(keys, numKeys);
+  for(i = 0; i < numKeys; i++)
+    free(stringKeys[i]);
+  free(stringKeys);
+  free(rids);
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************ 
+void
+testRangeScan (void)
+{
+  int numInserts = 200;
+  Value low, high;
+  RID rid;
+  struct {
+    int low, lowInclusive, high, highInclusive, reverse, first, last;
+  } ranges[] = {
+    { 50, TRUE, 150, FALSE, FALSE, 50, 149 },
+    { 50, FALSE, 150, TRUE, FALSE, 51, 150 },
+    { 50, TRUE, 150, TRUE, TRUE, 150, 50 },
+    { 50, FALSE, 150, FALSE, TRUE, 149, 51 },
+    { -1, FALSE, 20, FALSE, FALSE, 0, 19 },
+    { 180, TRUE, -1, FALSE, TRUE, 199, 180 },
+    { -1, FALSE, -1, FALSE, TRUE, 199, 0 },
+    { 77, TRUE, 77, TRUE, FALSE, 77, 77 },
+  };
+  int numRanges = 8;
+
+  testName = "range scans with inclusive and exclusive bounds, forward and reverse";
+  int i, r, expected, rc;
+  int *permute;
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createBtree("testidx", DT_INT, 2));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  // insert keys 0 ... 199 with RID (key, 0) in random order
+  permute = createPermutation(numInserts);
+  for(i = 0; i < numInserts; i++)
+    {
+      RID insert = { permute[i], 0 };
+
+      low.dt = DT_INT;
+      low.v.intV = permute[i];
+      TEST_CHECK(insertKey(tree, &low, insert));
+    }
+
+  // every scan returns the keys from "first" to "last" (-1 means no bound)
+  for(r = 0; r < numRanges; r++)
+    {
+      low.dt = high.dt = DT_INT;
+      low.v.intV = ranges[r].low;
+      high.v.intV = ranges[r].high;
+      TEST_CHECK(openTreeRangeScan(tree, ranges[r].low < 0 ? NULL : &low, ranges[r].lowInclusive,
+				   ranges[r].high < 0 ? NULL : &high, ranges[r].highInclusive, ranges[r].reverse, &sc));
+      expected = ranges[r].first;
+      while((rc = nextEntry(sc, &rid)) == RC_OK)
+	{
+	  ASSERT_EQUALS_INT(expected, rid.page, "range scan returns the keys in order");
+	  expected += ranges[r].reverse ? -1 : 1;
+	}
+      ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "no error returned by scan");
+      ASSERT_EQUALS_INT(ranges[r].last + (ranges[r].reverse ? -1 : 1), expected, "have seen all entries of the range");
+      TEST_CHECK(closeTreeScan(sc));
+    }
+
+  // cleanup
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  TEST_CHECK(shutdownIndexManager());
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************ 
+void
+testFindKeys (void)
+{
+  int numInserts = 300;
+  int numProbes = 1000;
+  Value *probes;
+  RID *results;
+  RC *status;
+
+  testName = "batched search of present and missing keys in random order";
+  int i, key;
+  BTreeHandle *tree = NULL;
+  RID rid;
+
+  probes = (Value *) malloc(sizeof(Value) * numProbes);
+  results = (RID *) malloc(sizeof(RID) * numProbes);
+  status = (RC *) malloc(sizeof(RC) * numProbes);
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createBtree("testidx", DT_INT, 2));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  // insert the even keys 0 ... 598 with RID (key, 1)
+  for(i = 0; i < numInserts; i++)
+    {
+      RID insert = { i * 2, 1 };
+
+      probes[0].dt = DT_INT;
+      probes[0].v.intV = i * 2;
+      TEST_CHECK(insertKey(tree, &probes[0], insert));
+    }
+
+  // probe random keys, some of them more than once, half of them missing
+  for(i = 0; i < numProbes; i++)
+    {
+      probes[i].dt = DT_INT;
+      probes[i].v.intV = rand() % (numInserts * 2 + 10) - 5;
+    }
+  TEST_CHECK(findKeys(tree, probes, numProbes, results, status));
+
+  // every result is the same as that of findKey
+  for(i = 0; i < numProbes; i++)
+    {
+      key = probes[i].v.intV;
+      if (key >= 0 && key < numInserts * 2 && key % 2 == 0)
+	{
+	  TEST_CHECK(status[i]);
+	  TEST_CHECK(findKey(tree, &probes[i], &rid));
+	  ASSERT_EQUALS_RID(rid, results[i], "did we find the correct RID?");
+	}
+      else
+	{
+	  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, status[i], "missing key is not found");
+	}
+    }
+
+  // cleanup
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  TEST_CHECK(shutdownIndexManager());
+  free(probes);
+  free(results);
+  free(status);
+
+  TEST_DONE();
+}
+
+// ************************************************************ 
+void
+testKeySearch (void)
+{
+  KeySearch methods[] = { KEY_SEARCH_LINEAR, KEY_SEARCH_BINARY, KEY_SEARCH_SSE2, KEY_SEARCH_AVX2 };
+  char *methodNames[] = { "linear", "binary", "sse2", "avx2" };
+  int intValues[] = { INT_MIN, INT_MIN + 1, -3, -1, 0, 0, 2, 5, INT_MAX - 1, INT_MAX };
+  float floatValues[] = { -FLT_MAX, (float) INT_MIN, -2.5f, -0.0f, 0.0f, 1.0f, 1.0f, 3.5f, (float) INT_MAX, FLT_MAX };
+  int intProbes[] = { INT_MIN, INT_MIN + 1, -4, -3, -2, -1, 0, 1, 2, 5, 6, INT_MAX - 1, INT_MAX };
+  float floatProbes[] = { -INFINITY, -FLT_MAX, (float) INT_MIN, -2.5f, -1.0f, -0.0f, 0.0f, 0.5f, 1.0f, 3.5f, (float) INT_MAX, FLT_MAX, INFINITY };
+  int numValues = 10;
+  int numProbes = 13;
+  int maxIntKeys = getMaxKeys(DT_INT);
+  int maxFloatKeys = getMaxKeys(DT_FLOAT);
+  int *intKeys = (int *) malloc(sizeof(int) * maxIntKeys);
+  float *floatKeys = (float *) malloc(sizeof(float) * maxFloatKeys);
+  int m, numKeys, i, j, upper, expected, numWrong;
+  char message[100];
+
+  testName = "key search methods agree with linear counting for all array lengths";
+
+  for(m = 0; m < 4; m++)
+    {
+      // methods the CPU does not support are refused and skipped
+      if (setKeySearch(methods[m]) != RC_OK)
+	{
+	  printf("[%s-%s-L%i-%s] OK: key search %s is not supported by this CPU\n", TEST_INFO, methodNames[m]);
+	  continue;
+	}
+
+      numWrong = 0;
+      for(numKeys = 0; numKeys <= maxIntKeys; numKeys++)
+	{
+	  // sorted keys with duplicates, running from INT_MIN up to INT_MAX once there are enough of them
+	  for(i = 0; i < numKeys; i++)
+	    intKeys[i] = intValues[(long) i * numValues / (numKeys + 1)];
+	  for(j = 0; j < numProbes; j++)
+	    for(upper = 0; upper < 2; upper++)
+	      {
+		for(i = 0, expected = 0; i < numKeys; i++)
+		  if (intKeys[i] < intProbes[j] || (upper && intKeys[i] == intProbes[j]))
+		    expected++;
+		if (searchIntKeys(intKeys, numKeys, intProbes[j], upper) != expected)
+		  numWrong++;
+	      }
+	}
+      sprintf(message, "%s search of int keys finds the lower and upper bounds", methodNames[m]);
+      ASSERT_EQUALS_INT(0, numWrong, message);
+
+      numWrong = 0;
+      for(numKeys = 0; numKeys <= maxFloatKeys; numKeys++)
+	{
+	  for(i = 0; i < numKeys; i++)
+	    floatKeys[i] = floatValues[(long) i * numValues / (numKeys + 1)];
+	  for(j = 0; j < numProbes; j++)
+	    for(upper = 0; upper < 2; upper++)
+	      {
+		for(i = 0, expected = 0; i < numKeys; i++)
+		  if (floatKeys[i] < floatProbes[j] || (upper && floatKeys[i] == floatProbes[j]))
+		    expected++;
+		if (searchFloatKeys(floatKeys, numKeys, floatProbes[j], upper) != expected)
+		  numWrong++;
+	      }
+	}
+      sprintf(message, "%s search of float keys finds the lower and upper bounds", methodNames[m]);
+      ASSERT_EQUALS_INT(0, numWrong, message);
+    }
+
+  // back to the fastest search for the other tests
+  selectKeySearch();
+  free(intKeys);
+  free(floatKeys);
+
+  TEST_DONE();
+}
+
 // ************************************************************ 
 int *
 createPermutation (int size)
@@ -287,6 +613,93 @@ createPermutation (int size)
   return result;
 }
 
+// ************************************************************ 
+#define NUM_THREADS 4
+#define KEYS_PER_THREAD 500
+
+typedef struct InsertThread {
+  BTreeHandle *tree;
+  int thread;
+  RC result;
+} InsertThread;
+
+// inserts the keys thread, thread + NUM_THREADS, ... and looks each one up right after inserting it
+static void *
+insertKeys (void *arg)
+{
+  InsertThread *work = (InsertThread *) arg;
+  Value key;
+  RID insert, found;
+  int i;
+
+  key.dt = DT_INT;
+  work->result = RC_OK;
+  for(i = 0; i < KEYS_PER_THREAD && work->result == RC_OK; i++)
+    {
+      key.v.intV = i * NUM_THREADS + work->thread;
+      insert.page = key.v.intV;
+      insert.slot = work->thread;
+      if ((work->result = insertKey(work->tree, &key, insert)) == RC_OK
+	  && (work->result = findKey(work->tree, &key, &found)) == RC_OK
+	  && (found.page != insert.page || found.slot != insert.slot))
+	work->result = RC_IM_KEY_NOT_FOUND;
+    }
+  return NULL;
+}
+
+// ************************************************************ 
+void
+testConcurrentInsert (void)
+{
+  InsertThread work[NUM_THREADS];
+  pthread_t threads[NUM_THREADS];
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  int i, n, rc;
+  RID rid;
+
+  testName = "concurrent inserts and lookups of several threads";
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createBtree("testidx", DT_INT, 3));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  // every thread inserts its own keys, which end up in the same leaves as those of the other threads
+  for(i = 0; i < NUM_THREADS; i++)
+    {
+      work[i].tree = tree;
+      work[i].thread = i;
+      rc = pthread_create(&threads[i], NULL, insertKeys, &work[i]);
+      ASSERT_EQUALS_INT(0, rc, "thread started");
+    }
+  for(i = 0; i < NUM_THREADS; i++)
+    {
+      pthread_join(threads[i], NULL);
+      TEST_CHECK(work[i].result);
+    }
+
+  // all keys are there, once and in order
+  TEST_CHECK(getNumEntries(tree, &n));
+  ASSERT_EQUALS_INT(NUM_THREADS * KEYS_PER_THREAD, n, "number of entries in the tree");
+  TEST_CHECK(openTreeScan(tree, &sc));
+  for(i = 0; (rc = nextEntry(sc, &rid)) == RC_OK; i++)
+    {
+      ASSERT_EQUALS_INT(i, rid.page, "scan returns the keys in order");
+      ASSERT_EQUALS_INT(i % NUM_THREADS, rid.slot, "key has the RID of its thread");
+    }
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "no error returned by scan");
+  ASSERT_EQUALS_INT(NUM_THREADS * KEYS_PER_THREAD, i, "have seen all entries");
+  TEST_CHECK(closeTreeScan(sc));
+
+  // cleanup
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  TEST_CHECK(shutdownIndexManager());
+
+  TEST_DONE();
+}
+
 // ************************************************************ 
 Value **
 createValues (char **stringVals, int size)
@@ -3,6 +3,8 @@
 #include "dberror.h"
 #include "expr.h"
 #include "btree_mgr.h"
+#include "record_mgr.h"
+#include "storage_mgr.h"
 #include "tables.h"
 #include "test_helper.h"
 
@@ -16,7 +18,21 @@ static void testInsertAndFind (void);
 static void testDelete (void);
 static void testIndexScan (void);
 
+static void testDuplicateKeys (void);
+static void testCompositeKeys (void);
+static void testOpenIndexes (void);
+static void testStringPrefixCompression (void);
+static void testFreeSpaceMap (void);
+static void testSlotBitmap (void);
+static void testVariableLengthRecords (void);
+static void testOverflowPages (void);
+static void testTableHeader (void);
+
 // helper methods
+static Schema *createRecordSchema (int stringLength);
+static void setRecordValues (Record *record, Schema *schema, int a, char *b);
+static bool hasRecordValues (Record *record, Schema *schema, int a, char *b);
+static int getNumFilePages (char *name);
 static Value **createValues (char **stringVals, int size);
 static void freeValues (Value **vals, int size);
 static int *createPermutation (int size);
@@ -34,6 +50,15 @@ main (void)
   testDelete_Float();
   testInsertAndFind_String();
   testDelete_Float();
+  testDuplicateKeys();
+  testCompositeKeys();
+  testOpenIndexes();
+  testStringPrefixCompression();
+  testFreeSpaceMap();
+  testSlotBitmap();
+  testVariableLengthRecords();
+  testOverflowPages();
+  testTableHeader();
 
   return 0;
 }
@@ -341,6 +366,852 @@ testDelete_String (void)
   TEST_DONE();
 }
 
+// ************************************************************
+void
+testDuplicateKeys (void)
+{
+  int numKeys = 7;
+  int ridsPerKey = 3000;
+  RID *results = (RID *) malloc(ridsPerKey * sizeof(RID));
+  DataType keyType = DT_INT;
+  testName = "test non-unique b-tree with posting lists";
+  int i, k, num, testint, rc;
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  Value key;
+  RID rid;
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createCompositeBtree("testidx", &keyType, 1, 2, FALSE));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  // key k gets the RIDs (i, k) for i = 0 ... ridsPerKey - 1, inserted from the last to the first,
+  // so that the RIDs of a key are inserted in the middle of their posting list as well
+  key.dt = DT_INT;
+  for(i = ridsPerKey - 1; i >= 0; i--)
+    for(k = 0; k < numKeys; k++)
+      {
+	RID r = { i, k };
+	key.v.intV = k;
+	TEST_CHECK(insertKey(tree, &key, r));
+      }
+  key.v.intV = 3;
+  rid.page = 10;
+  rid.slot = 3;
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, &key, rid), "the same RID cannot be inserted twice for a key");
+
+  // check index stats: the RIDs are stored in posting lists, so there are only a few nodes
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT(numKeys * ridsPerKey, testint, "number of entries in btree");
+  TEST_CHECK(getNumNodes(tree, &testint));
+  ASSERT_TRUE(testint <= 5, "few nodes for few distinct keys");
+
+  // close and reopen, then find all RIDs of a key in RID order
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+  for(k = 0; k < numKeys; k++)
+    {
+      key.v.intV = k;
+      TEST_CHECK(findKeyEntries(tree, &key, results, ridsPerKey, &num));
+      ASSERT_EQUALS_INT(ridsPerKey, num, "all RIDs of the key");
+      for(i = 0; i < ridsPerKey; i++)
+	if (results[i].page != i || results[i].slot != k)
+	  break;
+      ASSERT_EQUALS_INT(ridsPerKey, i, "RIDs of the key in RID order");
+      TEST_CHECK(findKey(tree, &key, &rid));
+      ASSERT_TRUE(rid.page == 0 && rid.slot == k, "findKey returns the first RID");
+    }
+
+  // delete every other RID of key 2, and key 4 with all of its RIDs
+  key.v.intV = 2;
+  for(i = 0; i < ridsPerKey; i += 2)
+    {
+      RID r = { i, 2 };
+      TEST_CHECK(deleteKeyEntry(tree, &key, r));
+    }
+  rid.page = 0;
+  rid.slot = 2;
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteKeyEntry(tree, &key, rid), "deleted RID is gone");
+  key.v.intV = 4;
+  TEST_CHECK(deleteKey(tree, &key));
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKeyEntries(tree, &key, results, ridsPerKey, &num), "deleted key is gone");
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT((numKeys - 1) * ridsPerKey - ridsPerKey / 2, testint, "number of entries in btree");
+
+  // a scan of key 2 returns its remaining RIDs, the odd pages, in reverse order
+  key.v.intV = 2;
+  TEST_CHECK(openTreeRangeScan(tree, &key, TRUE, &key, TRUE, TRUE, &sc));
+  i = ridsPerKey - 1;
+  while((rc = nextEntry(sc, &rid)) == RC_OK)
+    {
+      if (rid.page != i || rid.slot != 2)
+	break;
+      i -= 2;
+    }
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan returns the remaining RIDs of the key");
+  ASSERT_EQUALS_INT(-1, i, "have seen all RIDs of the key");
+  TEST_CHECK(closeTreeScan(sc));
+
+  // cleanup
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  TEST_CHECK(shutdownIndexManager());
+  free(results);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testCompositeKeys (void)
+{
+  char *names[] = { "a", "b", "c" };
+  DataType dataTypes[] = { DT_STRING, DT_INT, DT_FLOAT };
+  int typeLength[] = { 8, 0, 0 };
+  int keyAttrs[] = { 0, 1 };
+  char *cities[] = { "berlin", "berlin2", "boston", "chicago" };
+  int numCities = 4;
+  int numYears = 50;
+  Schema *schema;
+  DataType keyTypes[2];
+  Value key[2];
+  testName = "test b-tree with composite keys";
+  int c, y, testint, rc;
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  RID rid;
+
+  // index on the key attributes (a, b) of the schema
+  schema = createSchema(3, names, dataTypes, typeLength, 2, keyAttrs);
+  keyTypes[0] = schema->dataTypes[schema->keyAttrs[0]];
+  keyTypes[1] = schema->dataTypes[schema->keyAttrs[1]];
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+  TEST_CHECK(createCompositeBtree("testidx", keyTypes, 2, 3, TRUE));
+  TEST_CHECK(openBtree(&tree, "testidx"));
+
+  // insert (city c, year y) with RID (c, y), years from -25 to 24 in random order
+  for(y = 0; y < numYears; y++)
+    for(c = 0; c < numCities; c++)
+      {
+	RID r = { c, (y * 17) % numYears };
+	key[0].dt = DT_STRING;
+	key[0].v.stringV = cities[c];
+	key[1].dt = DT_INT;
+	key[1].v.intV = r.slot - numYears / 2;
+	TEST_CHECK(insertKey(tree, key, r));
+      }
+  key[0].v.stringV = "boston";
+  key[1].v.intV = 3;
+  rid.page = 9;
+  rid.slot = 9;
+  ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, key, rid), "unique index rejects an existing key");
+  TEST_CHECK(findKey(tree, key, &rid));
+  ASSERT_TRUE(rid.page == 2 && rid.slot == 3 + numYears / 2, "did we find the correct RID?");
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT(numCities * numYears, testint, "number of entries in btree");
+
+  // a scan returns the keys ordered by city, then by year
+  TEST_CHECK(openTreeScan(tree, &sc));
+  c = 0;
+  y = 0;
+  while((rc = nextEntry(sc, &rid)) == RC_OK)
+    {
+      if (rid.page != c || rid.slot != y)
+	break;
+      if (++y == numYears)
+	{
+	  y = 0;
+	  c++;
+	}
+    }
+  ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan returns the keys in lexicographic order");
+  ASSERT_EQUALS_INT(numCities, c, "have seen all entries");
+  TEST_CHECK(closeTreeScan(sc));
+
+  // cleanup
+  TEST_CHECK(closeBtree(tree));
+  TEST_CHECK(deleteBtree("testidx"));
+  TEST_CHECK(shutdownIndexManager());
+  freeSchema(schema);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testOpenIndexes (void)
+{
+  char *names[] = { "idxA", "idxB", "idxC" };
+  DataType keyTypes[] = { DT_INT, DT_FLOAT, DT_STRING };
+  char *strings[] = { "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9" };
+  int numIndexes = 3;
+  int numInserts = 300;
+  testName = "test several open indexes at the same time";
+  int i, t, testint;
+  BTreeHandle *trees[3];
+  BTreeHandle *second = NULL;
+  Value key;
+  RID rid;
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+  for(t = 0; t < numIndexes; t++)
+    {
+      TEST_CHECK(createBtree(names[t], keyTypes[t], 3));
+      TEST_CHECK(openBtree(&trees[t], names[t]));
+    }
+
+  // insert into all indexes in turn; index t gets RIDs (i, t)
+  for(i = 0; i < numInserts; i++)
+    for(t = 0; t < numIndexes; t++)
+      {
+	RID r = { i, t };
+	key.dt = keyTypes[t];
+	if (t == 0)
+	  key.v.intV = i;
+	else if (t == 1)
+	  key.v.floatV = i / 2.0f;
+	else
+	  key.v.stringV = strings[i % 10];
+	if (t < 2 || i < 10)
+	  TEST_CHECK(insertKey(trees[t], &key, r));
+      }
+
+  // every index has only its own entries
+  for(t = 0; t < numIndexes; t++)
+    {
+      TEST_CHECK(getNumEntries(trees[t], &testint));
+      ASSERT_EQUALS_INT(t < 2 ? numInserts : 10, testint, "number of entries in btree");
+    }
+  key.dt = DT_FLOAT;
+  key.v.floatV = 7.5f;
+  TEST_CHECK(findKey(trees[1], &key, &rid));
+  ASSERT_TRUE(rid.page == 15 && rid.slot == 1, "did we find the correct RID?");
+
+  // a second handle of an open index shares its nodes
+  TEST_CHECK(openBtree(&second, names[0]));
+  key.dt = DT_INT;
+  key.v.intV = numInserts;
+  rid.page = numInserts;
+  rid.slot = 0;
+  TEST_CHECK(insertKey(second, &key, rid));
+  TEST_CHECK(findKey(trees[0], &key, &rid));
+  ASSERT_TRUE(rid.page == numInserts && rid.slot == 0, "insert through one handle is seen through the other");
+  TEST_CHECK(closeBtree(second));
+  key.v.intV = 17;
+  TEST_CHECK(findKey(trees[0], &key, &rid));
+  ASSERT_TRUE(rid.page == 17 && rid.slot == 0, "index stays open until its last handle is closed");
+
+  // an open index cannot be created again or deleted, and the index manager cannot be shut down
+  ASSERT_EQUALS_INT(RC_IM_INDEX_OPEN, createBtree(names[2], DT_INT, 3), "open index cannot be created again");
+  ASSERT_EQUALS_INT(RC_IM_INDEX_OPEN, deleteBtree(names[2]), "open index cannot be deleted");
+  ASSERT_EQUALS_INT(RC_IM_INDEX_OPEN, shutdownIndexManager(), "indexes are still open");
+
+  // close all indexes, then reopen one of them
+  for(t = 0; t < numIndexes; t++)
+    TEST_CHECK(closeBtree(trees[t]));
+  TEST_CHECK(openBtree(&trees[0], names[0]));
+  TEST_CHECK(getNumEntries(trees[0], &testint));
+  ASSERT_EQUALS_INT(numInserts + 1, testint, "number of entries after reopening");
+  TEST_CHECK(closeBtree(trees[0]));
+
+  // cleanup
+  for(t = 0; t < numIndexes; t++)
+    TEST_CHECK(deleteBtree(names[t]));
+  TEST_CHECK(shutdownIndexManager());
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringPrefixCompression (void)
+{
+  char *names[] = { "idxShort", "idxLong" };
+  int orders[] = { 50, 120 };
+  int numInserts = 2000;
+  testName = "test b-tree with prefix compressed string keys";
+  int i, t, testint;
+  int numNodes[2];
+  int *permute;
+  BTreeHandle *tree = NULL;
+  BT_ScanHandle *sc = NULL;
+  char buffer[64];
+  Value key;
+  RID rid;
+
+  key.dt = DT_STRING;
+  key.v.stringV = buffer;
+  permute = createPermutation(numInserts);
+
+  // init
+  TEST_CHECK(initIndexManager(NULL));
+
+  // URL-like keys share a long prefix; with a higher order the same keys need fewer nodes
+  for(t = 0; t < 2; t++)
+    {
+      TEST_CHECK(createBtree(names[t], DT_STRING, orders[t]));
+      TEST_CHECK(openBtree(&tree, names[t]));
+      for(i = 0; i < numInserts; i++)
+	{
+	  RID r = { permute[i], 1 };
+	  sprintf(buffer, "https://www.example.com/users/%06d/profile", permute[i]);
+	  TEST_CHECK(insertKey(tree, &key, r));
+	}
+      TEST_CHECK(getNumNodes(tree, &numNodes[t]));
+      TEST_CHECK(closeBtree(tree));
+    }
+  ASSERT_TRUE(numNodes[1] < numNodes[0], "common prefixes leave room for more keys per node");
+
+  // search for keys
+  TEST_CHECK(openBtree(&tree, names[1]));
+  for(i = 0; i < numInserts; i++)
+    {
+      sprintf(buffer, "https://www.example.com/users/%06d/profile", i);
+      TEST_CHECK(findKey(tree, &key, &rid));
+      ASSERT_TRUE(rid.page == i && rid.slot == 1, "did we find the correct RID?");
+    }
+  sprintf(buffer, "https://www.example.com/users/");
+  ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, &key, &rid), "common prefix alone is not a key");
+
+  // a scan returns the keys in order
+  TEST_CHECK(openTreeScan(tree, &sc));
+  for(i = 0; nextEntry(sc, &rid) == RC_OK; i++)
+    ASSERT_TRUE(rid.page == i, "scan returns keys in order");
+  ASSERT_EQUALS_INT(numInserts, i, "scan returns all keys");
+  TEST_CHECK(closeTreeScan(sc));
+
+  // delete every second key
+  for(i = 0; i < numInserts; i += 2)
+    {
+      sprintf(buffer, "https://www.example.com/users/%06d/profile", i);
+      TEST_CHECK(deleteKey(tree, &key));
+    }
+  TEST_CHECK(getNumEntries(tree, &testint));
+  ASSERT_EQUALS_INT(numInserts / 2, testint, "number of entries after deleting");
+  for(i = 0; i < numInserts; i++)
+    {
+      sprintf(buffer, "https://www.example.com/users/%06d/profile", i);
+      ASSERT_EQUALS_INT(i % 2 ? RC_OK : RC_IM_KEY_NOT_FOUND, findKey(tree, &key, &rid), "deleted keys are gone");
+    }
+
+  // a key without the common prefix still fits
+  sprintf(buffer, "a");
+  rid.page = numInserts;
+  rid.slot = 1;
+  TEST_CHECK(insertKey(tree, &key, rid));
+  TEST_CHECK(openTreeScan(tree, &sc));
+  TEST_CHECK(nextEntry(sc, &rid));
+  ASSERT_TRUE(rid.page == numInserts, "shorter key comes first");
+  TEST_CHECK(closeTreeScan(sc));
+
+  // cleanup
+  TEST_CHECK(closeBtree(tree));
+  for(t = 0; t < 2; t++)
+    TEST_CHECK(deleteBtree(names[t]));
+  TEST_CHECK(shutdownIndexManager());
+  free(permute);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testFreeSpaceMap (void)
+{
+  int numInserts = 400;
+  int numRounds = 3;
+  testName = "record manager: deleted space is found again through the free-space map";
+  int i, round, step, numPages;
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  Schema *schema = createRecordSchema(100);
+  Record *r;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  char string[100];
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_fsm", schema));
+  TEST_CHECK(openTable(table, "test_table_fsm"));
+  TEST_CHECK(createRecord(&r, schema));
+
+  for(i = 0; i < numInserts; i++)
+    {
+      sprintf(string, "record-%d", i);
+      setRecordValues(r, schema, i, string);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+    }
+  TEST_CHECK(closeTable(table));
+  numPages = getNumFilePages("test_table_fsm");
+
+  // deleting the even records, the odd records and then all records and inserting them again reuses their space,
+  // so the file does not grow
+  TEST_CHECK(openTable(table, "test_table_fsm"));
+  for(round = 0; round < numRounds; round++)
+    {
+      step = round == numRounds - 1 ? 1 : 2;
+      for(i = round % 2; i < numInserts; i += step)
+	TEST_CHECK(deleteRecord(table, rids[i]));
+      for(i = round % 2; i < numInserts; i += step)
+	{
+	  sprintf(string, "record-%d", i);
+	  setRecordValues(r, schema, i, string);
+	  TEST_CHECK(insertRecord(table, r));
+	  rids[i] = r->id;
+	}
+      ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "all tuples inserted again");
+    }
+  TEST_CHECK(closeTable(table));
+  ASSERT_EQUALS_INT(numPages, getNumFilePages("test_table_fsm"), "file does not grow when deleted space is reused");
+
+  // the free-space map is kept in the table file, so space freed before closing the table is reused after reopening it
+  TEST_CHECK(openTable(table, "test_table_fsm"));
+  for(i = 0; i < numInserts; i += 3)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(openTable(table, "test_table_fsm"));
+  for(i = 0; i < numInserts; i += 3)
+    {
+      sprintf(string, "record-%d", i);
+      setRecordValues(r, schema, i, string);
+      TEST_CHECK(insertRecord(table, r));
+    }
+  TEST_CHECK(closeTable(table));
+  ASSERT_EQUALS_INT(numPages, getNumFilePages("test_table_fsm"), "file does not grow when space freed before reopening is reused");
+
+  // cleanup
+  TEST_CHECK(deleteTable("test_table_fsm"));
+  TEST_CHECK(shutdownRecordManager());
+  free(rids);
+  freeRecord(r);
+  freeSchema(schema);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testSlotBitmap (void)
+{
+  int numInserts = 400;
+  testName = "record manager: live slots of a page, empty pages and freed slots";
+  int i, numLive, numSeen, numBad, firstPage;
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle scan;
+  Schema *schema = createRecordSchema(100);
+  Record *r;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  bool *live = (bool *) malloc(sizeof(bool) * numInserts);
+  int *seen = (int *) malloc(sizeof(int) * numInserts);
+  char string[100];
+  Expr *left, *right, *cond;
+  Value *value;
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_slots", schema));
+  TEST_CHECK(openTable(table, "test_table_slots"));
+  TEST_CHECK(createRecord(&r, schema));
+
+  for(i = 0; i < numInserts; i++)
+    {
+      sprintf(string, "record-%d", i);
+      setRecordValues(r, schema, i, string);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+      live[i] = TRUE;
+    }
+
+  // the first page loses all of its records, the other pages every third one
+  firstPage = rids[0].page;
+  for(i = 0, numLive = numInserts; i < numInserts; i++)
+    if (rids[i].page == firstPage || i % 3 == 0)
+      {
+	TEST_CHECK(deleteRecord(table, rids[i]));
+	live[i] = FALSE;
+	numLive--;
+      }
+  ASSERT_TRUE(rids[numInserts - 1].page != firstPage, "records fill more than one page");
+  ASSERT_EQUALS_INT(numLive, getNumTuples(table), "number of tuples after deleting");
+
+  // deleted slots are neither read nor deleted again
+  for(i = 0; i < numInserts; i++)
+    if (!live[i])
+      {
+	ASSERT_ERROR(getRecord(table, rids[i], r), "deleted record cannot be read");
+	ASSERT_ERROR(deleteRecord(table, rids[i]), "deleted record cannot be deleted again");
+	break;
+      }
+
+  // a scan skips the empty page and the deleted slots and returns every live record once
+  MAKE_CONS(left, stringToValue("i-1"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(cond, left, right, OP_COMP_SMALLER);
+  memset(seen, 0, sizeof(int) * numInserts);
+  TEST_CHECK(startScan(table, &scan, cond));
+  for(numSeen = 0, numBad = 0; next(&scan, r) == RC_OK; numSeen++)
+    {
+      TEST_CHECK(getAttr(r, schema, 0, &value));
+      i = value->v.intV;
+      freeVal(value);
+      if (i < 0 || i >= numInserts || !live[i] || seen[i]++ || r->id.page != rids[i].page || r->id.slot != rids[i].slot)
+	numBad++;
+    }
+  TEST_CHECK(closeScan(&scan));
+  freeExpr(cond);
+  ASSERT_EQUALS_INT(numLive, numSeen, "scan returns every live record once");
+  ASSERT_EQUALS_INT(0, numBad, "scan returns no deleted record");
+
+  // a new record takes a freed slot of the first page
+  setRecordValues(r, schema, numInserts, "new record");
+  TEST_CHECK(insertRecord(table, r));
+  ASSERT_EQUALS_INT(firstPage, r->id.page, "new record is stored on the empty page");
+  for(i = 0, numBad = 1; i < numInserts; i++)
+    if (rids[i].page == r->id.page && rids[i].slot == r->id.slot)
+      numBad = 0;
+  ASSERT_EQUALS_INT(0, numBad, "new record reuses a freed slot");
+  TEST_CHECK(getRecord(table, r->id, r));
+  ASSERT_TRUE(hasRecordValues(r, schema, numInserts, "new record"), "new record is read from the freed slot");
+
+  // cleanup
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_slots"));
+  TEST_CHECK(shutdownRecordManager());
+  free(rids);
+  free(live);
+  free(seen);
+  freeRecord(r);
+  freeSchema(schema);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testVariableLengthRecords (void)
+{
+  int numInserts = 400;
+  int numGrown = 10;
+  int stringLength = 3000;
+  int grownLength = 1000;
+  testName = "record manager: variable-length records and records which grow out of their page";
+  int i, round, numSeen, numBad;
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle scan;
+  Schema *schema = createRecordSchema(stringLength);
+  Record *r;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  char **strings = (char **) malloc(sizeof(char *) * numInserts);
+  int *seen = (int *) malloc(sizeof(int) * numInserts);
+  Expr *left, *right, *cond;
+  Value *value;
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_var", schema));
+  TEST_CHECK(openTable(table, "test_table_var"));
+  TEST_CHECK(createRecord(&r, schema));
+
+  // short strings only take their characters, so many records share a page although b may be 3000 characters long
+  for(i = 0; i < numInserts; i++)
+    {
+      strings[i] = (char *) malloc(stringLength);
+      sprintf(strings[i], "record-%d", i);
+      setRecordValues(r, schema, i, strings[i]);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+    }
+  TEST_CHECK(closeTable(table));
+  ASSERT_TRUE(getNumFilePages("test_table_var") < numInserts / 10, "records with short strings share pages");
+  TEST_CHECK(openTable(table, "test_table_var"));
+
+  // the first records share a full page. Growing them does not fit there, so most of them move to another page.
+  // The second round shrinks them again.
+  for(round = 0; round < 2; round++)
+    {
+      for(i = 0; i < numGrown; i++)
+	{
+	  if (round == 0)
+	    {
+	      memset(strings[i], 'g', grownLength);
+	      strings[i][grownLength] = '\0';
+	    }
+	  else
+	    sprintf(strings[i], "shrunk-%d", i);
+	  setRecordValues(r, schema, i, strings[i]);
+	  r->id = rids[i];
+	  TEST_CHECK(updateRecord(table, r));
+	  ASSERT_TRUE(r->id.page == rids[i].page && r->id.slot == rids[i].slot, "RID of an updated record does not change");
+	}
+
+      // the records are read by their RIDs
+      for(i = 0, numBad = 0; i < numInserts; i++)
+	{
+	  TEST_CHECK(getRecord(table, rids[i], r));
+	  if (!hasRecordValues(r, schema, i, strings[i]))
+	    numBad++;
+	}
+      ASSERT_EQUALS_INT(0, numBad, "getRecord returns the updated and unchanged records");
+
+      // a scan returns a moved record once, with the RID it was inserted with
+      MAKE_CONS(left, stringToValue("i-1"));
+      MAKE_ATTRREF(right, 2);
+      MAKE_BINOP_EXPR(cond, left, right, OP_COMP_SMALLER);
+      memset(seen, 0, sizeof(int) * numInserts);
+      TEST_CHECK(startScan(table, &scan, cond));
+      for(numSeen = 0, numBad = 0; next(&scan, r) == RC_OK; numSeen++)
+	{
+	  TEST_CHECK(getAttr(r, schema, 0, &value));
+	  i = value->v.intV;
+	  freeVal(value);
+	  if (i < 0 || i >= numInserts || seen[i]++ || r->id.page != rids[i].page || r->id.slot != rids[i].slot
+	      || !hasRecordValues(r, schema, i, strings[i]))
+	    numBad++;
+	}
+      TEST_CHECK(closeScan(&scan));
+      freeExpr(cond);
+      ASSERT_EQUALS_INT(numInserts, numSeen, "scan returns every record once");
+      ASSERT_EQUALS_INT(0, numBad, "scan returns the records with their RIDs and strings");
+    }
+
+  // moved records are deleted through the RID they were inserted with
+  for(i = 0; i < numGrown; i++)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+  ASSERT_EQUALS_INT(numInserts - numGrown, getNumTuples(table), "number of tuples after deleting the updated records");
+  ASSERT_ERROR(getRecord(table, rids[0], r), "deleted record cannot be read");
+
+  // cleanup
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_var"));
+  TEST_CHECK(shutdownRecordManager());
+  for(i = 0; i < numInserts; i++)
+    free(strings[i]);
+  free(strings);
+  free(rids);
+  free(seen);
+  freeRecord(r);
+  freeSchema(schema);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testOverflowPages (void)
+{
+  int numInserts = 50;
+  int stringLength = 3000;
+  testName = "record manager: long strings in overflow pages";
+  int i, round, length, numPages, numSeen, numBad;
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle scan;
+  Schema *schema = createRecordSchema(stringLength);
+  Record *r;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  char **strings = (char **) malloc(sizeof(char *) * numInserts);
+  int *seen = (int *) malloc(sizeof(int) * numInserts);
+  Expr *left, *right, *cond;
+  Value *value;
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_ovf", schema));
+  TEST_CHECK(openTable(table, "test_table_ovf"));
+  TEST_CHECK(createRecord(&r, schema));
+
+  // strings longer than PAGE_SIZE / 4 are stored in overflow pages. The longest ones take most of a page themselves.
+  for(i = 0; i < numInserts; i++)
+    {
+      length = PAGE_SIZE / 4 - 10 + i * (stringLength - PAGE_SIZE / 4) / numInserts;
+      strings[i] = (char *) malloc(stringLength);
+      memset(strings[i], 'a' + i % 26, length);
+      strings[i][length] = '\0';
+      setRecordValues(r, schema, i, strings[i]);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+    }
+
+  for(round = 0; round < 2; round++)
+    {
+      // the records are read by their RIDs
+      for(i = 0, numBad = 0; i < numInserts; i++)
+	{
+	  TEST_CHECK(getRecord(table, rids[i], r));
+	  if (!hasRecordValues(r, schema, i, strings[i]))
+	    numBad++;
+	}
+      ASSERT_EQUALS_INT(0, numBad, "getRecord returns the long strings");
+
+      // a scan whose condition only references c returns every record exactly once, with its long string
+      MAKE_CONS(left, stringToValue("i-1"));
+      MAKE_ATTRREF(right, 2);
+      MAKE_BINOP_EXPR(cond, left, right, OP_COMP_SMALLER);
+      memset(seen, 0, sizeof(int) * numInserts);
+      TEST_CHECK(startScan(table, &scan, cond));
+      for(numSeen = 0, numBad = 0; next(&scan, r) == RC_OK; numSeen++)
+	{
+	  TEST_CHECK(getAttr(r, schema, 0, &value));
+	  i = value->v.intV;
+	  freeVal(value);
+	  if (i < 0 || i >= numInserts || seen[i]++ || !hasRecordValues(r, schema, i, strings[i]))
+	    numBad++;
+	}
+      TEST_CHECK(closeScan(&scan));
+      freeExpr(cond);
+      ASSERT_EQUALS_INT(numInserts, numSeen, "scan returns every record once");
+      ASSERT_EQUALS_INT(0, numBad, "scan returns the records with their long strings");
+
+      // the second round checks the same after closing and reopening the table
+      TEST_CHECK(closeTable(table));
+      TEST_CHECK(openTable(table, "test_table_ovf"));
+    }
+  TEST_CHECK(closeTable(table));
+  numPages = getNumFilePages("test_table_ovf");
+  TEST_CHECK(openTable(table, "test_table_ovf"));
+
+  // shortening the strings gives their overflow pages back, so making them long again and deleting and inserting
+  // the records does not grow the file
+  for(i = 0; i < numInserts; i++)
+    {
+      setRecordValues(r, schema, i, "short");
+      r->id = rids[i];
+      TEST_CHECK(updateRecord(table, r));
+    }
+  for(i = 0; i < numInserts; i++)
+    {
+      setRecordValues(r, schema, i, strings[i]);
+      r->id = rids[i];
+      TEST_CHECK(updateRecord(table, r));
+    }
+  for(i = 0; i < numInserts; i++)
+    TEST_CHECK(deleteRecord(table, rids[i]));
+  for(i = 0; i < numInserts; i++)
+    {
+      setRecordValues(r, schema, i, strings[i]);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+    }
+  for(i = 0, numBad = 0; i < numInserts; i++)
+    {
+      TEST_CHECK(getRecord(table, rids[i], r));
+      if (!hasRecordValues(r, schema, i, strings[i]))
+	numBad++;
+    }
+  ASSERT_EQUALS_INT(0, numBad, "getRecord returns the long strings stored in reused overflow pages");
+  TEST_CHECK(closeTable(table));
+  ASSERT_EQUALS_INT(numPages, getNumFilePages("test_table_ovf"), "file does not grow when overflow pages are reused");
+
+  // cleanup
+  TEST_CHECK(deleteTable("test_table_ovf"));
+  TEST_CHECK(shutdownRecordManager());
+  for(i = 0; i < numInserts; i++)
+    free(strings[i]);
+  free(strings);
+  free(rids);
+  free(seen);
+  freeRecord(r);
+  freeSchema(schema);
+  free(table);
+
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testTableHeader (void)
+{
+  int numInserts = 400;
+  int numDeletes = 150;
+  testName = "record manager: tuple count kept in the table header";
+  int i, round, numLive, numSeen, numBad;
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle scan;
+  Schema *schema = createRecordSchema(100);
+  Record *r;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  bool *live = (bool *) malloc(sizeof(bool) * numInserts);
+  int *seen = (int *) malloc(sizeof(int) * numInserts);
+  char string[100];
+  Expr *left, *right, *cond;
+  Value *value;
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_rm", schema));
+  TEST_CHECK(openTable(table, "test_table_rm"));
+  TEST_CHECK(createRecord(&r, schema));
+  ASSERT_EQUALS_INT(0, getNumTuples(table), "new table has no tuples");
+
+  // record i gets a = i, b = "record-i" and c = 7 * i
+  for(i = 0; i < numInserts; i++)
+    {
+      sprintf(string, "record-%d", i);
+      setRecordValues(r, schema, i, string);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+      live[i] = TRUE;
+    }
+  numLive = numInserts;
+
+  // the first round reopens the table after the inserts, the second one after deleting some of the records
+  for(round = 0; round < 2; round++)
+    {
+      if (round == 1)
+	for(i = 0; i < numDeletes; i++)
+	  {
+	    TEST_CHECK(deleteRecord(table, rids[i * 2]));
+	    live[i * 2] = FALSE;
+	    numLive--;
+	  }
+      TEST_CHECK(closeTable(table));
+      TEST_CHECK(openTable(table, "test_table_rm"));
+      ASSERT_EQUALS_INT(numLive, getNumTuples(table), "tuple count read from the table header");
+
+      // the records are read by their RIDs
+      for(i = 0, numBad = 0; i < numInserts; i++)
+	{
+	  sprintf(string, "record-%d", i);
+	  if (live[i] && (getRecord(table, rids[i], r) != RC_OK || !hasRecordValues(r, schema, i, string)))
+	    numBad++;
+	}
+      ASSERT_EQUALS_INT(0, numBad, "getRecord returns the records after reopening");
+
+      // a scan returns as many records as the header counts
+      MAKE_CONS(left, stringToValue("i-1"));
+      MAKE_ATTRREF(right, 2);
+      MAKE_BINOP_EXPR(cond, left, right, OP_COMP_SMALLER);
+      memset(seen, 0, sizeof(int) * numInserts);
+      TEST_CHECK(startScan(table, &scan, cond));
+      for(numSeen = 0, numBad = 0; next(&scan, r) == RC_OK; numSeen++)
+	{
+	  TEST_CHECK(getAttr(r, schema, 0, &value));
+	  i = value->v.intV;
+	  freeVal(value);
+	  if (i < 0 || i >= numInserts || !live[i] || seen[i]++ || r->id.page != rids[i].page || r->id.slot != rids[i].slot)
+	    numBad++;
+	}
+      TEST_CHECK(closeScan(&scan));
+      freeExpr(cond);
+      ASSERT_EQUALS_INT(getNumTuples(table), numSeen, "scan returns as many records as the tuple count");
+      ASSERT_EQUALS_INT(0, numBad, "scan returns every live record once");
+    }
+
+  // cleanup
+  TEST_CHECK(closeTable(table));
+  TEST_CHECK(deleteTable("test_table_rm"));
+  TEST_CHECK(shutdownRecordManager());
+  free(rids);
+  free(live);
+  free(seen);
+  freeRecord(r);
+  freeSchema(schema);
+  free(table);
+
+  TEST_DONE();
+}
+
 // ************************************************************
 int *
 createPermutation (int size)
@@ -384,3 +1255,74 @@ freeValues (Value **vals, int size)
     free(vals[size]);
   free(vals);
 }
+
+// ************************************************************ 
+Schema *
+createRecordSchema (int stringLength)
+{
+  char *names[] = { "a", "b", "c" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, stringLength, 0 };
+  int i;
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+
+  for(i = 0; i < 3; i++)
+    {
+      cpNames[i] = (char *) malloc(2);
+      strcpy(cpNames[i], names[i]);
+    }
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  cpKeys[0] = 0;
+
+  return createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+// ************************************************************ 
+void
+setRecordValues (Record *record, Schema *schema, int a, char *b)
+{
+  Value value;
+
+  value.dt = DT_INT;
+  value.v.intV = a;
+  setAttr(record, schema, 0, &value);
+  value.dt = DT_STRING;
+  value.v.stringV = b;
+  setAttr(record, schema, 1, &value);
+  value.dt = DT_INT;
+  value.v.intV = 7 * a;
+  setAttr(record, schema, 2, &value);
+}
+
+// ************************************************************ 
+bool
+hasRecordValues (Record *record, Schema *schema, int a, char *b)
+{
+  Value *values[3];
+  bool result;
+  int i;
+
+  for(i = 0; i < 3; i++)
+    getAttr(record, schema, i, &values[i]);
+  result = values[0]->v.intV == a && strcmp(values[1]->v.stringV, b) == 0 && values[2]->v.intV == 7 * a;
+  for(i = 0; i < 3; i++)
+    freeVal(values[i]);
+  return result;
+}
+
+// ************************************************************ 
+int
+getNumFilePages (char *name)
+{
+  SM_FileHandle fileHandle;
+  int numPages;
+
+  TEST_CHECK(openPageFile(name, &fileHandle));
+  numPages = fileHandle.totalNumPages;
+  TEST_CHECK(closePageFile(&fileHandle));
+  return numPages;
+}
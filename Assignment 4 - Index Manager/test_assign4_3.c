@@ -0,0 +1,399 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// test and helper methods
+static void testCLOCK (void);
+static void testLRU_K (void);
+static void testARC (void);
+static void test2Q (void);
+static void testBackgroundFlusher (void);
+static void testReadAhead (void);
+
+static void createDummyPages(BM_BufferPool *bm, int num);
+static void runReferenceString(BM_BufferPool *bm, const int *requests, const char **poolContents, int numRequests);
+static int waitForReadIO(BM_BufferPool *bm);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testCLOCK();
+  testLRU_K();
+  testARC();
+  test2Q();
+  testBackgroundFlusher();
+  testReadAhead();
+
+  return 0;
+}
+
+// test the CLOCK page replacement strategy
+void
+testCLOCK (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // read first four pages, their reference bits are set
+    "[3 0],[-1 0],[-1 0],[-1 0]",
+    "[3 0],[2 0],[-1 0],[-1 0]",
+    "[3 0],[2 0],[0 0],[-1 0]",
+    "[3 0],[2 0],[0 0],[8 0]",
+    // the first sweep clears all reference bits and replaces 3
+    "[4 0],[2 0],[0 0],[8 0]",
+    // a hit sets the reference bit of 2 again but does not move the clock hand
+    "[4 0],[2 0],[0 0],[8 0]",
+    "[4 0],[2 0],[5 0],[8 0]",
+    "[4 0],[2 0],[5 0],[0 0]",
+    // the hand skips 4 (referenced), clearing its bit, and replaces 2
+    "[4 0],[9 0],[5 0],[0 0]",
+    "[8 0],[9 0],[5 0],[0 0]",
+    "[8 0],[9 0],[3 0],[0 0]",
+    "[8 0],[9 0],[3 0],[2 0]"
+  };
+  const int requests[] = {3,2,0,8,4,2,5,0,9,8,3,2};
+
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing CLOCK page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_CLOCK, NULL));
+
+  runReferenceString(bm, requests, poolContents, 12);
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(11, getNumReadIO(bm), "check number of read I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// test the LRU-K page replacement strategy (K = 2)
+void
+testLRU_K (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // read first three pages, then reference 0 and 1 a second time
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // pages referenced only once have an infinite backward 2-distance and are replaced first (LRU would replace 0 for 4)
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    // 2 comes back with its retained history, so now the oldest second-to-last reference (page 0) is replaced
+    "[0 0],[1 0],[2 0]",
+    "[5 0],[1 0],[2 0]"
+  };
+  const int requests[] = {0,1,2,0,1,3,4,2,5};
+  int k = 2;
+
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing LRU-K page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &k));
+
+  runReferenceString(bm, requests, poolContents, 9);
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "check number of read I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// test the ARC page replacement strategy
+void
+testARC (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // read first three pages into T1, then move 0 and 1 to T2
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // T1 is longer than its target (0), so new pages replace T1 pages: 2 and 3 become ghosts in B1
+    "[0 0],[1 0],[3 0]",
+    "[0 0],[1 0],[4 0]",
+    // a hit in B1 grows the target of T1 to 1, so T2's least recently used page 0 is replaced
+    "[2 0],[1 0],[4 0]",
+    "[2 0],[5 0],[4 0]",
+    // a hit in B2 shrinks the target of T1 to 0 again, so T1's least recently used page 4 is replaced
+    "[2 0],[5 0],[0 0]"
+  };
+  const int requests[] = {0,1,2,0,1,3,4,2,5,0};
+
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing ARC page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_ARC, NULL));
+
+  runReferenceString(bm, requests, poolContents, 10);
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// test the 2Q page replacement strategy
+void
+test2Q (void)
+{
+  // expected results
+  const char *poolContents[] = {
+    // read first three pages into A1in. Hits in A1in do not change its FIFO order
+    "[0 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[-1 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    "[0 0],[1 0],[2 0]",
+    // A1in is longer than a quarter of the pool, so its oldest pages are replaced and remembered in A1out
+    "[3 0],[1 0],[2 0]",
+    "[3 0],[4 0],[2 0]",
+    // 1 is still in A1out, so it comes back into Am
+    "[3 0],[4 0],[1 0]",
+    // a scan of new pages only replaces A1in pages, the Am page 1 stays
+    "[5 0],[4 0],[1 0]",
+    "[5 0],[6 0],[1 0]",
+    "[7 0],[6 0],[1 0]"
+  };
+  const int requests[] = {0,1,2,0,1,3,4,1,5,6,7};
+
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Testing 2Q page replacement";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_2Q, NULL));
+
+  runReferenceString(bm, requests, poolContents, 11);
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(9, getNumReadIO(bm), "check number of read I/Os");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// test that the background flusher writes dirty pages to disk without forcePage or forceFlushPool
+void
+testBackgroundFlusher (void)
+{
+  int numPages = 10;
+  int i, wait;
+  bool *dirtyFlags;
+  char *expected = malloc(sizeof(char) * 512);
+  SM_FileHandle fh;
+  SM_PageHandle data = (SM_PageHandle) malloc(PAGE_SIZE);
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing the background flusher";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", numPages, RS_LRU, NULL));
+
+  // no page frame is clean, so the flusher writes the dirty pages as soon as they are unpinned
+  TEST_CHECK(startBackgroundFlusher(bm, numPages));
+  for(i = 0; i < numPages; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Flushed", i);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  // the flusher checks the pool every FLUSHER_INTERVAL_MS (100 ms), so 5 seconds are plenty
+  for(wait = 0; wait < 500 && getNumWriteIO(bm) < numPages; wait++)
+    usleep(10000);
+  ASSERT_EQUALS_INT(numPages, getNumWriteIO(bm), "all dirty pages are written by the flusher");
+
+  dirtyFlags = getDirtyFlags(bm);
+  for(i = 0; i < numPages; i++)
+    ASSERT_TRUE(!dirtyFlags[i], "written page is clean");
+  free(dirtyFlags);
+
+  // the pages on disk have the new content while the pool is still open
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  for(i = 0; i < numPages; i++)
+    {
+      TEST_CHECK(readBlock(i, &fh, data));
+      sprintf(expected, "%s-%i", "Flushed", i);
+      ASSERT_EQUALS_STRING(expected, data, "page on disk written by the flusher");
+    }
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(stopBackgroundFlusher(bm));
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(data);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that a sequential run of pins reads the following pages ahead, and that no page is read twice
+void
+testReadAhead (void)
+{
+  int numPages = 40;
+  int numPins = 32;
+  int i, numLoaded, numReads;
+  PageNumber *frameContents;
+  int *fixCounts;
+  bool readAhead = FALSE;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing read-ahead of sequential pins";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", numPages, RS_FIFO, NULL));
+  TEST_CHECK(setReadAhead(bm, 8));
+
+  for(i = 0; i < numPins; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  numReads = waitForReadIO(bm);
+
+  // the pool is large enough for all pages, so every page read is still in the pool and none was read twice
+  frameContents = getFrameContents(bm);
+  fixCounts = getFixCounts(bm);
+  for(i = 0, numLoaded = 0; i < numPages; i++)
+    {
+      if (frameContents[i] != NO_PAGE)
+	numLoaded++;
+      if (frameContents[i] == numPins)
+	readAhead = TRUE;
+      ASSERT_EQUALS_INT(0, fixCounts[i], "read-ahead leaves no page pinned");
+    }
+  ASSERT_EQUALS_INT(numLoaded, numReads, "check number of read I/Os");
+  ASSERT_TRUE(numReads > numPins, "more pages read than pinned");
+  ASSERT_TRUE(readAhead, "page after the last pinned one was read ahead");
+  free(frameContents);
+  free(fixCounts);
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+void
+createDummyPages(BM_BufferPool *bm, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm,h));
+    }
+
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(h);
+}
+
+// pin and directly unpin the requested pages, checking the pool content after each of them
+void
+runReferenceString(BM_BufferPool *bm, const int *requests, const char **poolContents, int numRequests)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  for(i = 0; i < numRequests; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, requests[i]));
+      TEST_CHECK(unpinPage(bm, h));
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+
+  free(h);
+}
+
+// wait until the prefetcher has been idle for 200 ms and return the number of read I/Os
+int
+waitForReadIO(BM_BufferPool *bm)
+{
+  int numReads, idle;
+
+  for(numReads = getNumReadIO(bm), idle = 0; idle < 20; idle++)
+    {
+      usleep(10000);
+      if (getNumReadIO(bm) != numReads)
+	{
+	  numReads = getNumReadIO(bm);
+	  idle = 0;
+	}
+    }
+  return numReads;
+}